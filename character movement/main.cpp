@@ -1,4 +1,31 @@
 #include <SFML/Graphics.hpp>
+#include <string>
+#include "scaled_image.h"
+
+// Robot size relative to its artwork (twice the old 0.075).
+const float ROBOT_SCALE = 0.15f;
+
+static bool decodeWithSfml(const std::string& path, RgbaImage& image) {
+    sf::Image loaded;
+    if (!loaded.loadFromFile(path)) return false;
+    image.width = int(loaded.getSize().x);
+    image.height = int(loaded.getSize().y);
+    const sf::Uint8* pixels = loaded.getPixelsPtr();
+    image.pixels.assign(pixels, pixels + size_t(image.width) * image.height * 4);
+    return true;
+}
+
+// Loads path scaled down by scale (see scaled_image.h); fullSize gets the
+// artwork's own size.
+static bool loadScaledTexture(sf::Texture& texture, const std::string& path, float scale, sf::Vector2u& fullSize) {
+    RgbaImage image;
+    int width, height;
+    if (!loadScaledImage(path, scale, decodeWithSfml, image, width, height)) return false;
+    fullSize = sf::Vector2u(unsigned(width), unsigned(height));
+    sf::Image scaled;
+    scaled.create(unsigned(image.width), unsigned(image.height), image.pixels.data());
+    return texture.loadFromImage(scaled);
+}
 
 int main() {
     // Load background texture
@@ -14,17 +41,20 @@ int main() {
     sf::RenderWindow window(sf::VideoMode(bgSize.x, bgSize.y), "Robot in Room");
     sf::Sprite roomSprite(roomTexture);
 
-    // Load robot texture
+    // Load robot texture at the size it is drawn, rather than drawing the
+    // full artwork at 0.15 scale
     sf::Texture robotTexture;
-    if (!robotTexture.loadFromFile("robot.png")) {
+    sf::Vector2u robotSize;
+    if (!loadScaledTexture(robotTexture, "robot.png", ROBOT_SCALE, robotSize)) {
         return -1;
     }
     sf::Sprite robotSprite(robotTexture);
     robotSprite.setPosition(350, 350); // Start in middle
 
-    // Explicit scaling to make robot twice its previous size
-    // Old size was 0.075, so new scale is 0.15 (double)
-    robotSprite.setScale(0.15f, 0.15f);
+    // Whatever was rounded off, the robot keeps exactly ROBOT_SCALE of its
+    // artwork's size
+    robotSprite.setScale(robotSize.x * ROBOT_SCALE / robotTexture.getSize().x,
+                         robotSize.y * ROBOT_SCALE / robotTexture.getSize().y);
 
     float speed = 6.0f; // Movement speed
 
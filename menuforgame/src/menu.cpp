@@ -5,6 +5,10 @@
 #include <fstream>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include "hotspot_layer.h"
+#include "room_map.h"
+#include "scene_flow.h"
 
 const int WINDOW_WIDTH = 768;
 const int WINDOW_HEIGHT = 1152;
@@ -17,10 +21,6 @@ struct MenuButton {
     bool clicked = false;
 };
 
-bool pointInRect(int x, int y, SDL_Rect& rect) {
-    return (x >= rect.x && x <= rect.x + rect.w && y >= rect.y && y <= rect.y + rect.h);
-}
-
 void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
                 SDL_Color color, SDL_Rect& dstRect) {
     SDL_Surface* surface = TTF_RenderText_Blended(font, text.c_str(), color);
@@ -31,10 +31,15 @@ void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
     SDL_FreeSurface(surface);
 }
 
-void showHighScores(SDL_Renderer* parentRenderer, TTF_Font* font) {
-    SDL_Window* scoreWindow = SDL_CreateWindow("High Scores", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 400, 400, 0);
-    SDL_Renderer* renderer = SDL_CreateRenderer(scoreWindow, -1, SDL_RENDERER_ACCELERATED);
-    SDL_Event e;
+// Runs in a window of its own beside the menu, which stays live, until ESC
+// or its close button.
+Flow<> showHighScores(FlowRunner& flows, TTF_Font* font, bool& open) {
+    open = true;
+    std::unique_ptr<SDL_Window, void (*)(SDL_Window*)> scoreWindow(
+        SDL_CreateWindow("High Scores", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 400, 400, 0), SDL_DestroyWindow);
+    std::unique_ptr<SDL_Renderer, void (*)(SDL_Renderer*)> renderer(
+        SDL_CreateRenderer(scoreWindow.get(), -1, SDL_RENDERER_ACCELERATED), SDL_DestroyRenderer);
+    const Uint32 windowID = SDL_GetWindowID(scoreWindow.get());
 
     std::vector<std::pair<std::string, int>> scores;
     std::ifstream file("highscores.txt");
@@ -48,37 +53,35 @@ void showHighScores(SDL_Renderer* parentRenderer, TTF_Font* font) {
         return b.second < a.second;
     });
 
-    bool open = true;
     while (open) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
-                open = false;
-            }
-        }
-
-        SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
-        SDL_RenderClear(renderer);
+        SDL_SetRenderDrawColor(renderer.get(), 30, 30, 30, 255);
+        SDL_RenderClear(renderer.get());
 
         int y = 50;
         if (scores.empty()) {
             SDL_Color color = {255, 255, 255};
             SDL_Rect r = {50, y, 0, 0};
-            renderText(renderer, font, "No high scores yet!", color, r);
+            renderText(renderer.get(), font, "No high scores yet!", color, r);
         } else {
             for (const auto& entry : scores) {
                 std::string line = entry.first + ": " + std::to_string(entry.second);
                 SDL_Color color = {255, 255, 255};
                 SDL_Rect r = {50, y, 0, 0};
-                renderText(renderer, font, line, color, r);
+                renderText(renderer.get(), font, line, color, r);
                 y += 50;
             }
         }
 
-        SDL_RenderPresent(renderer);
-    }
+        SDL_RenderPresent(renderer.get());
+        co_await flows.nextFrame();
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(scoreWindow);
+        for (const SDL_Event& e : flows.events()) {
+            if ((e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE && e.window.windowID == windowID) ||
+                (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE && e.key.windowID == windowID)) {
+                open = false;
+            }
+        }
+    }
 }
 
 void updateScore(const std::string& player, int points) {
@@ -106,41 +109,48 @@ void updateScore(const std::string& player, int points) {
     }
 }
 
-std::string getPlayerName(SDL_Renderer* renderer, TTF_Font* font) {
-    std::string nameInput;
-    SDL_StartTextInput();
-    SDL_Event e;
-    bool entering = true;
-
-    while (entering) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) return "";
-            else if (e.type == SDL_TEXTINPUT) {
-                nameInput += e.text.text;
-            } else if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_BACKSPACE && !nameInput.empty()) {
-                    nameInput.pop_back();
-                } else if (e.key.keysym.sym == SDLK_RETURN && !nameInput.empty()) {
-                    entering = false;
-                }
-            }
-        }
-
-        SDL_SetRenderDrawColor(renderer, 20, 20, 20, 255);
-        SDL_RenderClear(renderer);
+// What the main loop draws; the menu's flow switches between them.
+enum MenuScreen { MAIN_MENU, NAME_ENTRY, ROOM_MAP };
 
-        SDL_Color color = {255, 255, 255};
-        SDL_Rect labelRect = {100, 200, 0, 0};
-        renderText(renderer, font, "Enter your name:", color, labelRect);
-
-        SDL_Rect inputRect = {100, 300, 0, 0};
-        renderText(renderer, font, nameInput, color, inputRect);
+struct Menu {
+    MenuScreen screen = MAIN_MENU;
+    std::vector<MenuButton> buttons;
+    // One hotspot per button, same index; sizes follow the rendered labels.
+    HotspotLayer hotspots;
+    TextField name;
+    bool scoresOpen = false;
+};
 
-        SDL_RenderPresent(renderer);
+Flow<> runMenu(FlowRunner& flows, Menu& menu, SDL_Renderer* renderer, TTF_Font* font, Uint32 windowID) {
+    for (;;) {
+        SDL_Event click = co_await flows.mouseClicked();
+        if (click.button.windowID != windowID) continue;
+        const int clicked = menu.hotspots.hit(click.button.x, click.button.y);
+        if (clicked < 0) continue;
+
+        for (auto& b : menu.buttons) b.clicked = false;
+        menu.buttons[clicked].clicked = true;
+        if (clicked == 0) {
+            menu.name.text.clear();
+            menu.screen = NAME_ENTRY;
+            std::string playerName = co_await flows.textEntered(menu.name);
+            menu.screen = MAIN_MENU;
+            updateScore(playerName, 10);
+        }
+        else if (clicked == 1) std::cout << "Resume Game\n";
+        else if (clicked == 2) std::cout << "Help\n";
+        else if (clicked == 3) {
+            openRoomMap(renderer, font);
+            menu.screen = ROOM_MAP;
+            co_await flows.keyPressed(SDLK_ESCAPE);
+            menu.screen = MAIN_MENU;
+            closeRoomMap();
+        }
+        else if (clicked == 4) {
+            if (!menu.scoresOpen) flows.start(showHighScores(flows, font, menu.scoresOpen));
+        }
+        else if (clicked == 5) flows.stop();
     }
-
-    SDL_StopTextInput();
-    return nameInput;
 }
 
 int main() {
@@ -164,7 +174,8 @@ int main() {
         return 1;
     }
 
-    std::vector<MenuButton> buttons = {
+    Menu menu;
+    menu.buttons = {
         {{270, 300, 0, 0}, "New Game",      {255, 255, 0}},
         {{270, 370, 0, 0}, "Resume Game",   {255, 255, 0}},
         {{270, 440, 0, 0}, "Help",          {255, 255, 0}},
@@ -172,61 +183,82 @@ int main() {
         {{270, 580, 0, 0}, "Highest Score", {255, 255, 0}},
         {{270, 650, 0, 0}, "Exit",          {255, 255, 0}}
     };
+    for (const auto& btn : menu.buttons) menu.hotspots.add(btn.label, btn.rect.x, btn.rect.y, btn.rect.w, btn.rect.h);
 
-    bool running = true;
+    const Uint32 windowID = SDL_GetWindowID(window);
     SDL_Event e;
 
-    while (running) {
-        int mouseX, mouseY;
-        SDL_GetMouseState(&mouseX, &mouseY);
-
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) {
-                running = false;
-            } else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                for (size_t i = 0; i < buttons.size(); ++i) {
-                    if (pointInRect(mouseX, mouseY, buttons[i].rect)) {
-                        for (auto& b : buttons) b.clicked = false;
-                        buttons[i].clicked = true;
-                        if (i == 0) {
-                            std::string playerName = getPlayerName(renderer, font);
-                            if (!playerName.empty()) {
-                                updateScore(playerName, 10);
-                            }
-                        }
-                        else if (i == 1) std::cout << "Resume Game\n";
-                        else if (i == 2) std::cout << "Help\n";
-                        else if (i == 3) std::cout << "Map\n";
-                        else if (i == 4) showHighScores(renderer, font);
-                        else if (i == 5) running = false;
-                    }
+    // The only event loop. Name entry, the map and the high score window
+    // are flows resumed from flows.update(); the flows own the score
+    // window, so they go before the renderer.
+    {
+        FlowRunner flows;
+        flows.start(runMenu(flows, menu, renderer, font, windowID));
+
+        while (flows.running()) {
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT ||
+                    (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_CLOSE && e.window.windowID == windowID)) {
+                    flows.stop();
                 }
+                flows.dispatch(e);
             }
-        }
+            flows.update();
+            if (!flows.running()) break;
 
-        for (auto& btn : buttons) {
-            btn.hovered = pointInRect(mouseX, mouseY, btn.rect);
-        }
+            if (menu.screen == ROOM_MAP) {
+                drawRoomMap(renderer);
+                SDL_RenderPresent(renderer);
+                continue;
+            }
 
-        SDL_RenderClear(renderer);
-        SDL_RenderCopy(renderer, bgTexture, NULL, NULL);
+            if (menu.screen == NAME_ENTRY) {
+                SDL_SetRenderDrawColor(renderer, 20, 20, 20, 255);
+                SDL_RenderClear(renderer);
 
-        SDL_Color titleColor = {255, 255, 255};
-        SDL_Rect titleRect = {0, 100, 0, 0};
-        renderText(renderer, titleFont, "Escape Room Conquest", titleColor, titleRect);
-        titleRect.x = (WINDOW_WIDTH - titleRect.w) / 2;
-        SDL_RenderCopy(renderer, SDL_GetRenderTarget(renderer), NULL, &titleRect);
+                SDL_Color color = {255, 255, 255};
+                SDL_Rect labelRect = {100, 200, 0, 0};
+                renderText(renderer, font, "Enter your name:", color, labelRect);
 
-        for (auto& btn : buttons) {
-            SDL_Color textColor = btn.clicked ? SDL_Color{0, 0, 0} : (btn.hovered ? SDL_Color{255, 255, 255} : btn.color);
-            SDL_Rect textRect = btn.rect;
-            renderText(renderer, font, btn.label, textColor, textRect);
-            btn.rect = textRect;
-        }
+                SDL_Rect inputRect = {100, 300, 0, 0};
+                renderText(renderer, font, menu.name.text, color, inputRect);
 
-        SDL_RenderPresent(renderer);
+                SDL_RenderPresent(renderer);
+                continue;
+            }
+
+            int mouseX, mouseY;
+            SDL_GetMouseState(&mouseX, &mouseY);
+            const int hovered = menu.hotspots.hit(mouseX, mouseY);
+            for (size_t i = 0; i < menu.buttons.size(); ++i) {
+                menu.buttons[i].hovered = int(i) == hovered;
+            }
+
+            SDL_RenderClear(renderer);
+            SDL_RenderCopy(renderer, bgTexture, NULL, NULL);
+
+            SDL_Color titleColor = {255, 255, 255};
+            SDL_Rect titleRect = {0, 100, 0, 0};
+            renderText(renderer, titleFont, "Escape Room Conquest", titleColor, titleRect);
+            titleRect.x = (WINDOW_WIDTH - titleRect.w) / 2;
+            SDL_RenderCopy(renderer, SDL_GetRenderTarget(renderer), NULL, &titleRect);
+
+            for (auto& btn : menu.buttons) {
+                SDL_Color textColor = btn.clicked ? SDL_Color{0, 0, 0} : (btn.hovered ? SDL_Color{255, 255, 255} : btn.color);
+                SDL_Rect textRect = btn.rect;
+                renderText(renderer, font, btn.label, textColor, textRect);
+                btn.rect = textRect;
+            }
+            for (size_t i = 0; i < menu.buttons.size(); ++i) {
+                const SDL_Rect& r = menu.buttons[i].rect;
+                menu.hotspots.move(int(i), r.x, r.y, r.w + 1, r.h + 1);  // edges were inclusive
+            }
+
+            SDL_RenderPresent(renderer);
+        }
     }
 
+    releaseRoomMap();
     SDL_DestroyTexture(bgTexture);
     TTF_CloseFont(font);
     TTF_CloseFont(titleFont);
@@ -0,0 +1,349 @@
+#include "room_map.h"
+#include <SDL_image.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+const int THUMB_W = 224;
+const int THUMB_H = 150;
+const int ATLAS_COLS = 3;
+const char* MAP_CACHE_DIR = "map_cache";
+const char* ATLAS_IMAGE = "map_cache/atlas.bmp";
+const char* ATLAS_INDEX = "map_cache/atlas.idx";
+// One solved room id per line, appended by the decoder, circuit and shooter
+// rooms when they are cleared (see room_progress.h). The robot room and the
+// scenes have nothing to clear, so they never show as solved.
+const char* PROGRESS_FILE = "progress.txt";
+
+struct Room {
+    std::string id;
+    std::string label;
+    std::string path;
+};
+
+const std::vector<Room> ROOMS = {
+    {"scene1",  "Scene 1",  "../muliplewindow/multiple/scene1.png"},
+    {"scene2",  "Scene 2",  "../muliplewindow/multiple/scene2.png"},
+    {"scene3",  "Scene 3",  "../muliplewindow/multiple/scene3.png"},
+    {"scene4",  "Scene 4",  "../muliplewindow/multiple/scene4.png"},
+    {"scene5",  "Scene 5",  "../muliplewindow/multiple/scene5.png"},
+    {"robot",   "Robot Room", "../character movement/room.png"},
+    {"shooter", "Deadline Invaders", "../spaceshooter/space_background.png"},
+    {"decoder", "Decoder",  "../muliplewindow/puzzle/puzzleimage.png"},
+    {"circuit", "Circuit Maze", "../muliplewindow/circuitpattern/background.png"}
+};
+
+// What a thumbnail was built from. The hash is only computed when size or
+// mtime disagree with the index, so a warm open never reads the PNGs.
+struct CacheEntry {
+    uintmax_t size = 0;
+    long long mtime = 0;
+    uint64_t hash = 0;
+    bool present = false;
+};
+
+static SDL_Texture* atlasTexture = nullptr;
+static std::vector<CacheEntry> atlasEntries;
+
+// The paths above are relative to the directory holding the menu executable,
+// so the map finds the rooms whatever the working directory is.
+static std::string fromBase(const std::string& path) {
+    static const std::string base = [] {
+        char* dir = SDL_GetBasePath();
+        std::string result = dir ? dir : "";
+        SDL_free(dir);
+        return result;
+    }();
+    return base + path;
+}
+
+static int atlasWidth() { return ATLAS_COLS * THUMB_W; }
+static int atlasHeight() { return ((int)ROOMS.size() + ATLAS_COLS - 1) / ATLAS_COLS * THUMB_H; }
+
+static SDL_Rect cellRect(size_t index) {
+    return {(int)(index % ATLAS_COLS) * THUMB_W, (int)(index / ATLAS_COLS) * THUMB_H, THUMB_W, THUMB_H};
+}
+
+static CacheEntry statRoom(const Room& room) {
+    CacheEntry entry;
+    std::error_code ec;
+    entry.size = fs::file_size(fromBase(room.path), ec);
+    if (ec) return entry;
+    auto mtime = fs::last_write_time(fromBase(room.path), ec);
+    if (ec) return entry;
+    entry.mtime = static_cast<long long>(mtime.time_since_epoch().count());
+    entry.present = true;
+    return entry;
+}
+
+// FNV-1a over the file contents.
+static uint64_t hashFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    uint64_t hash = 1469598103934665603ULL;
+    static char buffer[1 << 16];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        for (std::streamsize i = 0; i < in.gcount(); ++i) {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static std::map<std::string, CacheEntry> readIndex() {
+    std::map<std::string, CacheEntry> entries;
+    std::ifstream in(fromBase(ATLAS_INDEX));
+    int w = 0, h = 0, tw = 0, th = 0;
+    std::string tag;
+    if (!(in >> tag >> w >> h >> tw >> th) || tag != "atlas" ||
+        w != atlasWidth() || h != atlasHeight() || tw != THUMB_W || th != THUMB_H) {
+        return entries;
+    }
+    std::string id;
+    CacheEntry entry;
+    while (in >> id >> entry.size >> entry.mtime >> entry.hash) {
+        entry.present = true;
+        entries[id] = entry;
+    }
+    return entries;
+}
+
+static void writeIndex(const std::map<std::string, CacheEntry>& entries) {
+    std::ofstream out(fromBase(ATLAS_INDEX));
+    out << "atlas " << atlasWidth() << " " << atlasHeight() << " " << THUMB_W << " " << THUMB_H << "\n";
+    for (const auto& e : entries) {
+        out << e.first << " " << e.second.size << " " << e.second.mtime << " " << e.second.hash << "\n";
+    }
+}
+
+static SDL_Surface* loadCachedAtlas() {
+    SDL_Surface* bmp = SDL_LoadBMP(fromBase(ATLAS_IMAGE).c_str());
+    if (!bmp) return nullptr;
+    SDL_Surface* atlas = SDL_ConvertSurfaceFormat(bmp, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(bmp);
+    if (atlas && (atlas->w != atlasWidth() || atlas->h != atlasHeight())) {
+        SDL_FreeSurface(atlas);
+        return nullptr;
+    }
+    return atlas;
+}
+
+// Box filter: every destination pixel is the average of the source block it covers.
+static void downscaleInto(SDL_Surface* src, SDL_Surface* atlas, const SDL_Rect& dst) {
+    for (int y = 0; y < dst.h; ++y) {
+        int sy0 = y * src->h / dst.h;
+        int sy1 = std::max(sy0 + 1, (y + 1) * src->h / dst.h);
+        Uint32* out = reinterpret_cast<Uint32*>(static_cast<Uint8*>(atlas->pixels) + (dst.y + y) * atlas->pitch) + dst.x;
+        for (int x = 0; x < dst.w; ++x) {
+            int sx0 = x * src->w / dst.w;
+            int sx1 = std::max(sx0 + 1, (x + 1) * src->w / dst.w);
+            Uint32 a = 0, r = 0, g = 0, b = 0;
+            for (int sy = sy0; sy < sy1; ++sy) {
+                const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(src->pixels) + sy * src->pitch);
+                for (int sx = sx0; sx < sx1; ++sx) {
+                    Uint32 p = row[sx];
+                    a += p >> 24; r += (p >> 16) & 0xFF; g += (p >> 8) & 0xFF; b += p & 0xFF;
+                }
+            }
+            Uint32 count = (sy1 - sy0) * (sx1 - sx0);
+            out[x] = ((a / count) << 24) | ((r / count) << 16) | ((g / count) << 8) | (b / count);
+        }
+    }
+}
+
+static void fillCell(SDL_Surface* atlas, size_t index) {
+    SDL_Rect cell = cellRect(index);
+    SDL_FillRect(atlas, &cell, SDL_MapRGBA(atlas->format, 40, 40, 40, 255));
+}
+
+static bool drawThumbnail(SDL_Surface* atlas, size_t index) {
+    SDL_Surface* image = IMG_Load(fromBase(ROOMS[index].path).c_str());
+    if (!image) {
+        std::cerr << "Failed to load room image " << ROOMS[index].path << ": " << IMG_GetError() << std::endl;
+        return false;
+    }
+    SDL_Surface* argb = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(image);
+    if (!argb) return false;
+
+    SDL_Rect cell = cellRect(index);
+    float scale = std::min(float(THUMB_W) / argb->w, float(THUMB_H) / argb->h);
+    SDL_Rect dst;
+    dst.w = std::max(1, (int)(argb->w * scale));
+    dst.h = std::max(1, (int)(argb->h * scale));
+    dst.x = cell.x + (THUMB_W - dst.w) / 2;
+    dst.y = cell.y + (THUMB_H - dst.h) / 2;
+    downscaleInto(argb, atlas, dst);
+    SDL_FreeSurface(argb);
+    return true;
+}
+
+// Returns the atlas texture, rebuilding only the cells whose source changed.
+static SDL_Texture* acquireAtlas(SDL_Renderer* renderer) {
+    std::vector<CacheEntry> current;
+    for (const auto& room : ROOMS) current.push_back(statRoom(room));
+
+    bool unchanged = atlasTexture && atlasEntries.size() == current.size();
+    for (size_t i = 0; unchanged && i < current.size(); ++i) {
+        unchanged = current[i].present == atlasEntries[i].present &&
+                    current[i].size == atlasEntries[i].size && current[i].mtime == atlasEntries[i].mtime;
+    }
+    if (unchanged) return atlasTexture;
+
+    std::map<std::string, CacheEntry> index = readIndex();
+    SDL_Surface* atlas = index.empty() ? nullptr : loadCachedAtlas();
+    bool dirty = false;
+    if (!atlas) {
+        atlas = SDL_CreateRGBSurfaceWithFormat(0, atlasWidth(), atlasHeight(), 32, SDL_PIXELFORMAT_ARGB8888);
+        if (!atlas) return nullptr;
+        SDL_FillRect(atlas, nullptr, SDL_MapRGBA(atlas->format, 40, 40, 40, 255));
+        index.clear();
+        dirty = true;
+    }
+
+    for (size_t i = 0; i < ROOMS.size(); ++i) {
+        const std::string& id = ROOMS[i].id;
+        CacheEntry& entry = current[i];
+        auto cached = index.find(id);
+        if (!entry.present) {
+            fillCell(atlas, i);
+            if (cached != index.end()) { index.erase(cached); dirty = true; }
+            continue;
+        }
+        if (cached != index.end() && cached->second.size == entry.size && cached->second.mtime == entry.mtime) {
+            entry.hash = cached->second.hash;
+            continue;
+        }
+        entry.hash = hashFile(fromBase(ROOMS[i].path));
+        if (cached != index.end() && cached->second.size == entry.size && cached->second.hash == entry.hash) {
+            // Touched but not modified: keep the thumbnail, refresh the mtime.
+            cached->second.mtime = entry.mtime;
+            dirty = true;
+            continue;
+        }
+        fillCell(atlas, i);
+        if (drawThumbnail(atlas, i)) {
+            index[id] = entry;
+        } else {
+            index.erase(id);
+        }
+        dirty = true;
+    }
+
+    if (dirty) {
+        std::error_code ec;
+        fs::create_directories(fromBase(MAP_CACHE_DIR), ec);
+        if (SDL_SaveBMP(atlas, fromBase(ATLAS_IMAGE).c_str()) == 0) {
+            writeIndex(index);
+        } else {
+            std::cerr << "Failed to write map cache: " << SDL_GetError() << std::endl;
+        }
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+    if (atlasTexture) SDL_DestroyTexture(atlasTexture);
+    atlasTexture = texture;
+    atlasEntries = current;
+    return atlasTexture;
+}
+
+static std::set<std::string> loadSolvedRooms() {
+    std::set<std::string> solved;
+    std::ifstream in(fromBase(PROGRESS_FILE));
+    std::string id;
+    while (in >> id) solved.insert(id);
+    return solved;
+}
+
+struct MapLabel {
+    SDL_Texture* texture;
+    SDL_Rect rect;
+};
+
+static MapLabel makeLabel(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color, int centerX, int y) {
+    MapLabel label = {nullptr, {centerX, y, 0, 0}};
+    SDL_Surface* surface = TTF_RenderText_Blended(font, text.c_str(), color);
+    if (!surface) return label;
+    label.texture = SDL_CreateTextureFromSurface(renderer, surface);
+    label.rect = {centerX - surface->w / 2, y, surface->w, surface->h};
+    SDL_FreeSurface(surface);
+    return label;
+}
+
+// The open map: what was solved when it opened, and its captions, which
+// only change when it is reopened and so are rendered once.
+static std::set<std::string> mapSolved;
+static std::vector<MapLabel> mapLabels;
+static std::vector<SDL_Rect> mapCells;
+
+void openRoomMap(SDL_Renderer* renderer, TTF_Font* font) {
+    closeRoomMap();
+    acquireAtlas(renderer);
+    mapSolved = loadSolvedRooms();
+
+    int outW = 0, outH = 0;
+    SDL_GetRendererOutputSize(renderer, &outW, &outH);
+    const int gapX = (outW - ATLAS_COLS * THUMB_W) / (ATLAS_COLS + 1);
+    const int top = 180;
+    const int rowStride = THUMB_H + 110;
+
+    mapLabels.push_back(makeLabel(renderer, font, "Map", {255, 255, 255, 255}, outW / 2, 60));
+    mapLabels.push_back(makeLabel(renderer, font, "Press ESC to return", {180, 180, 180, 255}, outW / 2, outH - 100));
+    for (size_t i = 0; i < ROOMS.size(); ++i) {
+        int col = (int)(i % ATLAS_COLS), row = (int)(i / ATLAS_COLS);
+        SDL_Rect cell = {gapX + col * (THUMB_W + gapX), top + row * rowStride, THUMB_W, THUMB_H};
+        mapCells.push_back(cell);
+        bool done = mapSolved.count(ROOMS[i].id) > 0;
+        int centerX = cell.x + THUMB_W / 2;
+        mapLabels.push_back(makeLabel(renderer, font, ROOMS[i].label, {255, 255, 0, 255}, centerX, cell.y + THUMB_H + 4));
+        mapLabels.push_back(makeLabel(renderer, font, done ? "Solved" : "Unsolved",
+                                      done ? SDL_Color{50, 255, 100, 255} : SDL_Color{255, 60, 60, 255},
+                                      centerX, cell.y + THUMB_H + 48));
+    }
+}
+
+void drawRoomMap(SDL_Renderer* renderer) {
+    SDL_SetRenderDrawColor(renderer, 20, 20, 20, 255);
+    SDL_RenderClear(renderer);
+
+    // All thumbnails are sub-rectangles of the same texture.
+    for (size_t i = 0; i < mapCells.size(); ++i) {
+        SDL_Rect src = cellRect(i);
+        if (atlasTexture) SDL_RenderCopy(renderer, atlasTexture, &src, &mapCells[i]);
+    }
+    for (size_t i = 0; i < mapCells.size(); ++i) {
+        bool done = mapSolved.count(ROOMS[i].id) > 0;
+        SDL_SetRenderDrawColor(renderer, done ? 50 : 255, done ? 255 : 60, done ? 100 : 60, 255);
+        for (int t = 0; t < 3; ++t) {
+            SDL_Rect border = {mapCells[i].x - t, mapCells[i].y - t, mapCells[i].w + 2 * t, mapCells[i].h + 2 * t};
+            SDL_RenderDrawRect(renderer, &border);
+        }
+    }
+    for (auto& label : mapLabels) {
+        if (label.texture) SDL_RenderCopy(renderer, label.texture, nullptr, &label.rect);
+    }
+}
+
+void closeRoomMap() {
+    for (auto& label : mapLabels) {
+        if (label.texture) SDL_DestroyTexture(label.texture);
+    }
+    mapLabels.clear();
+    mapCells.clear();
+    mapSolved.clear();
+}
+
+void releaseRoomMap() {
+    closeRoomMap();
+    if (atlasTexture) SDL_DestroyTexture(atlasTexture);
+    atlasTexture = nullptr;
+    atlasEntries.clear();
+}
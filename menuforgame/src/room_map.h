@@ -0,0 +1,19 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+// Map screen listing every room with its solved/unsolved status.
+// Thumbnails come from a single atlas texture that is cached on disk in
+// map_cache/ and only rebuilt for rooms whose artwork changed.
+// Room artwork, map_cache/ and progress.txt are found relative to the menu
+// executable, which has to stay in menuforgame/ beside the room directories.
+// openRoomMap() reads progress and renders the captions, drawRoomMap() draws
+// a frame of it from the caller's loop, closeRoomMap() frees the captions.
+void openRoomMap(SDL_Renderer* renderer, TTF_Font* font);
+void drawRoomMap(SDL_Renderer* renderer);
+void closeRoomMap();
+
+// Frees the map and the in-memory atlas texture; call before destroying the
+// renderer.
+void releaseRoomMap();
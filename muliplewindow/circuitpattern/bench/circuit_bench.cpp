@@ -0,0 +1,179 @@
+// Timing for the circuit maze generator, solver, path rules and circuit
+// simulation.
+// Builds without SFML (`make bench`) and prints one JSON document on stdout:
+//
+//   ./circuit_bench [repeats] > bench.json
+#include "../circuit_grid.h"
+#include "../circuit_layout.h"
+#include "../circuit_rules.h"
+#include "../circuit_sim.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct JsonRows {
+    std::vector<std::string> rows;
+    void add(const std::string& row) { rows.push_back(row); }
+    std::string join() const {
+        std::string out;
+        for (size_t i = 0; i < rows.size(); ++i) out += (i ? ",\n    " : "\n    ") + rows[i];
+        return out + "\n  ";
+    }
+};
+
+static void benchGenerate(int size, double loopChance, int repeats, JsonRows& rows) {
+    typedef std::chrono::steady_clock Clock;
+    double generate = 0, solve = 0, worst = 0;
+    size_t pathLength = 0, conductive = 0, bytes = 0;
+    for (int seed = 1; seed <= repeats; ++seed) {
+        CircuitOptions options;
+        options.rows = options.cols = size;
+        options.seed = seed;
+        options.loopChance = loopChance;
+        auto t0 = Clock::now();
+        CircuitLayout layout = generateCircuit(options);
+        auto t1 = Clock::now();
+        std::vector<int> path = solveCircuit(layout);
+        auto t2 = Clock::now();
+        double g = std::chrono::duration<double>(t1 - t0).count();
+        double s = std::chrono::duration<double>(t2 - t1).count();
+        generate += g;
+        solve += s;
+        worst = std::max(worst, g + s);
+        pathLength = path.size();
+        conductive = 0;
+        for (int cell = 0; cell < layout.rows * layout.cols; ++cell) conductive += layout.conductive(cell);
+        bytes = 3 * layout.typeBits[0].bytes();
+    }
+    std::ostringstream row;
+    row << "{\"rows\": " << size << ", \"cols\": " << size << ", \"loop_chance\": " << loopChance
+        << ", \"generate_ms\": " << generate / repeats * 1e3 << ", \"solve_ms\": " << solve / repeats * 1e3
+        << ", \"worst_total_ms\": " << worst * 1e3 << ", \"path_length\": " << pathLength
+        << ", \"conductive_tiles\": " << conductive << ", \"layout_bytes\": " << bytes << "}";
+    rows.add(row.str());
+}
+
+// Path-rule costs: every conductive tile is clicked in breadth-first order
+// from START, so each click is legal and most of them are branches off the
+// route. Reports the time per click and how many it took to close the circuit.
+static void benchRules(int size, double loopChance, JsonRows& rows) {
+    typedef std::chrono::steady_clock Clock;
+    CircuitOptions options;
+    options.rows = options.cols = size;
+    options.loopChance = loopChance;
+    CircuitLayout layout = generateCircuit(options);
+    CircuitGrid grid(layout);
+
+    CircuitRules rules;
+    auto t0 = Clock::now();
+    rules.build(layout);
+    auto t1 = Clock::now();
+
+    std::vector<int> order;
+    std::vector<char> queued(size_t(size) * size, 0);
+    order.push_back(layout.start);
+    queued[layout.start] = 1;
+    const int steps[4] = {-size, size, -1, 1};
+    const uint8_t links[4] = {LINK_UP, LINK_DOWN, LINK_LEFT, LINK_RIGHT};
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (int d = 0; d < 4; ++d) {
+            int next = order[i] + steps[d];
+            if ((rules.links(order[i]) & links[d]) && !queued[next]) {
+                queued[next] = 1;
+                order.push_back(next);
+            }
+        }
+    }
+
+    long closedAt = -1, rejected = 0;
+    auto t2 = Clock::now();
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (!rules.canVisit(grid, order[i])) {
+            ++rejected;
+            continue;
+        }
+        if (rules.visit(grid, order[i]) && closedAt < 0) closedAt = long(i) + 1;
+    }
+    auto t3 = Clock::now();
+
+    std::ostringstream row;
+    row << "{\"rows\": " << size << ", \"cols\": " << size << ", \"loop_chance\": " << loopChance
+        << ", \"build_ms\": " << std::chrono::duration<double>(t1 - t0).count() * 1e3
+        << ", \"clicks\": " << order.size() << ", \"rejected\": " << rejected
+        << ", \"closed_after\": " << closedAt
+        << ", \"click_ns\": " << std::chrono::duration<double>(t3 - t2).count() * 1e9 / order.size() << "}";
+    rows.add(row.str());
+}
+
+// Simulation costs: building the MNA system, a cold DC solve, warm
+// transient steps, and an edit (one tile swapped) followed by a step.
+static void benchSimulate(int size, double loopChance, JsonRows& rows) {
+    typedef std::chrono::steady_clock Clock;
+    const TileType PARTS[] = {WIRE, RESISTOR, DIODE, CAPACITOR, BATTERY};
+    const int STEPS = 60, EDITS = 50;
+    CircuitOptions options;
+    options.rows = options.cols = size;
+    options.loopChance = loopChance;
+    CircuitLayout layout = generateCircuit(options);
+
+    CircuitSim sim;
+    auto t0 = Clock::now();
+    sim.build(layout);
+    auto t1 = Clock::now();
+    sim.solveSteady();
+    auto t2 = Clock::now();
+    int coldIterations = sim.lastIterations();
+    for (int i = 0; i < STEPS; ++i) sim.step(1.0 / 60);
+    auto t3 = Clock::now();
+    const std::vector<int>& cells = sim.componentCells();
+    long refactored = 0, iterations = 0;
+    for (int i = 0; i < EDITS; ++i) {
+        sim.setType(cells[(size_t(i) * 7919) % cells.size()], PARTS[i % 5]);
+        sim.step(1.0 / 60);
+        refactored += sim.matrix().lastRefactored();
+        iterations += sim.lastIterations();
+    }
+    auto t4 = Clock::now();
+
+    std::ostringstream row;
+    row << "{\"rows\": " << size << ", \"cols\": " << size << ", \"loop_chance\": " << loopChance
+        << ", \"unknowns\": " << sim.matrix().size() << ", \"factor_entries\": " << sim.matrix().factorEntries()
+        << ", \"build_ms\": " << std::chrono::duration<double>(t1 - t0).count() * 1e3
+        << ", \"cold_solve_ms\": " << std::chrono::duration<double>(t2 - t1).count() * 1e3
+        << ", \"cold_newton_iterations\": " << coldIterations
+        << ", \"step_ms\": " << std::chrono::duration<double>(t3 - t2).count() * 1e3 / STEPS
+        << ", \"edit_step_ms\": " << std::chrono::duration<double>(t4 - t3).count() * 1e3 / EDITS
+        << ", \"edit_refactored_columns\": " << refactored / EDITS
+        << ", \"edit_newton_iterations\": " << double(iterations) / EDITS << "}";
+    rows.add(row.str());
+}
+
+int main(int argc, char* argv[]) {
+    int repeats = argc > 1 ? std::max(1, std::stoi(argv[1])) : 5;
+    JsonRows generate;
+    for (int size : {6, 12, 100, 500, 1000}) {
+        benchGenerate(size, 0.0, repeats, generate);
+        benchGenerate(size, 0.05, repeats, generate);
+    }
+    JsonRows rules;
+    for (int size : {12, 100, 1000}) {
+        benchRules(size, 0.0, rules);
+        benchRules(size, 0.05, rules);
+    }
+    JsonRows simulate;
+    for (int size : {12, 50, 100, 300}) {
+        benchSimulate(size, 0.0, simulate);
+        benchSimulate(size, 0.05, simulate);
+    }
+    std::cout << "{\n"
+              << "  \"benchmark\": \"circuit_maze\",\n"
+              << "  \"repeats\": " << repeats << ",\n"
+              << "  \"generate\": [" << generate.join() << "],\n"
+              << "  \"rules\": [" << rules.join() << "],\n"
+              << "  \"simulate\": [" << simulate.join() << "]\n"
+              << "}\n";
+    return 0;
+}
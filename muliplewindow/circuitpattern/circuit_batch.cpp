@@ -0,0 +1,198 @@
+#include "circuit_batch.h"
+#include <algorithm>
+#include <cmath>
+
+static void setQuad(sf::Vertex* quad, float left, float top, float right, float bottom, sf::Color color) {
+    quad[0] = sf::Vertex(sf::Vector2f(left, top), color);
+    quad[1] = sf::Vertex(sf::Vector2f(right, top), color);
+    quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color);
+    quad[3] = sf::Vertex(sf::Vector2f(left, bottom), color);
+}
+
+// Colour of each TileFill; flow levels fade from clear to amber.
+static sf::Color fillColor(uint8_t fill) {
+    if (fill == FILL_VISITED) return sf::Color(0, 255, 0, 100);
+    if (fill == FILL_WRONG) return sf::Color(255, 0, 0, 100);
+    if (fill > FILL_FLOW) return sf::Color(255, 200, 0, (fill - FILL_FLOW) * 160 / FLOW_LEVELS);
+    return sf::Color::Transparent;
+}
+
+void CircuitBatch::build(const CircuitGrid& grid, float size, const sf::Font& labelFont) {
+    rows = grid.rows();
+    cols = grid.cols();
+    tileSize = size;
+    font = &labelFont;
+    hovered = -1;
+
+    // Every tile used to carry a white outline, so the grid is just lines.
+    const float line = std::min(2.0f, tileSize / 4);
+    const float width = cols * tileSize, height = rows * tileSize;
+    tiles.setPrimitiveType(sf::Quads);
+    tiles.resize(size_t(rows + cols + 2 + 4) * 4);
+    size_t v = 0;
+    for (int r = 0; r <= rows; ++r, v += 4)
+        setQuad(&tiles[v], 0, r * tileSize - line, width, r * tileSize, sf::Color::White);
+    for (int c = 0; c <= cols; ++c, v += 4)
+        setQuad(&tiles[v], c * tileSize - line, 0, c * tileSize, height, sf::Color::White);
+    hoverOffset = v;
+    for (int i = 0; i < 16; ++i) tiles[hoverOffset + i] = sf::Vertex();
+
+    fills.setPrimitiveType(sf::Quads);
+    fills.clear();
+    fillCells.clear();
+    fillRowStart.assign(rows + 1, 0);
+    fillsSorted = true;
+    fillVertex.assign(size_t(rows) * cols, -1);
+
+    labels.setPrimitiveType(sf::Quads);
+    labels.clear();
+    labelRowStart.assign(rows + 1, 0);
+    labelCol.clear();
+    for (int r = 0; r < rows; ++r) {
+        labelRowStart[r] = int(labelCol.size());
+        for (int c = 0; c < cols; ++c) {
+            TileType type = grid.type(r * cols + c);
+            if (!*tileSymbol(type)) continue;
+            labels.resize(labels.getVertexCount() + 4);
+            writeLabel(labelCol.size(), r * cols + c, type);
+            labelCol.push_back(c);
+        }
+    }
+    labelRowStart[rows] = int(labelCol.size());
+    for (int cell = 0; cell < grid.size(); ++cell)
+        if (grid.fill(cell) != FILL_NONE) setFill(cell, grid.fill(cell));
+}
+
+void CircuitBatch::sync(CircuitGrid& grid) {
+    grid.takeChanged(changed);
+    for (int cell : changed) {
+        setFill(cell, grid.fill(cell));
+        setLabel(cell, grid.type(cell));
+    }
+}
+
+void CircuitBatch::writeLabel(size_t label, int cell, TileType type) {
+    // Labels used to be tileSize / 5 points; texture coordinates are in
+    // atlas pixels, so they stay valid if the atlas grows.
+    const float scale = tileSize / 5 / LABEL_SIZE;
+    const sf::Glyph& glyph = font->getGlyph(sf::Uint32(*tileSymbol(type)), LABEL_SIZE, false);
+    // Same placement as an sf::Text at (tile + 10%, tile + 35%).
+    float x = (cell % cols) * tileSize + tileSize / 10 + glyph.bounds.left * scale;
+    float y = (cell / cols) * tileSize + tileSize * 0.35f + (LABEL_SIZE + glyph.bounds.top) * scale;
+    float w = glyph.bounds.width * scale, h = glyph.bounds.height * scale;
+    const sf::IntRect& uv = glyph.textureRect;
+    sf::Vertex* quad = &labels[label * 4];
+    sf::Color color = quad[0].color;
+    quad[0] = sf::Vertex(sf::Vector2f(x, y), color, sf::Vector2f(uv.left, uv.top));
+    quad[1] = sf::Vertex(sf::Vector2f(x + w, y), color, sf::Vector2f(uv.left + uv.width, uv.top));
+    quad[2] = sf::Vertex(sf::Vector2f(x + w, y + h), color, sf::Vector2f(uv.left + uv.width, uv.top + uv.height));
+    quad[3] = sf::Vertex(sf::Vector2f(x, y + h), color, sf::Vector2f(uv.left, uv.top + uv.height));
+}
+
+void CircuitBatch::setFill(int cell, uint8_t fill) {
+    int v = fillVertex[cell];
+    if (v < 0) {
+        if (fill == FILL_NONE) return;
+        v = fillVertex[cell] = int(fills.getVertexCount());
+        fills.resize(v + 4);
+        fillCells.push_back(cell);
+        fillsSorted = false;
+    }
+    float x = (cell % cols) * tileSize, y = (cell / cols) * tileSize;
+    setQuad(&fills[v], x, y, x + tileSize - 2, y + tileSize - 2, fillColor(fill));
+}
+
+// Cells only ever gain a fill quad, so this runs when a click or the first
+// simulation frame adds some, not every frame.
+void CircuitBatch::sortFills() {
+    std::vector<int> sortedCells = fillCells;
+    std::sort(sortedCells.begin(), sortedCells.end());
+    sf::VertexArray sorted(sf::Quads, fills.getVertexCount());
+    for (size_t i = 0; i < sortedCells.size(); ++i) {
+        int cell = sortedCells[i];
+        for (int k = 0; k < 4; ++k) sorted[i * 4 + k] = fills[fillVertex[cell] + k];
+        fillVertex[cell] = int(i * 4);
+    }
+    fills = sorted;
+    fillCells.swap(sortedCells);
+    for (int r = 0; r <= rows; ++r)
+        fillRowStart[r] = int(std::lower_bound(fillCells.begin(), fillCells.end(), r * cols) - fillCells.begin());
+    fillsSorted = true;
+}
+
+void CircuitBatch::setLabel(int cell, TileType type) {
+    if (!*tileSymbol(type)) return;
+    int row = cell / cols, col = cell % cols;
+    const int* begin = labelCol.data() + labelRowStart[row];
+    const int* end = labelCol.data() + labelRowStart[row + 1];
+    const int* at = std::lower_bound(begin, end, col);
+    if (at == end || *at != col) return;
+    writeLabel(size_t(at - labelCol.data()), cell, type);
+}
+
+void CircuitBatch::setHover(int cell) {
+    if (cell == hovered) return;
+    hovered = cell;
+    sf::Vertex* quads = &tiles[hoverOffset];
+    if (cell < 0) {
+        for (int i = 0; i < 16; ++i) quads[i] = sf::Vertex();
+        return;
+    }
+    // A 3px cyan outline around the tile's fill area.
+    const float t = 3;
+    float left = (cell % cols) * tileSize, top = (cell / cols) * tileSize;
+    float right = left + tileSize - 2, bottom = top + tileSize - 2;
+    setQuad(quads, left - t, top - t, right + t, top, sf::Color::Cyan);
+    setQuad(quads + 4, left - t, bottom, right + t, bottom + t, sf::Color::Cyan);
+    setQuad(quads + 8, left - t, top, left, bottom, sf::Color::Cyan);
+    setQuad(quads + 12, right, top, right + t, bottom, sf::Color::Cyan);
+}
+
+int CircuitBatch::cellAt(sf::Vector2f point) const {
+    if (point.x < 0 || point.y < 0) return -1;
+    int col = int(point.x / tileSize), row = int(point.y / tileSize);
+    if (col >= cols || row >= rows) return -1;
+    return row * cols + col;
+}
+
+void CircuitBatch::drawLabels(sf::RenderTarget& target, int first, int last, sf::Color color, const sf::RenderStates& states) {
+    if (first >= last) return;
+    // The glow tints every label, but only the visible ones need recolouring.
+    for (size_t v = size_t(first) * 4; v < size_t(last) * 4; ++v) labels[v].color = color;
+    target.draw(&labels[size_t(first) * 4], size_t(last - first) * 4, sf::Quads, states);
+}
+
+void CircuitBatch::draw(sf::RenderTarget& target, sf::Color labelColor) {
+    const sf::View& view = target.getView();
+    const sf::Vector2f center = view.getCenter(), size = view.getSize();
+    int c0 = std::max(0, int(std::floor((center.x - size.x / 2) / tileSize)));
+    int c1 = std::min(cols, int(std::ceil((center.x + size.x / 2) / tileSize)));
+    int r0 = std::max(0, int(std::floor((center.y - size.y / 2) / tileSize)));
+    int r1 = std::min(rows, int(std::ceil((center.y + size.y / 2) / tileSize)));
+    if (c0 >= c1 || r0 >= r1) return;
+
+    // The lines bordering the rows and columns in view, the hover outline,
+    // then the fills of the rows in view.
+    target.draw(&tiles[size_t(r0) * 4], size_t(r1 - r0 + 1) * 4, sf::Quads);
+    target.draw(&tiles[size_t(rows + 1 + c0) * 4], size_t(c1 - c0 + 1) * 4, sf::Quads);
+    if (hovered >= 0) target.draw(&tiles[hoverOffset], 16, sf::Quads);
+    if (!fillsSorted) sortFills();
+    if (fillRowStart[r1] > fillRowStart[r0])
+        target.draw(&fills[size_t(fillRowStart[r0]) * 4], size_t(fillRowStart[r1] - fillRowStart[r0]) * 4, sf::Quads);
+
+    float screenTile = tileSize * target.getSize().y * view.getViewport().height / size.y;
+    if (screenTile < MIN_LABEL_PIXELS) return;
+
+    sf::RenderStates states(&font->getTexture(LABEL_SIZE));
+    if (c0 == 0 && c1 == cols) {
+        drawLabels(target, labelRowStart[r0], labelRowStart[r1], labelColor, states);
+        return;
+    }
+    for (int r = r0; r < r1; ++r) {
+        const int* rowBegin = labelCol.data() + labelRowStart[r];
+        const int* rowEnd = labelCol.data() + labelRowStart[r + 1];
+        int first = int(std::lower_bound(rowBegin, rowEnd, c0) - labelCol.data());
+        int last = int(std::lower_bound(rowBegin, rowEnd, c1) - labelCol.data());
+        drawLabels(target, first, last, labelColor, states);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "circuit_grid.h"
+
+// Draws a CircuitGrid with a handful of draw calls instead of two per tile.
+// Grid lines and the hover outline live in one vertex array, fills in a
+// second and the labels, cut from the font's glyph atlas, in a third. Fills
+// and labels are kept row by row, so draw() only submits the rows in view.
+// The grid stays the model; sync() rewrites vertices only for the tiles it
+// reports changed.
+class CircuitBatch {
+public:
+    // Labels are rasterised once at this size and scaled to the tile.
+    static const unsigned LABEL_SIZE = 20;
+    // Below this many screen pixels per tile, labels are not drawn.
+    static constexpr float MIN_LABEL_PIXELS = 12.0f;
+
+    // font must outlive the batch.
+    void build(const CircuitGrid& grid, float tileSize, const sf::Font& font);
+
+    // Picks up the types and fills the grid changed since the last sync.
+    void sync(CircuitGrid& grid);
+
+    // Moves the hover outline to cell, or hides it for -1.
+    void setHover(int cell);
+
+    // Cell under a point in grid coordinates, or -1 outside the grid.
+    int cellAt(sf::Vector2f point) const;
+
+    // Draws the part of the grid inside the target's current view, with the
+    // labels tinted labelColor.
+    void draw(sf::RenderTarget& target, sf::Color labelColor);
+
+private:
+    void drawLabels(sf::RenderTarget& target, int first, int last, sf::Color color, const sf::RenderStates& states);
+    void writeLabel(size_t label, int cell, TileType type);
+    void setFill(int cell, uint8_t fill);
+    void setLabel(int cell, TileType type);
+    void sortFills();
+
+    int rows = 0;
+    int cols = 0;
+    float tileSize = 0;
+    const sf::Font* font = nullptr;
+    int hovered = -1;
+
+    // rows + 1 horizontal grid lines, cols + 1 vertical ones, then the 4
+    // hover quads at hoverOffset.
+    sf::VertexArray tiles;
+    size_t hoverOffset = 0;
+
+    // One quad per tile that has had a fill. New ones are appended and put
+    // back in row order before the next draw; fillRowStart[r] is then the
+    // first fill of row r.
+    sf::VertexArray fills;
+    std::vector<int> fillCells;   // cell of each fill
+    std::vector<int> fillRowStart;
+    bool fillsSorted = true;
+    std::vector<int> fillVertex;  // cell -> first vertex of its fill, or -1
+    std::vector<int> changed;
+
+    // One quad per labelled tile, row by row. labelRowStart[r] is the first
+    // label of row r and labelCol holds each label's column, so a view can
+    // be culled to a few contiguous ranges.
+    sf::VertexArray labels;
+    std::vector<int> labelRowStart;
+    std::vector<int> labelCol;
+};
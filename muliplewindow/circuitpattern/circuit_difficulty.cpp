@@ -0,0 +1,262 @@
+#include "circuit_difficulty.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Frontier plugs, two bits per position. A path piece crossing the frontier
+// is either one half of a segment whose ends both cross it (OPEN and CLOSE,
+// matched like brackets) or a TAIL whose other end is START or END.
+enum Plug : uint64_t { PLUG_NONE = 0, PLUG_OPEN = 1, PLUG_CLOSE = 2, PLUG_TAIL = 3 };
+
+// Below this many states a step is not worth handing to other threads.
+const size_t PARALLEL_STATES = 4096;
+
+typedef std::pair<uint64_t, double> State;
+
+static uint64_t plugAt(uint64_t state, int pos) { return (state >> (2 * pos)) & 3; }
+static uint64_t withPlug(uint64_t state, int pos, uint64_t plug) {
+    return (state & ~(3ULL << (2 * pos))) | plug << (2 * pos);
+}
+
+// Position of the bracket matching the one at pos.
+static int matchOf(uint64_t state, int pos) {
+    const bool open = plugAt(state, pos) == PLUG_OPEN;
+    int depth = 0;
+    for (int p = pos;; p += open ? 1 : -1) {
+        uint64_t plug = plugAt(state, p);
+        if (plug == PLUG_OPEN) depth += open ? 1 : -1;
+        else if (plug == PLUG_CLOSE) depth += open ? -1 : 1;
+        if (depth == 0) return p;
+    }
+}
+
+// The layout seen along its narrower side, so the frontier stays short.
+struct Board {
+    int rows = 0, cols = 0;
+    std::vector<uint8_t> kind;  // 0 wall, 1 corridor, 2 START or END
+
+    int at(int row, int col) const { return kind[size_t(row) * cols + col]; }
+};
+
+static Board makeBoard(const CircuitLayout& layout) {
+    Board board;
+    const bool transpose = layout.cols > layout.rows;
+    board.rows = transpose ? layout.cols : layout.rows;
+    board.cols = transpose ? layout.rows : layout.cols;
+    board.kind.resize(size_t(board.rows) * board.cols);
+    for (int row = 0; row < board.rows; ++row) {
+        for (int col = 0; col < board.cols; ++col) {
+            int cell = transpose ? col * layout.cols + row : row * layout.cols + col;
+            TileType type = layout.typeAt(cell);
+            board.kind[size_t(row) * board.cols + col] = type == EMPTY ? 0 : (type == START || type == END) ? 2 : 1;
+        }
+    }
+    return board;
+}
+
+// Every way of laying path through cell (row, col), given the plugs coming
+// in from the left (position col) and from above (position col + 1).
+// Finished paths go to done instead of out.
+template <typename Emit>
+static void stepCell(const Board& board, int row, int col, uint64_t state, double ways, Emit emit, double& done) {
+    const uint64_t left = plugAt(state, col), up = plugAt(state, col + 1);
+    const int kind = board.at(row, col);
+    const bool canDown = row + 1 < board.rows && board.at(row + 1, col) != 0;
+    const bool canRight = col + 1 < board.cols && board.at(row, col + 1) != 0;
+    const uint64_t cleared = withPlug(withPlug(state, col, PLUG_NONE), col + 1, PLUG_NONE);
+    // Both plugs set: the cell is used and nothing else may leave it.
+    auto finish = [&](uint64_t next) {
+        if (next == 0) done += ways;
+    };
+    auto leave = [&](uint64_t plug) {
+        if (canDown) emit(withPlug(cleared, col, plug), ways);
+        if (canRight) emit(withPlug(cleared, col + 1, plug), ways);
+    };
+
+    if (kind == 0) {
+        if (!left && !up) emit(cleared, ways);
+        return;
+    }
+    if (kind == 2) {
+        // START or END: exactly one way in or out.
+        if (!left && !up) {
+            leave(PLUG_TAIL);
+        } else if (!left || !up) {
+            uint64_t plug = left | up;
+            int pos = left ? col : col + 1;
+            if (plug == PLUG_TAIL) finish(cleared);
+            else emit(withPlug(cleared, matchOf(state, pos), PLUG_TAIL), ways);
+        }
+        return;
+    }
+
+    if (!left && !up) {
+        emit(cleared, ways);
+        if (canDown && canRight) emit(withPlug(withPlug(cleared, col, PLUG_OPEN), col + 1, PLUG_CLOSE), ways);
+    } else if (!left || !up) {
+        leave(left | up);
+    } else if (left == PLUG_TAIL && up == PLUG_TAIL) {
+        finish(cleared);
+    } else if (left == PLUG_TAIL || up == PLUG_TAIL) {
+        // The bracket's partner becomes the tail's new end.
+        int pos = left == PLUG_TAIL ? col + 1 : col;
+        emit(withPlug(cleared, matchOf(state, pos), PLUG_TAIL), ways);
+    } else if (left == PLUG_OPEN && up == PLUG_OPEN) {
+        emit(withPlug(cleared, matchOf(state, col + 1), PLUG_OPEN), ways);
+    } else if (left == PLUG_CLOSE && up == PLUG_CLOSE) {
+        emit(withPlug(cleared, matchOf(state, col), PLUG_CLOSE), ways);
+    } else if (left == PLUG_CLOSE && up == PLUG_OPEN) {
+        emit(cleared, ways);
+    }
+    // OPEN then CLOSE would close a loop off from the path.
+}
+
+// Advances every state over one cell. The input is cut into one slice per
+// thread; each thread files its results into per-thread shards by key, and
+// then each thread merges one shard from all of them.
+static void advance(const Board& board, int row, int col, std::vector<State>& states, unsigned threads,
+                    double& done) {
+    const unsigned parts = states.size() < PARALLEL_STATES ? 1 : threads;
+    std::vector<std::vector<std::vector<State>>> shards(parts, std::vector<std::vector<State>>(parts));
+    std::vector<double> finished(parts, 0.0);
+    std::vector<std::vector<State>> merged(parts);
+
+    auto expand = [&](unsigned part) {
+        size_t begin = states.size() * part / parts, end = states.size() * (part + 1) / parts;
+        std::vector<std::vector<State>>& out = shards[part];
+        for (size_t i = begin; i < end; ++i) {
+            stepCell(board, row, col, states[i].first, states[i].second,
+                     [&](uint64_t next, double ways) { out[(next * 0x9E3779B97F4A7C15ULL >> 32) % parts].push_back(State(next, ways)); },
+                     finished[part]);
+        }
+    };
+    auto merge = [&](unsigned shard) {
+        std::unordered_map<uint64_t, double> sums;
+        for (unsigned part = 0; part < parts; ++part)
+            for (const State& s : shards[part][shard]) sums[s.first] += s.second;
+        merged[shard].assign(sums.begin(), sums.end());
+    };
+    auto runAll = [&](auto job) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < parts; ++t) pool.emplace_back(job, t);
+        job(0u);
+        for (std::thread& t : pool) t.join();
+    };
+    runAll(expand);
+    runAll(merge);
+
+    states.clear();
+    for (unsigned part = 0; part < parts; ++part) {
+        done += finished[part];
+        states.insert(states.end(), merged[part].begin(), merged[part].end());
+    }
+}
+
+static double countCompletions(const Board& board, unsigned threads, size_t& peakStates) {
+    // cols + 1 plugs of two bits; at MAX_RATED_WIDTH they fill the word.
+    const int frontierBits = 2 * (board.cols + 1);
+    const uint64_t frontier = frontierBits >= 64 ? ~0ULL : (1ULL << frontierBits) - 1;
+    std::vector<State> states(1, State(0, 1.0));
+    double done = 0;
+    peakStates = 1;
+    for (int row = 0; row < board.rows; ++row) {
+        // The last column's right plug is always empty, so shifting moves
+        // each down plug into the position of the next row's up plug.
+        for (State& s : states) s.first = (s.first << 2) & frontier;
+        for (int col = 0; col < board.cols; ++col) {
+            advance(board, row, col, states, threads, done);
+            peakStates = std::max(peakStates, states.size());
+            if (states.empty()) return done;
+        }
+    }
+    return done;
+}
+
+// Peels off dead ends: tiles other than START and END left with a single
+// conductive neighbour, repeatedly. What remains lies on some completion
+// (for the mazes generateCircuit builds, where every tile is reachable).
+static void countDeadEnds(const CircuitLayout& layout, CircuitDifficulty& rating) {
+    const int rows = layout.rows, cols = layout.cols;
+    const int cells = rows * cols;
+    std::vector<int> degree(cells, 0);
+    std::vector<char> peeled(cells, 0);
+    auto neighbours = [&](int cell, auto visit) {
+        int row = cell / cols, col = cell % cols;
+        if (row > 0 && layout.conductive(cell - cols)) visit(cell - cols);
+        if (row + 1 < rows && layout.conductive(cell + cols)) visit(cell + cols);
+        if (col > 0 && layout.conductive(cell - 1)) visit(cell - 1);
+        if (col + 1 < cols && layout.conductive(cell + 1)) visit(cell + 1);
+    };
+    std::vector<int> leaves;
+    for (int cell = 0; cell < cells; ++cell) {
+        if (!layout.conductive(cell)) continue;
+        neighbours(cell, [&](int) { ++degree[cell]; });
+        if (degree[cell] <= 1 && cell != layout.start && cell != layout.end) leaves.push_back(cell);
+    }
+    while (!leaves.empty()) {
+        int cell = leaves.back();
+        leaves.pop_back();
+        if (peeled[cell]) continue;
+        peeled[cell] = 1;
+        ++rating.deadEndTiles;
+        neighbours(cell, [&](int next) {
+            if (!peeled[next] && --degree[next] <= 1 && next != layout.start && next != layout.end)
+                leaves.push_back(next);
+        });
+    }
+    for (int cell = 0; cell < cells; ++cell) {
+        if (!layout.conductive(cell) || peeled[cell]) continue;
+        neighbours(cell, [&](int next) { rating.deadEnds += peeled[next]; });
+    }
+}
+
+bool rateCircuit(const CircuitLayout& layout, CircuitDifficulty& rating, unsigned threads) {
+    rating = CircuitDifficulty();
+    if (std::min(layout.rows, layout.cols) > MAX_RATED_WIDTH) {
+        std::cerr << "Cannot rate a " << layout.rows << "x" << layout.cols << " circuit: narrower side over "
+                  << MAX_RATED_WIDTH << " tiles\n";
+        return false;
+    }
+    rating.routeLength = int(solveCircuit(layout).size());
+    if (rating.routeLength == 0) {
+        std::cerr << "Cannot rate circuit " << layout.seed << ": END is not reachable\n";
+        return false;
+    }
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    rating.completions = countCompletions(makeBoard(layout), threads, rating.peakStates);
+    if (rating.completions == 0) {
+        // END is reachable, so there is at least one path; not finding it
+        // means the count went wrong, and the score would be infinite.
+        std::cerr << "Cannot rate circuit " << layout.seed << ": no completions counted\n";
+        return false;
+    }
+    countDeadEnds(layout, rating);
+    rating.score = std::log2((1.0 + rating.deadEnds) * (1.0 + rating.deadEndTiles) / rating.completions);
+    return true;
+}
+
+CircuitLayout generateCircuitInBand(CircuitOptions options, double minScore, double maxScore, int attempts,
+                                    CircuitDifficulty* rating) {
+    CircuitLayout best;
+    CircuitDifficulty bestRating;
+    double bestMiss = -1;
+    for (int attempt = 0; attempt < std::max(1, attempts); ++attempt, ++options.seed) {
+        CircuitLayout layout = generateCircuit(options);
+        CircuitDifficulty current;
+        if (!rateCircuit(layout, current)) continue;
+        double miss = std::max(0.0, std::max(minScore - current.score, current.score - maxScore));
+        if (bestMiss < 0 || miss < bestMiss) {
+            best = std::move(layout);
+            bestRating = current;
+            bestMiss = miss;
+        }
+        if (miss == 0) break;
+    }
+    if (rating) *rating = bestRating;
+    return best;
+}
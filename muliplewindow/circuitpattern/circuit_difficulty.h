@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include "circuit_layout.h"
+
+// How hard a layout is to solve by hand.
+//
+// Completions are the distinct simple START-to-END paths through the
+// conductive tiles (any of them closes the circuit under CircuitRules).
+// They are counted by broken-profile dynamic programming: cells are taken
+// row by row, and the state is the set of path pieces crossing the
+// frontier, two bits per column. Each cell's step is split across threads.
+//
+// Dead-end branches are the places where a tile that lies on some
+// completion touches one that lies on none; deadEndTiles is how many tiles
+// lie on none.
+struct CircuitDifficulty {
+    // Exact up to 2^53; only grids with loops get anywhere near that.
+    double completions = 0;
+    int deadEnds = 0;
+    int deadEndTiles = 0;
+    int routeLength = 0;  // shortest completion, in tiles
+    size_t peakStates = 0;
+    // log2((1 + deadEnds) * (1 + deadEndTiles) / completions): more and
+    // longer wrong turns make a layout harder, more ways through make it
+    // easier.
+    double score = 0;
+};
+
+// The narrower side of the layout must be at most MAX_RATED_WIDTH tiles.
+const int MAX_RATED_WIDTH = 31;
+
+// False (with a message on std::cerr) if the layout is too wide or not
+// solvable. threads = 0 uses every hardware thread.
+bool rateCircuit(const CircuitLayout& layout, CircuitDifficulty& rating, unsigned threads = 0);
+
+// Tries up to attempts seeds from options.seed on and returns the first
+// layout scoring within [minScore, maxScore], or the closest one seen.
+CircuitLayout generateCircuitInBand(CircuitOptions options, double minScore, double maxScore, int attempts,
+                                    CircuitDifficulty* rating = nullptr);
@@ -0,0 +1,35 @@
+#include "circuit_grid.h"
+
+CircuitGrid::CircuitGrid(const CircuitLayout& layout)
+    : rowCount(layout.rows),
+      colCount(layout.cols),
+      types(size_t(layout.rows) * layout.cols),
+      fills(size_t(layout.rows) * layout.cols, FILL_NONE),
+      visitedBits(layout.rows, layout.cols),
+      changedBits(layout.rows, layout.cols) {
+    for (int cell = 0; cell < size(); ++cell) types[cell] = layout.typeAt(cell);
+}
+
+void CircuitGrid::markChanged(int cell) {
+    if (changedBits.test(cell)) return;
+    changedBits.set(cell);
+    changed.push_back(cell);
+}
+
+void CircuitGrid::setType(int cell, TileType type) {
+    if (types[cell] == type) return;
+    types[cell] = type;
+    markChanged(cell);
+}
+
+void CircuitGrid::setFill(int cell, uint8_t fill) {
+    if (fills[cell] == fill) return;
+    fills[cell] = fill;
+    markChanged(cell);
+}
+
+void CircuitGrid::takeChanged(std::vector<int>& cells) {
+    cells.swap(changed);
+    changed.clear();
+    for (int cell : cells) changedBits.reset(cell);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "circuit_layout.h"
+
+// Fill colour of a tile, as an index; the renderer owns the actual colours.
+// Current flow uses FILL_FLOW + 1 .. FILL_FLOW + FLOW_LEVELS.
+enum TileFill : uint8_t { FILL_NONE = 0, FILL_VISITED, FILL_WRONG, FILL_FLOW = 16 };
+const int FLOW_LEVELS = 16;
+
+// Game state of every tile as parallel arrays: a type byte, a visited bit
+// and a fill byte, about two bytes a tile. Nothing here knows about SFML;
+// setters record which tiles changed so a renderer can redraw just those.
+class CircuitGrid {
+public:
+    CircuitGrid() = default;
+    explicit CircuitGrid(const CircuitLayout& layout);
+
+    int rows() const { return rowCount; }
+    int cols() const { return colCount; }
+    int size() const { return rowCount * colCount; }
+
+    TileType type(int cell) const { return TileType(types[cell]); }
+    bool visited(int cell) const { return visitedBits.test(cell); }
+    uint8_t fill(int cell) const { return fills[cell]; }
+
+    void setType(int cell, TileType type);
+    void setVisited(int cell) { visitedBits.set(cell); }
+    void setFill(int cell, uint8_t fill);
+
+    // Moves the tiles changed since the last call into cells, each once.
+    void takeChanged(std::vector<int>& cells);
+
+private:
+    void markChanged(int cell);
+
+    int rowCount = 0;
+    int colCount = 0;
+    std::vector<uint8_t> types;
+    std::vector<uint8_t> fills;
+    BitGrid visitedBits;
+    BitGrid changedBits;
+    std::vector<int> changed;
+};
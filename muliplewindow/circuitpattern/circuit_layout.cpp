@@ -0,0 +1,186 @@
+#include "circuit_layout.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+// splitmix64: tiny, fast and the same sequence on every platform, so a seed
+// reproduces a layout anywhere.
+struct SplitMix {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(next() % n); }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+const TileType COMPONENT_TYPES[] = {RESISTOR, DIODE, CAPACITOR, BATTERY};
+
+const char* tileSymbol(TileType type) {
+    switch (type) {
+        case START: return "S";
+        case END: return "E";
+        case RESISTOR: return "R";
+        case WIRE: return "W";
+        case DIODE: return "D";
+        case CAPACITOR: return "C";
+        case BATTERY: return "B";
+        default: return "";
+    }
+}
+
+size_t BitGrid::count() const {
+    size_t total = 0;
+    for (uint64_t word : words) total += __builtin_popcountll(word);
+    return total;
+}
+
+void CircuitLayout::setType(int cell, TileType type) {
+    for (int k = 0; k < 3; ++k) {
+        if ((type >> k) & 1) typeBits[k].set(cell);
+        else typeBits[k].reset(cell);
+    }
+}
+
+// Breadth-first search over conductive tiles from start. Fills parent (if
+// given) and returns the cells in the order they were reached.
+template <typename IsOpen>
+static std::vector<int> breadthFirst(int rows, int cols, int start, IsOpen isOpen, std::vector<int>* parent) {
+    BitGrid seen(rows, cols);
+    std::vector<int> order;
+    order.push_back(start);
+    seen.set(start);
+    if (parent) parent->assign(size_t(rows) * cols, -1);
+    for (size_t head = 0; head < order.size(); ++head) {
+        int cell = order[head];
+        int row = cell / cols, col = cell % cols;
+        int next[4];
+        int count = 0;
+        if (row > 0) next[count++] = cell - cols;
+        if (row + 1 < rows) next[count++] = cell + cols;
+        if (col > 0) next[count++] = cell - 1;
+        if (col + 1 < cols) next[count++] = cell + 1;
+        for (int i = 0; i < count; ++i) {
+            if (seen.test(next[i]) || !isOpen(next[i])) continue;
+            seen.set(next[i]);
+            if (parent) (*parent)[next[i]] = cell;
+            order.push_back(next[i]);
+        }
+    }
+    return order;
+}
+
+CircuitLayout generateCircuit(const CircuitOptions& options) {
+    const int rows = std::max(2, options.rows);
+    const int cols = std::max(2, options.cols);
+    SplitMix rng{options.seed};
+
+    // Corridor cells sit on even rows and columns; the cells between them
+    // are walls until the maze carves through.
+    BitGrid open(rows, cols);
+    const int latticeRows = (rows + 1) / 2;
+    const int latticeCols = (cols + 1) / 2;
+    BitGrid carved(latticeRows, latticeCols);
+    std::vector<int> stack;
+    stack.push_back(0);
+    carved.set(0);
+    open.set(0);
+
+    // Randomised depth-first search with an explicit stack: long winding
+    // corridors and one route between any two cells.
+    while (!stack.empty()) {
+        int cur = stack.back();
+        int r = cur / latticeCols, c = cur % latticeCols;
+        int choices[4];
+        int count = 0;
+        if (r > 0 && !carved.test(cur - latticeCols)) choices[count++] = cur - latticeCols;
+        if (r + 1 < latticeRows && !carved.test(cur + latticeCols)) choices[count++] = cur + latticeCols;
+        if (c > 0 && !carved.test(cur - 1)) choices[count++] = cur - 1;
+        if (c + 1 < latticeCols && !carved.test(cur + 1)) choices[count++] = cur + 1;
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int next = choices[rng.below(count)];
+        int nr = next / latticeCols, nc = next % latticeCols;
+        open.set((r + nr) * cols + (c + nc));  // the wall in between
+        open.set(2 * nr * cols + 2 * nc);
+        carved.set(next);
+        stack.push_back(next);
+    }
+
+    // A 2x2 grid has a single corridor cell; open the one beside it so END
+    // does not land on START.
+    if (latticeRows * latticeCols == 1) open.set(1);
+
+    if (options.loopChance > 0) {
+        for (int row = 0; row < rows; ++row) {
+            for (int col = (row % 2 == 0) ? 1 : 0; col < cols; col += 2) {
+                // A wall separates two corridor cells either left/right (even
+                // row) or above/below (odd row, even column).
+                bool between = (row % 2 == 0) ? col + 1 < cols : row + 1 < rows;
+                int cell = row * cols + col;
+                if (between && !open.test(cell) && rng.unit() < options.loopChance) open.set(cell);
+            }
+        }
+    }
+
+    CircuitLayout layout;
+    layout.rows = rows;
+    layout.cols = cols;
+    layout.seed = options.seed;
+    for (BitGrid& plane : layout.typeBits) plane = BitGrid(rows, cols);
+
+    // END goes where the search from START finishes: the farthest corridor.
+    std::vector<int> order = breadthFirst(rows, cols, 0, [&open](int cell) { return open.test(cell); }, nullptr);
+    layout.start = 0;
+    layout.end = order.back();
+    for (int cell : order) {
+        TileType type = WIRE;
+        if (rng.unit() < options.componentChance) type = COMPONENT_TYPES[rng.below(4)];
+        layout.setType(cell, type);
+    }
+    layout.setType(layout.start, START);
+    layout.setType(layout.end, END);
+    return layout;
+}
+
+std::vector<int> solveCircuit(const CircuitLayout& layout) {
+    std::vector<int> parent;
+    breadthFirst(layout.rows, layout.cols, layout.start, [&layout](int cell) { return layout.conductive(cell); }, &parent);
+    std::vector<int> path;
+    if (layout.end != layout.start && parent[layout.end] < 0) return path;
+    for (int cell = layout.end; cell != layout.start; cell = parent[cell]) path.push_back(cell);
+    path.push_back(layout.start);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+std::vector<int> circuitParents(const CircuitLayout& layout) {
+    std::vector<int> parent;
+    breadthFirst(layout.rows, layout.cols, layout.start, [&layout](int cell) { return layout.conductive(cell); }, &parent);
+    return parent;
+}
+
+bool parseCircuitSide(const char* text, int& side) {
+    const char* end = text + std::strlen(text);
+    int value = 0;
+    std::from_chars_result parsed = std::from_chars(text, end, value);
+    if (parsed.ec != std::errc() || parsed.ptr != end || value < MIN_CIRCUIT_SIDE || value > MAX_CIRCUIT_SIDE)
+        return false;
+    side = value;
+    return true;
+}
+
+bool parseCircuitSeed(const char* text, uint64_t& seed) {
+    const char* end = text + std::strlen(text);
+    uint64_t value = 0;
+    std::from_chars_result parsed = std::from_chars(text, end, value);
+    if (parsed.ec != std::errc() || parsed.ptr != end) return false;
+    seed = value;
+    return true;
+}
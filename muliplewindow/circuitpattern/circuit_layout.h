@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Procedurally generated circuit mazes. Nothing in here touches SFML, so the
+// generator and solver can be used (and timed) on their own.
+
+enum TileType : uint8_t { EMPTY, START, END, RESISTOR, WIRE, DIODE, CAPACITOR, BATTERY };
+
+// Letter drawn on a tile: S, E, R, W, D, C, B, or "" for empty.
+const char* tileSymbol(TileType type);
+
+// rows x cols bits stored row after row in 64-bit words.
+class BitGrid {
+public:
+    BitGrid() = default;
+    BitGrid(int rows, int cols) : colCount(cols), words((size_t(rows) * cols + 63) / 64) {}
+
+    bool test(int cell) const { return (words[cell >> 6] >> (cell & 63)) & 1; }
+    void set(int cell) { words[cell >> 6] |= 1ULL << (cell & 63); }
+    void reset(int cell) { words[cell >> 6] &= ~(1ULL << (cell & 63)); }
+    bool test(int row, int col) const { return test(row * colCount + col); }
+
+    size_t count() const;
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+private:
+    int colCount = 0;
+    std::vector<uint64_t> words;
+};
+
+// A generated maze. Cells are numbered row * cols + col. Conductive tiles
+// form corridors between empty walls; start and end are joined by at least
+// one path of 4-connected conductive tiles.
+struct CircuitLayout {
+    int rows = 0;
+    int cols = 0;
+    uint64_t seed = 0;
+    int start = 0;
+    int end = 0;
+
+    // Tile types as three bit planes (bit k of the type in plane k), so a
+    // 1000x1000 layout takes about 375 KB.
+    BitGrid typeBits[3];
+
+    TileType typeAt(int cell) const {
+        return TileType(typeBits[0].test(cell) | typeBits[1].test(cell) << 1 | typeBits[2].test(cell) << 2);
+    }
+    TileType typeAt(int row, int col) const { return typeAt(row * cols + col); }
+    bool conductive(int cell) const { return typeBits[0].test(cell) || typeBits[1].test(cell) || typeBits[2].test(cell); }
+    void setType(int cell, TileType type);
+};
+
+struct CircuitOptions {
+    int rows = 6;
+    int cols = 6;
+    uint64_t seed = 1;
+    // Chance that a wall between two neighbouring corridors is knocked
+    // through, adding loops and therefore alternate routes. 0 gives a
+    // perfect maze with exactly one route from start to end.
+    double loopChance = 0.0;
+    // Chance that a corridor tile is a component rather than plain wire.
+    double componentChance = 0.35;
+};
+
+// Sides the tools accept on the command line; rows * cols stays well inside
+// the int cell indices.
+const int MIN_CIRCUIT_SIDE = 2;
+const int MAX_CIRCUIT_SIDE = 1000;
+
+// Command-line parsing for the circuit tools: the whole text has to be the
+// number. Sides run from MIN_CIRCUIT_SIDE to MAX_CIRCUIT_SIDE.
+bool parseCircuitSide(const char* text, int& side);
+bool parseCircuitSeed(const char* text, uint64_t& seed);
+
+// Builds a random spanning-tree maze on the even rows and columns (plus the
+// loops asked for), puts START in the top-left corner and END in the
+// corridor cell farthest from it. The same options always give the same
+// layout. rows and cols below 2 are raised to 2; START and END are always
+// different cells.
+CircuitLayout generateCircuit(const CircuitOptions& options);
+
+// Shortest start-to-end path (breadth-first search), as cell indices
+// including both ends. Empty when the layout is not solvable.
+std::vector<int> solveCircuit(const CircuitLayout& layout);
+
+// Breadth-first search tree from START: the neighbour each conductive tile
+// is first reached from, or -1 for START and tiles that are not reached.
+std::vector<int> circuitParents(const CircuitLayout& layout);
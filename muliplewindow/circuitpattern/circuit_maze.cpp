@@ -1,36 +1,93 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <random>
+#include <string>
+#include "circuit_batch.h"
+#include "circuit_grid.h"
+#include "circuit_layout.h"
+#include "circuit_rules.h"
+#include "room_progress.h"
+#include "circuit_sim.h"
 #include <cmath> // For sine wave glow
+#include <iomanip>
+#include <sstream>
 
+// Largest tile edge; bigger grids shrink their tiles to fit MAX_GRID_PIXELS.
+// Tiles are never built smaller than MIN_TILE_SIZE; past that the grid view
+// scales them down, below a pixel if need be, so the window stays capped.
 const int TILE_SIZE = 100;
-const int ROWS = 6;
-const int COLS = 6;
+const int MIN_TILE_SIZE = 4;
+const int MAX_GRID_PIXELS = 900;
+// The menu's map shows the room as solved once it is recorded here.
+const char* PROGRESS_FILE = "../../menuforgame/progress.txt";
+const char* ROOM_ID = "circuit";
 const float TIME_LIMIT = 60.0f;
+const int HUD_HEIGHT = 50;
+// Each wheel notch zooms the grid view by this factor.
+const float ZOOM_STEP = 1.25f;
+// Simulation mode: END has to stay on target this long to win, and a slow
+// frame never advances the circuit by more than MAX_SIM_STEP.
+const float WIN_HOLD_SECONDS = 1.0f;
+const float MAX_SIM_STEP = 1.0f / 30;
+
+// Part a clicked tile turns into in simulation mode.
+TileType nextPart(TileType type) {
+    switch (type) {
+        case WIRE: return RESISTOR;
+        case RESISTOR: return DIODE;
+        case DIODE: return CAPACITOR;
+        case CAPACITOR: return BATTERY;
+        default: return WIRE;
+    }
+}
 
-enum TileType { EMPTY, START, END, RESISTOR, WIRE, DIODE, CAPACITOR, BATTERY };
+std::string formatVolts(double volts) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << volts << " V";
+    return out.str();
+}
 
-struct Tile {
-    TileType type;
-    sf::RectangleShape shape;
-    sf::Text label;
-    bool visited = false;
-};
+// Keeps the view's centre over the grid so it cannot be panned away.
+void clampView(sf::View& view, float width, float height) {
+    sf::Vector2f center = view.getCenter();
+    view.setCenter(std::min(std::max(center.x, 0.0f), width), std::min(std::max(center.y, 0.0f), height));
+}
 
-std::vector<sf::Vector2i> validPath = {
-    {0,0}, {0,1}, {0,2}, {0,3}, {1,2}, {2,2}, {3,2}, {3,3}, {3,4}, {3,5}
-};
+// Usage: circuit_maze [--simulate] [rows cols [seed]]. The seed is printed
+// so a layout can be replayed. With --simulate the circuit is solved
+// electrically: click parts to swap them until END reaches the target
+// voltage.
+int main(int argc, char* argv[]) {
+    const bool simulate = argc > 1 && std::string(argv[1]) == "--simulate";
+    const int arg = simulate ? 2 : 1;
+    CircuitOptions options;
+    options.seed = std::random_device()();
+    if (argc == arg + 1 || argc > arg + 3 ||
+        (argc > arg + 1 && !(parseCircuitSide(argv[arg], options.rows) && parseCircuitSide(argv[arg + 1], options.cols))) ||
+        (argc > arg + 2 && !parseCircuitSeed(argv[arg + 2], options.seed))) {
+        std::cerr << "Usage: " << argv[0] << " [--simulate] [rows cols [seed]], rows and cols from " << MIN_CIRCUIT_SIDE
+                  << " to " << MAX_CIRCUIT_SIDE << "\n";
+        return 1;
+    }
+    CircuitLayout layout = generateCircuit(options);
+    CircuitRules rules;
+    rules.build(layout);
+    std::cout << "Circuit " << layout.rows << "x" << layout.cols << ", seed " << layout.seed << "\n";
 
-bool isValidStep(int index, sf::Vector2i pos) {
-    return index < validPath.size() && validPath[index] == pos;
-}
+    const int ROWS = layout.rows;
+    const int COLS = layout.cols;
+    const int tileSize = std::max(MIN_TILE_SIZE, std::min(TILE_SIZE, MAX_GRID_PIXELS / std::max(ROWS, COLS)));
 
-bool isComponent(TileType type) {
-    return type != EMPTY;
-}
+    const float gridWidth = float(COLS * tileSize);
+    const float gridHeight = float(ROWS * tileSize);
+    // Window pixels per grid unit at zoom 1.
+    const float windowScale = std::min(1.0f, MAX_GRID_PIXELS / std::max(gridWidth, gridHeight));
+    const int gridPixelWidth = std::max(1, int(gridWidth * windowScale + 0.5f));
+    const int gridPixelHeight = std::max(1, int(gridHeight * windowScale + 0.5f));
 
-int main() {
-    sf::RenderWindow window(sf::VideoMode(COLS * TILE_SIZE, ROWS * TILE_SIZE + 50), "Circuit Maze Game");
+    sf::RenderWindow window(sf::VideoMode(gridPixelWidth, gridPixelHeight + HUD_HEIGHT), "Circuit Maze Game");
 
     sf::Font font;
     if (!font.loadFromFile("arial.ttf")) {
@@ -45,49 +102,40 @@ int main() {
     }
     sf::Sprite backgroundSprite(backgroundTexture);
     backgroundSprite.setScale(
-        float(COLS * TILE_SIZE) / backgroundTexture.getSize().x,
-        float(ROWS * TILE_SIZE) / backgroundTexture.getSize().y
+        float(COLS * tileSize) / backgroundTexture.getSize().x,
+        float(ROWS * tileSize) / backgroundTexture.getSize().y
     );
 
-    Tile grid[ROWS][COLS];
-    for (int y = 0; y < ROWS; ++y) {
-        for (int x = 0; x < COLS; ++x) {
-            grid[y][x].type = EMPTY;
-            grid[y][x].shape.setSize(sf::Vector2f(TILE_SIZE - 2, TILE_SIZE - 2));
-            grid[y][x].shape.setFillColor(sf::Color::Transparent);
-            grid[y][x].shape.setOutlineColor(sf::Color::White);
-            grid[y][x].shape.setOutlineThickness(1);
-            grid[y][x].shape.setPosition(x * TILE_SIZE, y * TILE_SIZE);
-
-            grid[y][x].label.setFont(font);
-            grid[y][x].label.setCharacterSize(20);
-            grid[y][x].label.setFillColor(sf::Color::White);
-            grid[y][x].label.setPosition(x * TILE_SIZE + 10, y * TILE_SIZE + 35);
+    CircuitGrid grid(layout);
+    CircuitBatch batch;
+    batch.build(grid, float(tileSize), font);
+
+    CircuitSim sim;
+    SimPuzzle puzzle;
+    float heldFor = 0;
+    sf::Clock frameClock;
+    if (simulate) {
+        if (!sim.build(layout)) return -1;
+        puzzle = scrambleCircuit(sim, solveCircuit(layout), layout.seed);
+        if (!puzzle.scrambled) {
+            std::cerr << "No part swap moves END off target in this layout; try another seed\n";
+            return -1;
         }
+        for (int cell : puzzle.changed) grid.setType(cell, sim.typeAt(cell));
     }
 
-    std::vector<std::pair<sf::Vector2i, std::string>> components = {
-        {{0,0}, "S"}, {{0,1}, "R"}, {{0,2}, "W"}, {{0,3}, "D"},
-        {{1,2}, "W"}, {{2,2}, "C"}, {{3,2}, "B"},
-        {{3,3}, "W"}, {{3,4}, "W"}, {{3,5}, "E"}
-    };
-
-    for (auto& comp : components) {
-        int y = comp.first.y;
-        int x = comp.first.x;
-        std::string label = comp.second;
-
-        grid[y][x].label.setString(label);
-        if (label == "S") grid[y][x].type = START;
-        else if (label == "E") grid[y][x].type = END;
-        else if (label == "R") grid[y][x].type = RESISTOR;
-        else if (label == "C") grid[y][x].type = CAPACITOR;
-        else if (label == "D") grid[y][x].type = DIODE;
-        else if (label == "B") grid[y][x].type = BATTERY;
-        else if (label == "W") grid[y][x].type = WIRE;
-    }
+    // The grid has its own view for panning (right drag) and zooming (wheel);
+    // the timer and result stay put in the window's default view.
+    sf::View gridView(sf::FloatRect(0, 0, gridWidth, gridHeight));
+    gridView.setViewport(sf::FloatRect(0, 0, 1, float(gridPixelHeight) / (gridPixelHeight + HUD_HEIGHT)));
+    const sf::View hudView = window.getDefaultView();
+    // Zoom is view size over grid size: 1 shows it all, the minimum shows
+    // tiles at twice TILE_SIZE.
+    const float minZoom = std::min(1.0f, tileSize * windowScale / (2 * TILE_SIZE));
+    float zoom = 1.0f;
+    bool panning = false;
+    sf::Vector2i panFrom;
 
-    int pathIndex = 0;
     bool gameWon = false, gameLost = false;
 
     sf::Clock clock;
@@ -95,13 +143,13 @@ int main() {
     timerText.setFont(font);
     timerText.setCharacterSize(20);
     timerText.setFillColor(sf::Color::Yellow);
-    timerText.setPosition(10, ROWS * TILE_SIZE + 10);
+    timerText.setPosition(10, gridPixelHeight + 10);
 
     sf::Text resultText;
     resultText.setFont(font);
     resultText.setCharacterSize(24);
     resultText.setFillColor(sf::Color::White);
-    resultText.setPosition(200, ROWS * TILE_SIZE + 10);
+    resultText.setPosition(200, gridPixelHeight + 10);
 
     while (window.isOpen()) {
         sf::Event event;
@@ -117,27 +165,58 @@ int main() {
             resultText.setString("Time's up! You lost.");
         }
 
-        sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
 
-            if (!gameWon && !gameLost && event.type == sf::Event::MouseButtonPressed) {
-                int x = mousePos.x / TILE_SIZE;
-                int y = mousePos.y / TILE_SIZE;
+            if (event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+                // Zoom about the cursor: the grid point under it stays put.
+                sf::Vector2i pixel(event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+                float next = event.mouseWheelScroll.delta > 0 ? zoom / ZOOM_STEP : zoom * ZOOM_STEP;
+                next = std::min(std::max(next, minZoom), 1.0f);
+                sf::Vector2f before = window.mapPixelToCoords(pixel, gridView);
+                gridView.zoom(next / zoom);
+                gridView.move(before - window.mapPixelToCoords(pixel, gridView));
+                clampView(gridView, gridWidth, gridHeight);
+                zoom = next;
+            }
+
+            if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right) {
+                panning = true;
+                panFrom = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+            }
+            if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right)
+                panning = false;
+            if (event.type == sf::Event::MouseMoved && panning) {
+                sf::Vector2i to(event.mouseMove.x, event.mouseMove.y);
+                gridView.move(window.mapPixelToCoords(panFrom, gridView) - window.mapPixelToCoords(to, gridView));
+                clampView(gridView, gridWidth, gridHeight);
+                panFrom = to;
+            }
+
+            if (!gameWon && !gameLost && event.type == sf::Event::MouseButtonPressed &&
+                event.mouseButton.button == sf::Mouse::Left && event.mouseButton.y < gridPixelHeight) {
+                sf::Vector2i pixel(event.mouseButton.x, event.mouseButton.y);
+                int cell = batch.cellAt(window.mapPixelToCoords(pixel, gridView));
 
-                if (x < COLS && y < ROWS) {
-                    if (isValidStep(pathIndex, {y, x})) {
-                        grid[y][x].visited = true;
-                        grid[y][x].shape.setFillColor(sf::Color(0, 255, 0, 100));
-                        pathIndex++;
-                        if (pathIndex == validPath.size()) {
+                if (cell >= 0 && simulate) {
+                    TileType type = grid.type(cell);
+                    if (type != EMPTY && type != START && type != END) {
+                        grid.setType(cell, nextPart(type));
+                        sim.setType(cell, grid.type(cell));
+                    }
+                } else if (cell >= 0) {
+                    if (grid.visited(cell)) {
+                        // Already part of the trail.
+                    } else if (rules.canVisit(grid, cell)) {
+                        grid.setFill(cell, FILL_VISITED);
+                        if (rules.visit(grid, cell)) {
                             gameWon = true;
+                            markRoomSolved(PROGRESS_FILE, ROOM_ID);
                             resultText.setString("Success! You completed the circuit.");
                         }
                     } else {
-                        grid[y][x].shape.setFillColor(sf::Color(255, 0, 0, 100));
+                        grid.setFill(cell, FILL_WRONG);
                         gameLost = true;
                         resultText.setString("Wrong step! You lost.");
                     }
@@ -145,35 +224,49 @@ int main() {
             }
         }
 
-        window.clear();
-        window.draw(backgroundSprite);
+        if (simulate) {
+            float dt = std::min(frameClock.restart().asSeconds(), MAX_SIM_STEP);
+            sim.step(dt);
 
-        for (int y = 0; y < ROWS; ++y) {
-            for (int x = 0; x < COLS; ++x) {
-                Tile& tile = grid[y][x];
-
-                // Animate glow for components
-                if (isComponent(tile.type)) {
-                    tile.label.setFillColor(sf::Color(glow, glow, 255));
-                }
+            // Current flow: brighter tiles carry more of the supply current.
+            double full = std::max(std::fabs(sim.supplyCurrent()), 1e-9);
+            for (int cell : sim.componentCells()) {
+                double share = std::min(1.0, std::fabs(sim.current(cell)) / full);
+                int level = int(share * FLOW_LEVELS + 0.5);
+                grid.setFill(cell, level ? FILL_FLOW + level : FILL_NONE);
+            }
 
-                // Hover effect
-                sf::FloatRect bounds = tile.shape.getGlobalBounds();
-                if (bounds.contains(static_cast<float>(mousePos.x), static_cast<float>(mousePos.y))) {
-                    tile.shape.setOutlineColor(sf::Color::Cyan);
-                    tile.shape.setOutlineThickness(3);
+            if (!gameWon && !gameLost) {
+                bool onTarget = std::fabs(sim.endVoltage() - puzzle.target) <= TARGET_TOLERANCE;
+                heldFor = onTarget ? heldFor + dt : 0;
+                if (heldFor >= WIN_HOLD_SECONDS) {
+                    gameWon = true;
+                    markRoomSolved(PROGRESS_FILE, ROOM_ID);
+                    resultText.setString("Success! The circuit is balanced.");
                 } else {
-                    tile.shape.setOutlineColor(sf::Color::White);
-                    tile.shape.setOutlineThickness(1);
+                    resultText.setString("End: " + formatVolts(sim.endVoltage()) + "  Target: " + formatVolts(puzzle.target));
                 }
-
-                window.draw(tile.shape);
-                window.draw(tile.label);
             }
         }
 
+        // Hover is a division, not a bounds test per tile.
+        sf::Vector2i mousePos = sf::Mouse::getPosition(window);
+        if (mousePos.y >= 0 && mousePos.y < gridPixelHeight)
+            batch.setHover(batch.cellAt(window.mapPixelToCoords(mousePos, gridView)));
+        else
+            batch.setHover(-1);
+
+        batch.sync(grid);
+
+        window.clear();
+        window.setView(gridView);
+        window.draw(backgroundSprite);
+        // Animate glow for components
+        batch.draw(window, sf::Color(glow, glow, 255));
+
+        window.setView(hudView);
         window.draw(timerText);
-        if (gameWon || gameLost)
+        if (gameWon || gameLost || simulate)
             window.draw(resultText);
 
         window.display();
@@ -0,0 +1,77 @@
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "circuit_difficulty.h"
+#include "circuit_layout.h"
+
+// Usage: circuit_rate rows cols [seeds [loop_chance [first_seed]]]
+//        circuit_rate --band min max rows cols [loop_chance [first_seed]]
+//
+// The first form rates seeds first_seed.. and prints one JSON object per
+// layout. The second searches seeds for a layout scoring in [min, max] and
+// prints the one it found.
+static void printRating(const CircuitLayout& layout, const CircuitDifficulty& rating) {
+    std::cout << "{\"rows\": " << layout.rows << ", \"cols\": " << layout.cols << ", \"seed\": " << layout.seed
+              << ", \"completions\": " << rating.completions << ", \"dead_ends\": " << rating.deadEnds
+              << ", \"dead_end_tiles\": " << rating.deadEndTiles << ", \"route_length\": " << rating.routeLength
+              << ", \"peak_states\": " << rating.peakStates << ", \"score\": " << rating.score << "}\n";
+}
+
+// Most layouts one run rates.
+const int MAX_SEEDS = 1000000;
+
+static bool parseSeedCount(const char* text, int& seeds) {
+    const char* end = text + std::strlen(text);
+    std::from_chars_result parsed = std::from_chars(text, end, seeds);
+    return parsed.ec == std::errc() && parsed.ptr == end && seeds >= 1 && seeds <= MAX_SEEDS;
+}
+
+// A finite number and nothing else.
+static bool parseNumber(const char* text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && !*end && std::isfinite(value);
+}
+
+int main(int argc, char* argv[]) {
+    const bool band = argc > 1 && std::string(argv[1]) == "--band";
+    const int arg = band ? 4 : 1;
+    CircuitOptions options;
+    int seeds = 1;
+    double minScore = 0, maxScore = 0;
+    bool valid = argc >= arg + 2 && argc <= arg + (band ? 4 : 5) && parseCircuitSide(argv[arg], options.rows) &&
+                 parseCircuitSide(argv[arg + 1], options.cols);
+    if (valid && band) valid = parseNumber(argv[2], minScore) && parseNumber(argv[3], maxScore);
+    int next = arg + 2;
+    if (valid && !band && argc > next) valid = parseSeedCount(argv[next++], seeds);
+    if (valid && argc > next) {
+        valid = parseNumber(argv[next++], options.loopChance) && options.loopChance >= 0 && options.loopChance <= 1;
+    }
+    if (valid && argc > next) valid = parseCircuitSeed(argv[next++], options.seed);
+    if (!valid) {
+        std::cerr << "Usage: circuit_rate rows cols [seeds [loop_chance [first_seed]]]\n"
+                  << "       circuit_rate --band min max rows cols [loop_chance [first_seed]]\n"
+                  << "rows and cols from " << MIN_CIRCUIT_SIDE << " to " << MAX_CIRCUIT_SIDE << ", seeds from 1 to "
+                  << MAX_SEEDS << ", loop_chance from 0 to 1\n";
+        return 1;
+    }
+
+    if (band) {
+        const int ATTEMPTS = 1000;
+        CircuitDifficulty rating;
+        CircuitLayout layout = generateCircuitInBand(options, minScore, maxScore, ATTEMPTS, &rating);
+        if (layout.rows == 0) return 1;
+        printRating(layout, rating);
+        return rating.score >= minScore && rating.score <= maxScore ? 0 : 2;
+    }
+    for (int i = 0; i < seeds; ++i, ++options.seed) {
+        CircuitLayout layout = generateCircuit(options);
+        CircuitDifficulty rating;
+        if (!rateCircuit(layout, rating)) return 1;
+        printRating(layout, rating);
+    }
+    return 0;
+}
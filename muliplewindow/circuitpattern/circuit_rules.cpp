@@ -0,0 +1,61 @@
+#include "circuit_rules.h"
+#include <utility>
+
+void CircuitRules::build(const CircuitLayout& layout) {
+    const int rows = layout.rows;
+    cols = layout.cols;
+    start = layout.start;
+    end = layout.end;
+    linkMasks.assign(size_t(rows) * cols, 0);
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            int cell = row * cols + col;
+            if (!layout.conductive(cell)) continue;
+            uint8_t mask = 0;
+            if (row > 0 && layout.conductive(cell - cols)) mask |= LINK_UP;
+            if (row + 1 < rows && layout.conductive(cell + cols)) mask |= LINK_DOWN;
+            if (col > 0 && layout.conductive(cell - 1)) mask |= LINK_LEFT;
+            if (col + 1 < cols && layout.conductive(cell + 1)) mask |= LINK_RIGHT;
+            linkMasks[cell] = mask;
+        }
+    }
+    sets.assign(linkMasks.size(), -1);
+}
+
+bool CircuitRules::canVisit(const CircuitGrid& grid, int cell) const {
+    TileType type = grid.type(cell);
+    if (type == EMPTY || grid.visited(cell)) return false;
+    if (type == START || type == END) return true;
+    uint8_t mask = linkMasks[cell];
+    return ((mask & LINK_UP) && grid.visited(cell - cols)) || ((mask & LINK_DOWN) && grid.visited(cell + cols)) ||
+           ((mask & LINK_LEFT) && grid.visited(cell - 1)) || ((mask & LINK_RIGHT) && grid.visited(cell + 1));
+}
+
+bool CircuitRules::visit(CircuitGrid& grid, int cell) {
+    grid.setVisited(cell);
+    uint8_t mask = linkMasks[cell];
+    if ((mask & LINK_UP) && grid.visited(cell - cols)) join(cell, cell - cols);
+    if ((mask & LINK_DOWN) && grid.visited(cell + cols)) join(cell, cell + cols);
+    if ((mask & LINK_LEFT) && grid.visited(cell - 1)) join(cell, cell - 1);
+    if ((mask & LINK_RIGHT) && grid.visited(cell + 1)) join(cell, cell + 1);
+    return closed();
+}
+
+// Path halving keeps the trees flat enough that find is effectively O(1).
+int CircuitRules::find(int cell) const {
+    while (sets[cell] >= 0) {
+        int parent = sets[cell];
+        if (sets[parent] >= 0) sets[cell] = sets[parent];
+        cell = parent;
+    }
+    return cell;
+}
+
+void CircuitRules::join(int a, int b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (sets[a] > sets[b]) std::swap(a, b);  // a is the larger set
+    sets[a] += sets[b];
+    sets[b] = a;
+}
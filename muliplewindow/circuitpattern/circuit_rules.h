@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "circuit_grid.h"
+#include "circuit_layout.h"
+
+// Which neighbours a tile is wired to, one bit per direction.
+enum TileLink : uint8_t { LINK_UP = 1, LINK_DOWN = 2, LINK_LEFT = 4, LINK_RIGHT = 8 };
+
+// Path rules as a transition graph over the conductive tiles. Each tile's
+// links are precomputed at load, so checking a click is a few bit tests.
+//
+// A trail may be started from START or END and grows one tile at a time:
+// a tile can be visited if it is wired to any visited tile, so branches and
+// alternate routes are fine. The circuit is closed as soon as START and END
+// are joined, which a union-find over the visited tiles tracks as it grows.
+class CircuitRules {
+public:
+    void build(const CircuitLayout& layout);
+
+    uint8_t links(int cell) const { return linkMasks[cell]; }
+
+    // Whether clicking cell is a legal step. Constant time.
+    bool canVisit(const CircuitGrid& grid, int cell) const;
+
+    // Marks a legal step visited and joins it to its visited neighbours.
+    // Returns true once START and END are connected.
+    bool visit(CircuitGrid& grid, int cell);
+    bool closed() const { return find(start) == find(end); }
+
+private:
+    int find(int cell) const;
+    void join(int a, int b);
+
+    int cols = 0;
+    int start = 0;
+    int end = 0;
+    std::vector<uint8_t> linkMasks;
+    // Union-find over cells: a root holds -(set size), others their parent.
+    mutable std::vector<int> sets;
+};
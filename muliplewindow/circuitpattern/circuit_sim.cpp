@@ -0,0 +1,374 @@
+#include "circuit_sim.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+const double WIRE_OHMS = 0.1;
+const double RESISTOR_OHMS = 100.0;
+const double BATTERY_VOLTS = 1.5;
+const double BATTERY_OHMS = 1.0;
+const double CAPACITOR_FARADS = 2e-3;
+// Capacitors leak, so a route through one still settles to a nonzero voltage.
+const double CAPACITOR_LEAK_OHMS = 220.0;
+const double DIODE_SATURATION = 1e-12;
+const double THERMAL_VOLTS = 0.02585;
+// Newton starts a fresh diode here; most diodes on the route end up near it.
+const double DIODE_START_VOLTS = 0.6;
+// Tiny conductance from every node to ground so nothing floats, e.g. behind
+// a reverse-biased diode or in a dead end.
+const double GMIN = 1e-9;
+const int NEWTON_LIMIT = 100;
+// A diode has converged when its voltage moves less than this fraction of
+// its terminal voltages plus a tenth of a millivolt (SPICE's RELTOL and a
+// looser VNTOL: islands cut off by reverse diodes otherwise creep towards
+// their microvolt equilibrium for dozens of iterations).
+// The diode's current must also match its linearisation to the same
+// fraction, plus a nanoamp (SPICE's ABSTOL is a picoamp; GMIN leaks more).
+const double NEWTON_RELATIVE = 1e-3;
+const double NEWTON_ABSOLUTE = 1e-4;
+const double NEWTON_CURRENT = 1e-9;
+
+const int SCRAMBLE_TILES = 3;
+const int SCRAMBLE_ATTEMPTS = 16;
+
+// SPICE's pnjlim: keeps a Newton step on a diode from running up the
+// exponential and overflowing.
+static double limitJunction(double vnew, double vold) {
+    static const double vcrit = THERMAL_VOLTS * std::log(THERMAL_VOLTS / (std::sqrt(2.0) * DIODE_SATURATION));
+    if (vnew > vcrit && std::fabs(vnew - vold) > 2 * THERMAL_VOLTS) {
+        if (vold > 0) {
+            double arg = 1 + (vnew - vold) / THERMAL_VOLTS;
+            return arg > 0 ? vold + THERMAL_VOLTS * std::log(arg) : vcrit;
+        }
+        return THERMAL_VOLTS * std::log(vnew / THERMAL_VOLTS);
+    }
+    return vnew;
+}
+
+bool CircuitSim::build(const CircuitLayout& layout) {
+    cols = layout.cols;
+    start = layout.start;
+    end = layout.end;
+    const int cellCount = layout.rows * layout.cols;
+    if (!layout.conductive(start) || !layout.conductive(end)) {
+        std::cerr << "Circuit has no start or end tile\n";
+        return false;
+    }
+
+    types.assign(cellCount, EMPTY);
+    for (int cell = 0; cell < cellCount; ++cell) types[cell] = layout.typeAt(cell);
+
+    // A tile's part sits on the edge to its parent; edges between neighbours
+    // that are not parent and child close a loop and are plain wire.
+    struct Edge {
+        int a, b;
+        int cell;  // owner of the part, -1 for a loop wire
+    };
+    std::vector<Edge> edges;
+    std::vector<int> parent = circuitParents(layout);
+    for (int cell = 0; cell < cellCount; ++cell) {
+        if (types[cell] == EMPTY) continue;
+        if (parent[cell] >= 0) edges.push_back(Edge{parent[cell], cell, cell});
+        int next[2] = {cell % cols + 1 < cols ? cell + 1 : -1, cell + cols < cellCount ? cell + cols : -1};
+        for (int other : next) {
+            if (other < 0 || types[other] == EMPTY || parent[other] == cell || parent[cell] == other) continue;
+            edges.push_back(Edge{cell, other, -1});
+        }
+    }
+
+    // Dead ends carry no current, so peel leaves off until only tiles on a
+    // loop or between START and END are left. A peeled tile sits at the
+    // voltage of the tile it hangs from.
+    std::vector<int> degree(cellCount, 0), incidentStart(cellCount + 1, 0), incident(edges.size() * 2);
+    for (const Edge& edge : edges) {
+        ++incidentStart[edge.a + 1];
+        ++incidentStart[edge.b + 1];
+    }
+    for (int cell = 0; cell < cellCount; ++cell) incidentStart[cell + 1] += incidentStart[cell];
+    std::vector<int> fill(incidentStart.begin(), incidentStart.end() - 1);
+    for (size_t e = 0; e < edges.size(); ++e) {
+        incident[fill[edges[e].a]++] = int(e);
+        incident[fill[edges[e].b]++] = int(e);
+    }
+    std::vector<int> peeled, hangsFrom(cellCount, -1);
+    std::vector<char> removed(cellCount, 0);
+    for (int cell = 0; cell < cellCount; ++cell) {
+        degree[cell] = incidentStart[cell + 1] - incidentStart[cell];
+        if (types[cell] != EMPTY && degree[cell] <= 1 && cell != start && cell != end) {
+            removed[cell] = 1;
+            peeled.push_back(cell);
+        }
+    }
+    for (size_t head = 0; head < peeled.size(); ++head) {
+        int cell = peeled[head];
+        for (int k = incidentStart[cell]; k < incidentStart[cell + 1]; ++k) {
+            const Edge& edge = edges[incident[k]];
+            int other = edge.a == cell ? edge.b : edge.a;
+            if (removed[other]) continue;
+            hangsFrom[cell] = other;
+            if (--degree[other] <= 1 && other != start && other != end) {
+                removed[other] = 1;
+                peeled.push_back(other);
+            }
+        }
+    }
+
+    nodeOf.assign(cellCount, -1);
+    nodeCell.clear();
+    for (int cell = 0; cell < cellCount; ++cell) {
+        if (types[cell] == EMPTY || removed[cell]) continue;
+        nodeOf[cell] = int(nodeCell.size());
+        nodeCell.push_back(cell);
+    }
+    // Tiles hang from tiles peeled later, so resolve in reverse.
+    voltageNode = nodeOf;
+    for (size_t i = peeled.size(); i-- > 0;) {
+        int cell = peeled[i];
+        if (hangsFrom[cell] >= 0) voltageNode[cell] = voltageNode[hangsFrom[cell]];
+    }
+
+    branches.clear();
+    branchOf.assign(cellCount, -1);
+    cells.clear();
+    diodes.clear();
+    for (const Edge& edge : edges) {
+        if (nodeOf[edge.a] < 0 || nodeOf[edge.b] < 0) continue;
+        Branch branch;
+        branch.from = nodeOf[edge.a];
+        branch.to = nodeOf[edge.b];
+        branch.type = edge.cell < 0 ? WIRE : types[edge.cell];
+        if (edge.cell >= 0) {
+            branchOf[edge.cell] = int(branches.size());
+            cells.push_back(edge.cell);
+        }
+        if (branch.type == DIODE) diodes.push_back(int(branches.size()));
+        branches.push_back(branch);
+    }
+
+    // Unknowns are the node voltages and then the supply current.
+    sourceRow = nodeCount();
+    const int startNode = nodeOf[start], endNode = nodeOf[end];
+    std::vector<std::pair<int, int>> couplings;
+    couplings.reserve(branches.size() + 1);
+    for (const Branch& branch : branches) couplings.push_back(std::make_pair(branch.from, branch.to));
+    couplings.push_back(std::make_pair(startNode, sourceRow));
+    lu.analyze(sourceRow + 1, couplings, sourceRow);
+
+    for (Branch& branch : branches) {
+        branch.handles[0] = lu.entry(branch.from, branch.from);
+        branch.handles[1] = lu.entry(branch.to, branch.to);
+        branch.handles[2] = lu.entry(branch.from, branch.to);
+        branch.handles[3] = lu.entry(branch.to, branch.from);
+    }
+    for (int node = 0; node < sourceRow; ++node) lu.add(lu.entry(node, node), GMIN);
+    lu.add(lu.entry(endNode, endNode), 1.0 / LOAD_OHMS);
+    lu.add(lu.entry(startNode, sourceRow), 1.0);
+    lu.add(lu.entry(sourceRow, startNode), 1.0);
+
+    rhs.assign(sourceRow + 1, 0.0);
+    voltages.assign(sourceRow, 0.0);
+    sourceCurrent = 0;
+    reset();
+    return true;
+}
+
+TileType CircuitSim::typeAt(int cell) const {
+    return types[cell];
+}
+
+void CircuitSim::setType(int cell, TileType type) {
+    TileType old = types[cell];
+    if (type == START || type == END || type == EMPTY || old == START || old == END || old == EMPTY || old == type) return;
+    types[cell] = type;
+    if (branchOf[cell] < 0) return;  // a dead end: no current either way
+    Branch& branch = branches[branchOf[cell]];
+    if (branch.type == DIODE) diodes.erase(std::find(diodes.begin(), diodes.end(), branchOf[cell]));
+    if (type == DIODE) diodes.push_back(branchOf[cell]);
+    // The new part starts uncharged; its conductance is restamped on the
+    // next solve. A new diode's Newton guess is the voltage across the old
+    // part, which is close to the answer when the edit changes little.
+    branch.type = type;
+    branch.vd = std::min(voltages[branch.from] - voltages[branch.to], DIODE_START_VOLTS);
+    branch.vPrev = 0;
+}
+
+void CircuitSim::reset() {
+    for (Branch& branch : branches) {
+        branch.vd = DIODE_START_VOLTS;
+        branch.vPrev = 0;
+    }
+}
+
+void CircuitSim::restamp(Branch& branch, double g) {
+    if (g == branch.g) return;
+    double delta = g - branch.g;
+    branch.g = g;
+    lu.add(branch.handles[0], delta);
+    lu.add(branch.handles[1], delta);
+    lu.add(branch.handles[2], -delta);
+    lu.add(branch.handles[3], -delta);
+}
+
+bool CircuitSim::step(double dt) {
+    return dt > 0 && solve(dt);
+}
+
+bool CircuitSim::solveSteady() {
+    return solve(0);
+}
+
+// dt == 0 asks for the DC operating point.
+bool CircuitSim::solve(double dt) {
+    for (Branch& branch : branches) {
+        switch (branch.type) {
+            case RESISTOR:
+                restamp(branch, 1.0 / RESISTOR_OHMS);
+                branch.source = 0;
+                break;
+            case BATTERY:
+                // Norton equivalent of an EMF with internal resistance.
+                restamp(branch, 1.0 / BATTERY_OHMS);
+                branch.source = BATTERY_VOLTS / BATTERY_OHMS;
+                break;
+            case CAPACITOR: {
+                double g = dt > 0 ? CAPACITOR_FARADS / dt : 0.0;
+                restamp(branch, g + 1.0 / CAPACITOR_LEAK_OHMS);
+                branch.source = -g * branch.vPrev;
+                break;
+            }
+            case DIODE:
+                break;  // linearised in the Newton loop
+            default:
+                restamp(branch, 1.0 / WIRE_OHMS);
+                branch.source = 0;
+                break;
+        }
+    }
+
+    // Only the diodes change between iterations, so each refactor touches
+    // just their columns and what lies above them.
+    bool converged = false;
+    for (iterations = 1; iterations <= NEWTON_LIMIT && !converged; ++iterations) {
+        for (int index : diodes) {
+            Branch& branch = branches[index];
+            double e = std::exp(std::min(branch.vd / THERMAL_VOLTS, 80.0));
+            double g = DIODE_SATURATION / THERMAL_VOLTS * e + GMIN;
+            restamp(branch, g);
+            branch.source = DIODE_SATURATION * (e - 1) - g * branch.vd;
+        }
+        if (!lu.factor()) return false;
+
+        std::fill(rhs.begin(), rhs.end(), 0.0);
+        for (const Branch& branch : branches) {
+            rhs[branch.from] -= branch.source;
+            rhs[branch.to] += branch.source;
+        }
+        rhs[sourceRow] = SUPPLY_VOLTS;
+        lu.solve(rhs, x);
+
+        converged = true;
+        for (int index : diodes) {
+            Branch& branch = branches[index];
+            double vd = x[branch.from] - x[branch.to];
+            double scale = std::max(std::fabs(x[branch.from]), std::fabs(x[branch.to]));
+            double exact = DIODE_SATURATION * (std::exp(std::min(vd / THERMAL_VOLTS, 80.0)) - 1);
+            double predicted = branch.g * vd + branch.source;
+            bool voltageSettled = std::fabs(vd - branch.vd) <= NEWTON_RELATIVE * scale + NEWTON_ABSOLUTE;
+            bool currentSettled = std::fabs(exact - predicted) <=
+                                  NEWTON_RELATIVE * std::max(std::fabs(exact), std::fabs(predicted)) + NEWTON_CURRENT;
+            if (!voltageSettled || !currentSettled) {
+                converged = false;
+                branch.vd = limitJunction(vd, branch.vd);
+            }
+        }
+    }
+    --iterations;
+    if (!converged) return false;
+
+    std::copy(x.begin(), x.begin() + sourceRow, voltages.begin());
+    sourceCurrent = -x[sourceRow];
+    for (Branch& branch : branches) {
+        double v = voltages[branch.from] - voltages[branch.to];
+        branch.current = branch.g * v + branch.source;
+        if (branch.type == CAPACITOR) branch.vPrev = v;
+    }
+    return true;
+}
+
+double CircuitSim::voltage(int cell) const {
+    int node = voltageNode[cell];
+    return node < 0 ? 0.0 : voltages[node];
+}
+
+double CircuitSim::current(int cell) const {
+    int branch = branchOf[cell];
+    return branch < 0 ? 0.0 : branches[branch].current;
+}
+
+SimPuzzle scrambleCircuit(CircuitSim& sim, const std::vector<int>& route, uint64_t seed) {
+    const TileType PARTS[] = {WIRE, RESISTOR, DIODE, CAPACITOR, BATTERY};
+    SimPuzzle puzzle;
+    sim.solveSteady();
+    puzzle.target = sim.endVoltage();
+
+    std::vector<int> candidates;
+    std::vector<TileType> original;
+    for (int cell : route) {
+        TileType type = sim.typeAt(cell);
+        if (type == START || type == END) continue;
+        candidates.push_back(cell);
+        original.push_back(type);
+    }
+    const int count = std::min(SCRAMBLE_TILES, int(candidates.size()));
+    if (count == 0) return puzzle;
+
+    auto offTarget = [&] { return sim.solveSteady() && std::fabs(sim.endVoltage() - puzzle.target) > 2 * TARGET_TOLERANCE; };
+    auto restore = [&] {
+        for (size_t i = 0; i < candidates.size(); ++i) sim.setType(candidates[i], original[i]);
+        puzzle.changed.clear();
+    };
+
+    // Retry until the swapped circuit is visibly off target.
+    std::mt19937_64 rng(seed);
+    std::vector<int> picks(candidates.size());
+    for (int attempt = 0; attempt < SCRAMBLE_ATTEMPTS && !puzzle.scrambled; ++attempt) {
+        restore();
+        for (size_t i = 0; i < picks.size(); ++i) picks[i] = int(i);
+        for (int i = 0; i < count; ++i) {
+            std::swap(picks[i], picks[i + rng() % (picks.size() - i)]);
+            int at = picks[i];
+            int current = int(std::find(PARTS, PARTS + 5, original[at]) - PARTS);
+            sim.setType(candidates[at], PARTS[(current + 1 + rng() % 4) % 5]);
+            puzzle.changed.push_back(candidates[at]);
+        }
+        puzzle.scrambled = offTarget();
+    }
+
+    // Two capacitors on the route block DC whatever a few swaps do; wire
+    // them all so current flows.
+    if (!puzzle.scrambled) {
+        restore();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (original[i] != CAPACITOR) continue;
+            sim.setType(candidates[i], WIRE);
+            puzzle.changed.push_back(candidates[i]);
+        }
+        puzzle.scrambled = !puzzle.changed.empty() && offTarget();
+    }
+
+    // Otherwise the random swaps may all have cancelled out; try every
+    // single swap in turn.
+    for (size_t i = 0; i < candidates.size() && !puzzle.scrambled; ++i) {
+        int current = int(std::find(PARTS, PARTS + 5, original[i]) - PARTS);
+        for (int step = 1; step < 5 && !puzzle.scrambled; ++step) {
+            restore();
+            sim.setType(candidates[i], PARTS[(current + step) % 5]);
+            puzzle.changed.push_back(candidates[i]);
+            puzzle.scrambled = offTarget();
+        }
+    }
+    if (!puzzle.scrambled) restore();
+    sim.reset();
+    return puzzle;
+}
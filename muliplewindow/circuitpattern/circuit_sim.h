@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "circuit_layout.h"
+#include "sparse_lu.h"
+
+// Modified nodal analysis of a CircuitLayout.
+//
+// Every conductive tile is a node. A tile's component sits on the branch to
+// the tile it is first reached from when searching out of START, and points
+// away from START: diodes conduct and batteries push current towards END.
+// Wires closing loops are plain wire. START is held at SUPPLY_VOLTS by an
+// ideal source and END drains to ground through a LOAD_OHMS load. Dead ends
+// carry no current and are left out of the matrix.
+//
+// Diodes are solved by Newton iteration and (slightly leaky) capacitors by
+// backward-Euler time steps. Changing a tile restamps just that branch and
+// the sparse LU refactors only the columns it affects.
+const double SUPPLY_VOLTS = 5.0;
+const double LOAD_OHMS = 100.0;
+
+class CircuitSim {
+public:
+    bool build(const CircuitLayout& layout);
+
+    TileType typeAt(int cell) const;
+    // Swaps a tile's component; START and END cannot be changed.
+    void setType(int cell, TileType type);
+
+    // Discharges the capacitors and restarts the diodes' Newton guesses.
+    void reset();
+    // Advances the transient by dt seconds. False if Newton did not
+    // converge or the matrix went singular; the last good state is kept.
+    bool step(double dt);
+    // DC operating point, with capacitors open.
+    bool solveSteady();
+
+    double voltage(int cell) const;
+    // Current through the tile's component, positive away from START.
+    double current(int cell) const;
+    double endVoltage() const { return voltage(end); }
+    // Current drawn from the supply.
+    double supplyCurrent() const { return sourceCurrent; }
+
+    // Cells whose part can carry current (not in a dead end), in no
+    // particular order.
+    const std::vector<int>& componentCells() const { return cells; }
+    int nodeCount() const { return int(nodeCell.size()); }
+    int lastIterations() const { return iterations; }
+    const SparseLU& matrix() const { return lu; }
+
+private:
+    struct Branch {
+        int from, to;      // nodes, from is on the START side
+        TileType type;
+        int handles[4];    // (from,from) (to,to) (from,to) (to,from)
+        double g = 0;      // conductance currently in the matrix
+        double source = 0; // companion current source, from -> to
+        double vd = 0;     // diode linearisation voltage
+        double vPrev = 0;  // capacitor voltage at the last step
+        double current = 0;
+    };
+
+    bool solve(double dt);
+    void restamp(Branch& branch, double g);
+
+    int cols = 0;
+    int start = 0;
+    int end = 0;
+    std::vector<TileType> types;
+    std::vector<int> nodeOf;       // cell -> node, -1 if empty or a dead end
+    std::vector<int> voltageNode;  // cell -> node whose voltage it shares
+    std::vector<int> nodeCell;     // node -> cell
+    std::vector<int> branchOf;  // cell -> its component branch, -1 if none
+    std::vector<int> cells;
+    std::vector<Branch> branches;
+    std::vector<int> diodes;
+
+    SparseLU lu;
+    int sourceRow = 0;
+    std::vector<double> rhs, x, voltages;
+    double sourceCurrent = 0;
+    int iterations = 0;
+};
+
+// A simulation puzzle: a few tiles on the route are swapped for other parts
+// and the player has to bring END back to the voltage the generated
+// circuit gives.
+const double TARGET_TOLERANCE = 0.05;
+
+struct SimPuzzle {
+    double target = 0;
+    std::vector<int> changed;
+    bool scrambled = false;  // END is off target
+};
+
+// Swaps parts on route until END is visibly off target. When no swap moves
+// it, the circuit is left as generated and scrambled is false.
+SimPuzzle scrambleCircuit(CircuitSim& sim, const std::vector<int>& route, uint64_t seed);
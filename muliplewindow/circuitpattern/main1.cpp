@@ -1,31 +1,58 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <vector>
-
+#include <algorithm>
+#include <random>
+#include <string>
+#include "circuit_batch.h"
+#include "circuit_grid.h"
+#include "circuit_layout.h"
+#include "circuit_rules.h"
+#include "room_progress.h"
+
+// Largest tile edge; bigger grids shrink their tiles to fit MAX_GRID_PIXELS.
+// Tiles are never built smaller than MIN_TILE_SIZE; past that the grid view
+// scales them down, below a pixel if need be, so the window stays capped.
 const int TILE_SIZE = 100;
-const int ROWS = 6;
-const int COLS = 6;
+const int MIN_TILE_SIZE = 4;
+const int MAX_GRID_PIXELS = 900;
+// The menu's map shows the room as solved once it is recorded here.
+const char* PROGRESS_FILE = "../../menuforgame/progress.txt";
+const char* ROOM_ID = "circuit";
 const float TIME_LIMIT = 60.0f; // 1 minute
 
-enum TileType { EMPTY, START, END, RESISTOR, WIRE, DIODE, CAPACITOR, BATTERY };
-
-struct Tile {
-    TileType type;
-    sf::RectangleShape shape;
-    sf::Text label;
-    bool visited = false;
-};
-
-std::vector<sf::Vector2i> validPath = {
-    {0,0}, {0,1}, {0,2}, {0,3}, {1,2}, {2,2}, {3,2}, {3,3}, {3,4}, {3,5}
-};
-
-bool isValidStep(int index, sf::Vector2i pos) {
-    return index < validPath.size() && validPath[index] == pos;
-}
-
-int main() {
-    sf::RenderWindow window(sf::VideoMode(COLS * TILE_SIZE, ROWS * TILE_SIZE + 50), "Circuit Maze Game");
+// Usage: circuit_game [rows cols [seed]]. The seed is printed so a layout
+// can be replayed.
+int main(int argc, char* argv[]) {
+    CircuitOptions options;
+    options.seed = std::random_device()();
+    if (argc == 2 || argc > 4 ||
+        (argc > 2 && !(parseCircuitSide(argv[1], options.rows) && parseCircuitSide(argv[2], options.cols))) ||
+        (argc > 3 && !parseCircuitSeed(argv[3], options.seed))) {
+        std::cerr << "Usage: " << argv[0] << " [rows cols [seed]], rows and cols from " << MIN_CIRCUIT_SIDE << " to "
+                  << MAX_CIRCUIT_SIDE << "\n";
+        return 1;
+    }
+    CircuitLayout layout = generateCircuit(options);
+    CircuitRules rules;
+    rules.build(layout);
+    std::cout << "Circuit " << layout.rows << "x" << layout.cols << ", seed " << layout.seed << "\n";
+
+    const int ROWS = layout.rows;
+    const int COLS = layout.cols;
+    const int tileSize = std::max(MIN_TILE_SIZE, std::min(TILE_SIZE, MAX_GRID_PIXELS / std::max(ROWS, COLS)));
+
+    const float gridWidth = float(COLS * tileSize);
+    const float gridHeight = float(ROWS * tileSize);
+    const float windowScale = std::min(1.0f, MAX_GRID_PIXELS / std::max(gridWidth, gridHeight));
+    const int gridPixelWidth = std::max(1, int(gridWidth * windowScale + 0.5f));
+    const int gridPixelHeight = std::max(1, int(gridHeight * windowScale + 0.5f));
+
+    sf::RenderWindow window(sf::VideoMode(gridPixelWidth, gridPixelHeight + 50), "Circuit Maze Game");
+    // The grid is drawn through its own view so it fits above the timer.
+    sf::View gridView(sf::FloatRect(0, 0, gridWidth, gridHeight));
+    gridView.setViewport(sf::FloatRect(0, 0, 1, float(gridPixelHeight) / (gridPixelHeight + 50)));
+    const sf::View hudView = window.getDefaultView();
 
     // Load font
     sf::Font font;
@@ -44,50 +71,15 @@ if (!backgroundTexture.loadFromFile("background.png")) {
 
     sf::Sprite backgroundSprite(backgroundTexture);
     backgroundSprite.setScale(
-        float(COLS * TILE_SIZE) / backgroundTexture.getSize().x,
-        float(ROWS * TILE_SIZE) / backgroundTexture.getSize().y
+        float(COLS * tileSize) / backgroundTexture.getSize().x,
+        float(ROWS * tileSize) / backgroundTexture.getSize().y
     );
 
     // Grid
-    Tile grid[ROWS][COLS];
-    for (int y = 0; y < ROWS; ++y) {
-        for (int x = 0; x < COLS; ++x) {
-            grid[y][x].type = EMPTY;
-            grid[y][x].shape.setSize(sf::Vector2f(TILE_SIZE - 2, TILE_SIZE - 2));
-            grid[y][x].shape.setFillColor(sf::Color::Transparent);
-            grid[y][x].shape.setOutlineColor(sf::Color::White);
-            grid[y][x].shape.setOutlineThickness(1);
-            grid[y][x].shape.setPosition(x * TILE_SIZE, y * TILE_SIZE);
-
-            grid[y][x].label.setFont(font);
-            grid[y][x].label.setCharacterSize(20);
-            grid[y][x].label.setFillColor(sf::Color::White);
-            grid[y][x].label.setPosition(x * TILE_SIZE + 10, y * TILE_SIZE + 35);
-        }
-    }
-
-    std::vector<std::pair<sf::Vector2i, std::string>> components = {
-        {{0,0}, "S"}, {{0,1}, "R"}, {{0,2}, "W"}, {{0,3}, "D"},
-        {{1,2}, "W"}, {{2,2}, "C"}, {{3,2}, "B"},
-        {{3,3}, "W"}, {{3,4}, "W"}, {{3,5}, "E"}
-    };
-
-    for (auto& comp : components) {
-        int y = comp.first.y;
-        int x = comp.first.x;
-        std::string label = comp.second;
-
-        grid[y][x].label.setString(label);
-        if (label == "S") grid[y][x].type = START;
-        else if (label == "E") grid[y][x].type = END;
-        else if (label == "R") grid[y][x].type = RESISTOR;
-        else if (label == "C") grid[y][x].type = CAPACITOR;
-        else if (label == "D") grid[y][x].type = DIODE;
-        else if (label == "B") grid[y][x].type = BATTERY;
-        else if (label == "W") grid[y][x].type = WIRE;
-    }
+    CircuitGrid grid(layout);
+    CircuitBatch batch;
+    batch.build(grid, float(tileSize), font);
 
-    int pathIndex = 0;
     bool gameWon = false, gameLost = false;
 
     sf::Clock clock;
@@ -95,13 +87,13 @@ if (!backgroundTexture.loadFromFile("background.png")) {
     timerText.setFont(font);
     timerText.setCharacterSize(20);
     timerText.setFillColor(sf::Color::Yellow);
-    timerText.setPosition(10, ROWS * TILE_SIZE + 10);
+    timerText.setPosition(10, gridPixelHeight + 10);
 
     sf::Text resultText;
     resultText.setFont(font);
     resultText.setCharacterSize(24);
     resultText.setFillColor(sf::Color::White);
-    resultText.setPosition(200, ROWS * TILE_SIZE + 10);
+    resultText.setPosition(200, gridPixelHeight + 10);
 
     while (window.isOpen()) {
         sf::Event event;
@@ -120,20 +112,20 @@ if (!backgroundTexture.loadFromFile("background.png")) {
 
             if (!gameWon && !gameLost && event.type == sf::Event::MouseButtonPressed) {
                 sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-                int x = mousePos.x / TILE_SIZE;
-                int y = mousePos.y / TILE_SIZE;
-
-                if (x < COLS && y < ROWS) {
-                    if (isValidStep(pathIndex, {y, x})) {
-                        grid[y][x].visited = true;
-                        grid[y][x].shape.setFillColor(sf::Color(0, 255, 0, 100));
-                        pathIndex++;
-                        if (pathIndex == validPath.size()) {
+                int cell = mousePos.y < gridPixelHeight ? batch.cellAt(window.mapPixelToCoords(mousePos, gridView)) : -1;
+
+                if (cell >= 0) {
+                    if (grid.visited(cell)) {
+                        // Already part of the trail.
+                    } else if (rules.canVisit(grid, cell)) {
+                        grid.setFill(cell, FILL_VISITED);
+                        if (rules.visit(grid, cell)) {
                             gameWon = true;
+                            markRoomSolved(PROGRESS_FILE, ROOM_ID);
                             resultText.setString("Success! You completed the circuit.");
                         }
                     } else {
-                        grid[y][x].shape.setFillColor(sf::Color(255, 0, 0, 100));
+                        grid.setFill(cell, FILL_WRONG);
                         gameLost = true;
                         resultText.setString("Wrong step! You lost.");
                     }
@@ -141,16 +133,16 @@ if (!backgroundTexture.loadFromFile("background.png")) {
             }
         }
 
+        batch.sync(grid);
+
         window.clear();
+        window.setView(gridView);
         window.draw(backgroundSprite);
 
         // Draw grid
-        for (int y = 0; y < ROWS; ++y)
-            for (int x = 0; x < COLS; ++x) {
-                window.draw(grid[y][x].shape);
-                window.draw(grid[y][x].label);
-            }
+        batch.draw(window, sf::Color::White);
 
+        window.setView(hudView);
         window.draw(timerText);
         if (gameWon || gameLost)
             window.draw(resultText);
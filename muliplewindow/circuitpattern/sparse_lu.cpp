@@ -0,0 +1,230 @@
+#include "sparse_lu.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+// Minimum-degree ordering on the explicit elimination graph. Fine for the
+// near-planar, low-degree graphs a circuit grid gives; pinned unknowns are
+// kept out of the queue and appended at the end.
+static std::vector<int> minimumDegreeOrder(std::vector<std::vector<int>> adjacency, int pinnedFrom) {
+    const int n = int(adjacency.size());
+    typedef std::pair<size_t, int> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+    for (int v = 0; v < pinnedFrom; ++v) queue.push(Candidate(adjacency[v].size(), v));
+
+    std::vector<char> eliminated(n, 0);
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> merged;
+    while (!queue.empty()) {
+        Candidate top = queue.top();
+        queue.pop();
+        int v = top.second;
+        if (eliminated[v] || top.first != adjacency[v].size()) continue;  // stale entry
+        eliminated[v] = 1;
+        order.push_back(v);
+
+        // Eliminating v joins its neighbours into a clique.
+        const std::vector<int>& around = adjacency[v];
+        for (int u : around) {
+            std::vector<int>& list = adjacency[u];
+            list.erase(std::lower_bound(list.begin(), list.end(), v));
+            merged.clear();
+            std::set_union(list.begin(), list.end(), around.begin(), around.end(), std::back_inserter(merged));
+            merged.erase(std::remove(merged.begin(), merged.end(), u), merged.end());
+            list.swap(merged);
+            if (u < pinnedFrom) queue.push(Candidate(list.size(), u));
+        }
+        adjacency[v].clear();
+        adjacency[v].shrink_to_fit();
+    }
+    for (int v = pinnedFrom; v < n; ++v) order.push_back(v);
+    return order;
+}
+
+void SparseLU::analyze(int size, const std::vector<std::pair<int, int>>& couplings, int pinnedFrom) {
+    n = size;
+    std::vector<std::vector<int>> adjacency(n);
+    for (const std::pair<int, int>& c : couplings) {
+        if (c.first == c.second) continue;
+        adjacency[c.first].push_back(c.second);
+        adjacency[c.second].push_back(c.first);
+    }
+    for (std::vector<int>& list : adjacency) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    order = minimumDegreeOrder(adjacency, std::min(pinnedFrom, n));
+    perm.assign(n, 0);
+    for (int k = 0; k < n; ++k) perm[order[k]] = k;
+
+    // Symbolic factorisation: column k holds A's entries below k plus the
+    // columns of its children in the elimination tree.
+    colStart.assign(n + 1, 0);
+    rowIndex.clear();
+    parent.assign(n, -1);
+    std::vector<std::vector<int>> children(n);
+    std::vector<int> mark(n, -1);
+    std::vector<int> column;
+    for (int k = 0; k < n; ++k) {
+        column.clear();
+        mark[k] = k;
+        for (int u : adjacency[order[k]]) {
+            int p = perm[u];
+            if (p > k && mark[p] != k) { mark[p] = k; column.push_back(p); }
+        }
+        for (int child : children[k]) {
+            for (int e = colStart[child]; e < colStart[child + 1]; ++e) {
+                int p = rowIndex[e];
+                if (mark[p] != k) { mark[p] = k; column.push_back(p); }
+            }
+        }
+        std::sort(column.begin(), column.end());
+        colStart[k] = int(rowIndex.size());
+        rowIndex.insert(rowIndex.end(), column.begin(), column.end());
+        colStart[k + 1] = int(rowIndex.size());
+        if (!column.empty()) {
+            parent[k] = column.front();
+            children[column.front()].push_back(k);
+        }
+        std::vector<int>().swap(children[k]);
+    }
+
+    const size_t entries = rowIndex.size();
+    entryColumn.resize(entries);
+    for (int k = 0; k < n; ++k)
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) entryColumn[e] = k;
+
+    rowStart.assign(n + 1, 0);
+    for (int p : rowIndex) ++rowStart[p + 1];
+    for (int k = 0; k < n; ++k) rowStart[k + 1] += rowStart[k];
+    rowColumn.resize(entries);
+    rowEntry.resize(entries);
+    std::vector<int> fill(rowStart.begin(), rowStart.end() - 1);
+    for (int k = 0; k < n; ++k) {
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) {
+            int slot = fill[rowIndex[e]]++;
+            rowColumn[slot] = k;
+            rowEntry[slot] = e;
+        }
+    }
+
+    aDiag.assign(n, 0.0);
+    aLower.assign(entries, 0.0);
+    aUpper.assign(entries, 0.0);
+    pivot.assign(n, 0.0);
+    lower.assign(entries, 0.0);
+    upper.assign(entries, 0.0);
+    workLower.assign(n, 0.0);
+    workUpper.assign(n, 0.0);
+    dirty.assign(n, 0);
+    dirtyColumns.clear();
+    for (int k = 0; k < n; ++k) markDirty(k);
+}
+
+// Handles are n + 2e for A(row, col) below the diagonal at entry e, n + 2e + 1
+// above it, and the position itself for a diagonal.
+int SparseLU::entry(int i, int j) const {
+    if (i < 0 || j < 0 || i >= n || j >= n) return -1;
+    int pi = perm[i], pj = perm[j];
+    if (pi == pj) return pi;
+    int column = std::min(pi, pj), row = std::max(pi, pj);
+    const int* begin = rowIndex.data() + colStart[column];
+    const int* end = rowIndex.data() + colStart[column + 1];
+    const int* at = std::lower_bound(begin, end, row);
+    if (at == end || *at != row) return -1;
+    int e = int(at - rowIndex.data());
+    return n + 2 * e + (pi < pj ? 1 : 0);
+}
+
+void SparseLU::markDirty(int column) {
+    if (dirty[column]) return;
+    dirty[column] = 1;
+    dirtyColumns.push_back(column);
+}
+
+void SparseLU::add(int handle, double value) {
+    if (handle < 0) return;
+    if (handle < n) {
+        aDiag[handle] += value;
+        markDirty(handle);
+        return;
+    }
+    int e = (handle - n) >> 1;
+    if ((handle - n) & 1) aUpper[e] += value;
+    else aLower[e] += value;
+    markDirty(entryColumn[e]);
+}
+
+bool SparseLU::factor() {
+    // Everything above a changed column in the elimination tree depends on
+    // it; nothing else does.
+    for (size_t i = 0; i < dirtyColumns.size(); ++i) {
+        int p = parent[dirtyColumns[i]];
+        if (p >= 0 && !dirty[p]) {
+            dirty[p] = 1;
+            dirtyColumns.push_back(p);
+        }
+    }
+    std::sort(dirtyColumns.begin(), dirtyColumns.end());
+    refactored = int(dirtyColumns.size());
+
+    bool ok = true;
+    for (int k : dirtyColumns) {
+        dirty[k] = 0;
+        if (!ok) continue;
+
+        // Left-looking: start from A's column and row k, subtract what the
+        // earlier columns in row k contribute.
+        double diagonal = aDiag[k];
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) {
+            workLower[rowIndex[e]] = aLower[e];
+            workUpper[rowIndex[e]] = aUpper[e];
+        }
+        for (int r = rowStart[k]; r < rowStart[k + 1]; ++r) {
+            int j = rowColumn[r];
+            int ej = rowEntry[r];
+            double lkj = lower[ej], ujk = upper[ej];
+            diagonal -= lkj * ujk;
+            for (int e = ej + 1; e < colStart[j + 1]; ++e) {
+                int i = rowIndex[e];
+                workLower[i] -= lower[e] * ujk;
+                workUpper[i] -= lkj * upper[e];
+            }
+        }
+        if (diagonal == 0.0 || !std::isfinite(diagonal)) ok = false;
+        pivot[k] = diagonal;
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) {
+            int i = rowIndex[e];
+            lower[e] = workLower[i] / diagonal;
+            upper[e] = workUpper[i];
+            workLower[i] = workUpper[i] = 0.0;
+        }
+    }
+    dirtyColumns.clear();
+    if (!ok) {
+        // Refactor everything next time rather than trust a partial result.
+        for (int k = 0; k < n; ++k) markDirty(k);
+    }
+    return ok;
+}
+
+void SparseLU::solve(const std::vector<double>& b, std::vector<double>& x) const {
+    std::vector<double>& y = workSolve;
+    y.resize(n);
+    for (int k = 0; k < n; ++k) y[k] = b[order[k]];
+    for (int k = 0; k < n; ++k) {
+        double yk = y[k];
+        if (yk == 0.0) continue;
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) y[rowIndex[e]] -= lower[e] * yk;
+    }
+    for (int k = n - 1; k >= 0; --k) {
+        double sum = y[k];
+        for (int e = colStart[k]; e < colStart[k + 1]; ++e) sum -= upper[e] * y[rowIndex[e]];
+        y[k] = sum / pivot[k];
+    }
+    x.resize(n);
+    for (int k = 0; k < n; ++k) x[order[k]] = y[k];
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Sparse LU factorisation for matrices whose nonzero pattern is symmetric,
+// as nodal analysis produces. Values need not be symmetric. Unknowns are
+// reordered by minimum degree to keep fill low; there is no pivoting, so
+// every pivot must be nonzero in that order (true for nodal matrices with a
+// conductance from each node to ground).
+//
+// Changing a value only marks its column dirty. factor() then recomputes
+// just the dirty columns and their ancestors in the elimination tree, so a
+// small edit to a big circuit costs a path in the tree, not the whole matrix.
+class SparseLU {
+public:
+    // An n x n matrix with the diagonal and the given (i, j) couplings (and
+    // their mirrors) as its pattern. Unknowns from pinnedFrom on are
+    // eliminated last, in index order; use them for rows with a zero
+    // diagonal, such as voltage-source currents. All values start at 0.
+    void analyze(int n, const std::vector<std::pair<int, int>>& couplings, int pinnedFrom);
+
+    // Handle of entry (i, j) for add(), or -1 if it is outside the pattern.
+    int entry(int i, int j) const;
+    void add(int handle, double value);
+
+    // Factors the columns changed since the last call. False (and the old
+    // factors are unusable) if a pivot comes out zero.
+    bool factor();
+    // Solves A x = b with the current factors. x is resized to fit.
+    void solve(const std::vector<double>& b, std::vector<double>& x) const;
+
+    int size() const { return n; }
+    // Off-diagonal entries of L (the same count again is in U).
+    size_t factorEntries() const { return rowIndex.size(); }
+    // Columns recomputed by the last factor().
+    int lastRefactored() const { return refactored; }
+
+private:
+    void markDirty(int column);
+
+    int n = 0;
+    int refactored = 0;
+    std::vector<int> perm;   // original index -> elimination position
+    std::vector<int> order;  // elimination position -> original index
+
+    // Column k of L (and row k of U) has entries at positions
+    // rowIndex[colStart[k] .. colStart[k + 1]), all greater than k.
+    std::vector<int> colStart;
+    std::vector<int> rowIndex;
+    std::vector<int> entryColumn;
+    // Elimination tree: parent[k] is the first entry of column k, or -1.
+    std::vector<int> parent;
+    // The same entries by row: row k has L(k, rowColumn[..]) stored at
+    // entry rowEntry[..], for rowStart[k] .. rowStart[k + 1].
+    std::vector<int> rowStart;
+    std::vector<int> rowColumn;
+    std::vector<int> rowEntry;
+
+    // A and its factors in elimination order. L has a unit diagonal and U
+    // keeps its diagonal in pivot.
+    std::vector<double> aDiag, aLower, aUpper;
+    std::vector<double> pivot, lower, upper;
+
+    std::vector<char> dirty;
+    std::vector<int> dirtyColumns;
+    std::vector<double> workLower, workUpper;
+    mutable std::vector<double> workSolve;
+};
@@ -0,0 +1,180 @@
+#include "hotspot_layer.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+// Children per R-tree node.
+const int NODE_FANOUT = 8;
+
+HitMask::HitMask(const RgbaImage& image, uint8_t threshold)
+    : width(image.width), height(image.height), words((size_t(image.width) * image.height + 63) / 64, 0) {
+    const size_t pixels = size_t(image.width) * image.height;
+    for (size_t bit = 0; bit < pixels; ++bit)
+        if (image.pixels[bit * 4 + 3] >= threshold) words[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+HitMask HitMask::resized(int w, int h) const {
+    HitMask mask;
+    if (empty() || w <= 0 || h <= 0) return mask;
+    mask.width = w;
+    mask.height = h;
+    mask.words.assign((size_t(w) * h + 63) / 64, 0);
+    for (int y = 0; y < h; ++y) {
+        int sy = int(int64_t(y) * height / h);
+        for (int x = 0; x < w; ++x) {
+            if (!test(int(int64_t(x) * width / w), sy)) continue;
+            size_t bit = size_t(y) * w + x;
+            mask.words[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    return mask;
+}
+
+bool Hotspot::contains(int px, int py) const {
+    if (px < x || py < y || px >= x + w || py >= y + h) return false;
+    return mask.empty() || mask.test(px - x, py - y);
+}
+
+int HotspotLayer::add(const std::string& name, int x, int y, int w, int h, HitMask mask) {
+    Hotspot spot;
+    spot.name = name;
+    spot.x = x, spot.y = y, spot.w = w, spot.h = h;
+    spot.mask = mask.empty() || (mask.w() == w && mask.h() == h) ? std::move(mask) : mask.resized(w, h);
+    spots.push_back(std::move(spot));
+    dirty = true;
+    return int(spots.size()) - 1;
+}
+
+void HotspotLayer::move(int id, int x, int y, int w, int h) {
+    Hotspot& spot = spots[id];
+    if (spot.x == x && spot.y == y && spot.w == w && spot.h == h) return;
+    if (!spot.mask.empty() && (spot.w != w || spot.h != h)) spot.mask = spot.mask.resized(w, h);
+    spot.x = x, spot.y = y, spot.w = w, spot.h = h;
+    dirty = true;
+}
+
+bool HotspotLayer::load(const std::string& path, const ImageDecoder& decode) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open hotspots " << path << std::endl;
+        return false;
+    }
+    const fs::path folder = fs::path(path).parent_path();
+    std::string line;
+    for (int number = 1; std::getline(in, line); ++number) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string name, maskFile;
+        int x, y, w, h;
+        if (!(words >> name)) continue;
+        if (!(words >> x >> y >> w >> h) || w <= 0 || h <= 0) {
+            std::cerr << path << ":" << number << ": expected name x y w h" << std::endl;
+            return false;
+        }
+        HitMask mask;
+        if (words >> maskFile) {
+            int threshold = 128;
+            words >> threshold;
+            RgbaImage image;
+            if (!loadScaledImage((folder / maskFile).string(), w, h, decode, image)) return false;
+            if (image.width != w || image.height != h) image = resampleImage(image, w, h);
+            mask = HitMask(image, uint8_t(std::clamp(threshold, 1, 255)));
+        }
+        add(name, x, y, w, h, std::move(mask));
+    }
+    return true;
+}
+
+int HotspotLayer::find(const std::string& name) const {
+    for (int id = 0; id < size(); ++id)
+        if (spots[id].name == name) return id;
+    return -1;
+}
+
+// Sort-tile-recursive packing: sort by x, cut into vertical slices, sort
+// each slice by y and fill nodes in that order; then the same again on the
+// nodes until one is left.
+void HotspotLayer::build() const {
+    nodes.clear();
+    leafIds.resize(spots.size());
+    for (int id = 0; id < size(); ++id) leafIds[id] = id;
+    dirty = false;
+    if (spots.empty()) return;
+
+    auto tile = [](auto& items, auto centerX, auto centerY) {
+        const size_t groups = (items.size() + NODE_FANOUT - 1) / NODE_FANOUT;
+        const size_t slices = size_t(std::ceil(std::sqrt(double(groups))));
+        const size_t perSlice = slices * NODE_FANOUT;
+        std::sort(items.begin(), items.end(), [&](const auto& a, const auto& b) { return centerX(a) < centerX(b); });
+        for (size_t start = 0; start < items.size(); start += perSlice) {
+            auto end = items.begin() + std::min(items.size(), start + perSlice);
+            std::sort(items.begin() + start, end, [&](const auto& a, const auto& b) { return centerY(a) < centerY(b); });
+        }
+    };
+    auto pack = [&](int first, int count, bool leaf) {
+        Node node = {0, 0, 0, 0, first, count, leaf};
+        for (int i = 0; i < count; ++i) {
+            int left, top, right, bottom;
+            if (leaf) {
+                const Hotspot& s = spots[leafIds[first + i]];
+                left = s.x, top = s.y, right = s.x + s.w, bottom = s.y + s.h;
+            } else {
+                const Node& child = nodes[first + i];
+                left = child.left, top = child.top, right = child.right, bottom = child.bottom;
+            }
+            if (i == 0) {
+                node.left = left, node.top = top, node.right = right, node.bottom = bottom;
+            } else {
+                node.left = std::min(node.left, left), node.top = std::min(node.top, top);
+                node.right = std::max(node.right, right), node.bottom = std::max(node.bottom, bottom);
+            }
+        }
+        return node;
+    };
+
+    tile(leafIds, [&](int id) { return 2 * spots[id].x + spots[id].w; },
+         [&](int id) { return 2 * spots[id].y + spots[id].h; });
+    for (int first = 0; first < size(); first += NODE_FANOUT)
+        nodes.push_back(pack(first, std::min(NODE_FANOUT, size() - first), true));
+
+    // Each level is appended after the one below, so children stay
+    // contiguous and the root ends up last.
+    size_t levelStart = 0;
+    while (nodes.size() - levelStart > 1) {
+        std::vector<Node> level(nodes.begin() + levelStart, nodes.end());
+        tile(level, [](const Node& n) { return n.left + n.right; }, [](const Node& n) { return n.top + n.bottom; });
+        std::copy(level.begin(), level.end(), nodes.begin() + levelStart);
+        const int count = int(level.size());
+        const size_t next = nodes.size();
+        for (int i = 0; i < count; i += NODE_FANOUT)
+            nodes.push_back(pack(int(levelStart) + i, std::min(NODE_FANOUT, count - i), false));
+        levelStart = next;
+    }
+}
+
+int HotspotLayer::hit(int x, int y) const {
+    if (dirty) build();
+    if (nodes.empty()) return -1;
+    int best = -1;
+    int stack[64];  // (levels) * (NODE_FANOUT - 1) + 1 deep at most
+    int depth = 0;
+    stack[depth++] = int(nodes.size()) - 1;
+    while (depth > 0) {
+        const Node& node = nodes[stack[--depth]];
+        if (x < node.left || y < node.top || x >= node.right || y >= node.bottom) continue;
+        for (int i = 0; i < node.count; ++i) {
+            if (!node.leaf) {
+                stack[depth++] = node.first + i;
+                continue;
+            }
+            int id = leafIds[node.first + i];
+            if (id > best && spots[id].contains(x, y)) best = id;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "scaled_image.h"
+
+// Clickable regions of a scene, looked up by point.
+//
+// A hotspot is a rectangle, optionally narrowed to the opaque pixels of an
+// image drawn over it (one bit per pixel). Later hotspots sit on top of
+// earlier ones. Lookups go through an R-tree packed by sort-tile-recursive,
+// rebuilt on the next lookup after anything moves, so a click or hover
+// costs a few node visits even with hundreds of props.
+//
+// A layer can be read from a text file, one hotspot per line:
+//
+//   # name  x y w h  [mask.png [alpha_threshold]]
+//   monitor 320 256 512 320
+//   lamp    40 100 96 220  props/lamp.png 32
+//
+// Masks are the image scaled to w x h (see scaled_image.h), with paths
+// relative to the file.
+
+// One bit per pixel of a w x h box, row after row.
+class HitMask {
+public:
+    HitMask() = default;
+    // Bits set where alpha >= threshold.
+    HitMask(const RgbaImage& image, uint8_t threshold);
+
+    // The same mask stretched to w x h, nearest bit.
+    HitMask resized(int w, int h) const;
+
+    bool empty() const { return words.empty(); }
+    int w() const { return width; }
+    int h() const { return height; }
+    bool test(int x, int y) const {
+        size_t bit = size_t(y) * width + x;
+        return (words[bit >> 6] >> (bit & 63)) & 1;
+    }
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<uint64_t> words;
+};
+
+struct Hotspot {
+    std::string name;
+    int x = 0, y = 0, w = 0, h = 0;
+    HitMask mask;  // empty = the whole rectangle
+
+    bool contains(int px, int py) const;
+};
+
+class HotspotLayer {
+public:
+    // Appends a hotspot on top of the others and returns its id. A mask of
+    // another size is stretched to w x h, and so is the mask of a hotspot
+    // moved to a new size.
+    int add(const std::string& name, int x, int y, int w, int h, HitMask mask = HitMask());
+    void move(int id, int x, int y, int w, int h);
+    // Reads hotspots from a file (format above), decoding masks with
+    // decode. False, with the line on std::cerr, if the file is bad.
+    bool load(const std::string& path, const ImageDecoder& decode);
+
+    // Topmost hotspot at (x, y), or -1.
+    int hit(int x, int y) const;
+    // Id of the first hotspot with that name, or -1.
+    int find(const std::string& name) const;
+
+    int size() const { return int(spots.size()); }
+    const Hotspot& operator[](int id) const { return spots[id]; }
+
+private:
+    struct Node {
+        int left, top, right, bottom;  // bounding box, right/bottom exclusive
+        int first, count;              // children, or hotspot ids in leafIds
+        bool leaf;
+    };
+
+    void build() const;
+
+    std::vector<Hotspot> spots;
+    mutable bool dirty = true;
+    mutable std::vector<Node> nodes;  // root last
+    mutable std::vector<int> leafIds;
+};
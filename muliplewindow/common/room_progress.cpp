@@ -0,0 +1,19 @@
+#include "room_progress.h"
+#include <fstream>
+#include <iostream>
+
+bool markRoomSolved(const std::string& progressFile, const std::string& roomId) {
+    std::ifstream in(progressFile);
+    std::string id;
+    while (in >> id) {
+        if (id == roomId) return true;
+    }
+    in.close();
+
+    std::ofstream out(progressFile, std::ios::app);
+    if (!(out << roomId << "\n")) {
+        std::cerr << "Failed to record progress in " << progressFile << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+// Rooms record that they were cleared in the menu's progress file, which the
+// map screen reads: one room id per line, matching the ids in the menu's
+// room list. Marking a room twice leaves a single line. Like the rooms'
+// other assets, progressFile is relative to the working directory.
+bool markRoomSolved(const std::string& progressFile, const std::string& roomId);
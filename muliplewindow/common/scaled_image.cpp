@@ -0,0 +1,320 @@
+#include "scaled_image.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCALED_IMAGE_SSE 1
+#endif
+
+namespace fs = std::filesystem;
+
+// One premultiplied RGBA pixel as four floats.
+#ifdef SCALED_IMAGE_SSE
+struct Pixel {
+    __m128 v;
+    Pixel() : v(_mm_setzero_ps()) {}
+    explicit Pixel(__m128 v) : v(v) {}
+    Pixel operator+(Pixel o) const { return Pixel(_mm_add_ps(v, o.v)); }
+    Pixel operator*(float w) const { return Pixel(_mm_mul_ps(v, _mm_set1_ps(w))); }
+};
+#else
+struct Pixel {
+    float v[4] = {0, 0, 0, 0};
+    Pixel operator+(Pixel o) const {
+        Pixel p;
+        for (int c = 0; c < 4; ++c) p.v[c] = v[c] + o.v[c];
+        return p;
+    }
+    Pixel operator*(float w) const {
+        Pixel p;
+        for (int c = 0; c < 4; ++c) p.v[c] = v[c] * w;
+        return p;
+    }
+};
+#endif
+
+struct FloatImage {
+    int width = 0;
+    int height = 0;
+    std::vector<Pixel> pixels;
+    Pixel& at(int x, int y) { return pixels[size_t(y) * width + x]; }
+};
+
+static FloatImage toFloat(const RgbaImage& image) {
+    FloatImage out;
+    out.width = image.width;
+    out.height = image.height;
+    out.pixels.resize(size_t(image.width) * image.height);
+    const uint8_t* p = image.pixels.data();
+    for (Pixel& pixel : out.pixels) {
+        float a = p[3] / 255.0f;
+#ifdef SCALED_IMAGE_SSE
+        pixel.v = _mm_set_ps(a, p[2] * a, p[1] * a, p[0] * a);
+#else
+        pixel.v[0] = p[0] * a, pixel.v[1] = p[1] * a, pixel.v[2] = p[2] * a, pixel.v[3] = a;
+#endif
+        p += 4;
+    }
+    return out;
+}
+
+static RgbaImage toRgba(const FloatImage& image) {
+    RgbaImage out;
+    out.width = image.width;
+    out.height = image.height;
+    out.pixels.resize(size_t(image.width) * image.height * 4);
+    uint8_t* p = out.pixels.data();
+    for (const Pixel& pixel : image.pixels) {
+        float c[4];
+#ifdef SCALED_IMAGE_SSE
+        _mm_storeu_ps(c, pixel.v);
+#else
+        std::copy(pixel.v, pixel.v + 4, c);
+#endif
+        float a = std::clamp(c[3], 0.0f, 1.0f);
+        float unpremultiply = a > 0 ? 1.0f / a : 0.0f;
+        for (int k = 0; k < 3; ++k) p[k] = uint8_t(std::clamp(c[k] * unpremultiply, 0.0f, 255.0f) + 0.5f);
+        p[3] = uint8_t(a * 255.0f + 0.5f);
+        p += 4;
+    }
+    return out;
+}
+
+// Halves the width and/or height by averaging pixel pairs. An odd last
+// column or row is averaged with itself.
+static FloatImage halve(FloatImage& image, bool halveX, bool halveY) {
+    FloatImage out;
+    out.width = halveX ? (image.width + 1) / 2 : image.width;
+    out.height = halveY ? (image.height + 1) / 2 : image.height;
+    out.pixels.resize(size_t(out.width) * out.height);
+    const float weight = 1.0f / ((halveX ? 2 : 1) * (halveY ? 2 : 1));
+    for (int y = 0; y < out.height; ++y) {
+        int y0 = halveY ? 2 * y : y, y1 = halveY ? std::min(y0 + 1, image.height - 1) : y0;
+        for (int x = 0; x < out.width; ++x) {
+            int x0 = halveX ? 2 * x : x, x1 = halveX ? std::min(x0 + 1, image.width - 1) : x0;
+            Pixel sum = image.at(x0, y0);
+            if (halveX) sum = sum + image.at(x1, y0);
+            if (halveY) sum = sum + image.at(x0, y1);
+            if (halveX && halveY) sum = sum + image.at(x1, y1);
+            out.at(x, y) = sum * weight;
+        }
+    }
+    return out;
+}
+
+static double lanczos3(double x) {
+    const double PI = 3.14159265358979323846;
+    x = std::fabs(x);
+    if (x < 1e-8) return 1.0;
+    if (x >= 3.0) return 0.0;
+    double px = PI * x;
+    return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+}
+
+// Lanczos-3 taps for each output sample along one axis, normalised to sum
+// to 1 and clamped to the edge.
+struct Taps {
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;  // count[i] weights for sample i, in order
+    std::vector<size_t> offset;
+};
+
+static Taps makeTaps(int from, int to) {
+    Taps taps;
+    const double scale = double(from) / to;
+    const double stretch = std::max(scale, 1.0);
+    const double support = 3.0 * stretch;
+    for (int i = 0; i < to; ++i) {
+        double center = (i + 0.5) * scale;
+        int lo = std::max(0, int(std::floor(center - support)));
+        int hi = std::min(from - 1, int(std::ceil(center + support)));
+        double total = 0;
+        size_t start = taps.weights.size();
+        for (int k = lo; k <= hi; ++k) {
+            double w = lanczos3((k + 0.5 - center) / stretch);
+            taps.weights.push_back(float(w));
+            total += w;
+        }
+        for (size_t k = start; k < taps.weights.size(); ++k) taps.weights[k] = float(taps.weights[k] / total);
+        taps.first.push_back(lo);
+        taps.count.push_back(hi - lo + 1);
+        taps.offset.push_back(start);
+    }
+    return taps;
+}
+
+static FloatImage lanczos(FloatImage& image, int width, int height) {
+    // Horizontal pass into width x image.height, then vertical.
+    FloatImage wide;
+    wide.width = width;
+    wide.height = image.height;
+    wide.pixels.resize(size_t(width) * image.height);
+    Taps across = makeTaps(image.width, width);
+    for (int y = 0; y < image.height; ++y) {
+        const Pixel* row = &image.at(0, y);
+        for (int x = 0; x < width; ++x) {
+            const float* w = &across.weights[across.offset[x]];
+            const Pixel* src = row + across.first[x];
+            Pixel sum;
+            for (int k = 0; k < across.count[x]; ++k) sum = sum + src[k] * w[k];
+            wide.at(x, y) = sum;
+        }
+    }
+
+    FloatImage out;
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(size_t(width) * height);
+    Taps down = makeTaps(image.height, height);
+    for (int y = 0; y < height; ++y) {
+        const float* w = &down.weights[down.offset[y]];
+        Pixel* dst = &out.at(0, y);
+        for (int k = 0; k < down.count[y]; ++k) {
+            // Row at a time, so the inner loop walks memory in order.
+            const Pixel* src = &wide.at(0, down.first[y] + k);
+            for (int x = 0; x < width; ++x) dst[x] = dst[x] + src[x] * w[k];
+        }
+    }
+    return out;
+}
+
+RgbaImage resampleImage(const RgbaImage& source, int width, int height) {
+    if (width == source.width && height == source.height) return source;
+    FloatImage image = toFloat(source);
+    for (;;) {
+        bool halveX = image.width > 2 * width, halveY = image.height > 2 * height;
+        if (!halveX && !halveY) break;
+        image = halve(image, halveX, halveY);
+    }
+    image = lanczos(image, width, height);
+    return toRgba(image);
+}
+
+// Cache file: a header naming the source file's size and modification time
+// (and its dimensions), then the pixels.
+struct CacheHeader {
+    char magic[4] = {'S', 'I', 'M', '2'};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t sourceWidth = 0;
+    uint32_t sourceHeight = 0;
+    uint64_t sourceBytes = 0;
+    int64_t sourceTime = 0;
+};
+
+static fs::path cachePath(const std::string& path, const std::string& size) {
+    std::string name = fs::absolute(path).lexically_normal().string();
+    for (char& c : name)
+        if (c == '/' || c == '\\' || c == ':' || c == ' ') c = '_';
+    return fs::path(SCALED_IMAGE_CACHE) / (name + "." + size + ".rgba");
+}
+
+static bool describeSource(const std::string& path, CacheHeader& header) {
+    std::error_code error;
+    header.sourceBytes = fs::file_size(path, error);
+    if (error) return false;
+    header.sourceTime = int64_t(fs::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+
+// The scaled size is whatever was stored: it depends on the source's size,
+// which is not known until it is decoded. On success source gets the rest
+// of the stored header.
+static bool readCache(const fs::path& file, CacheHeader& source, RgbaImage& out) {
+    std::ifstream in(file, std::ios::binary);
+    CacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof header)) return false;
+    if (!std::equal(header.magic, header.magic + 4, source.magic) || header.sourceBytes != source.sourceBytes ||
+        header.sourceTime != source.sourceTime)
+        return false;
+    source = header;
+    out.width = int(header.width);
+    out.height = int(header.height);
+    out.pixels.resize(size_t(out.width) * out.height * 4);
+    return bool(in.read(reinterpret_cast<char*>(out.pixels.data()), std::streamsize(out.pixels.size())));
+}
+
+// Written under a temporary name and renamed, so a reader never sees half a
+// file.
+static void writeCache(const fs::path& file, const CacheHeader& header, const RgbaImage& image) {
+    std::error_code error;
+    fs::create_directories(file.parent_path(), error);
+    fs::path temporary = file;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(image.pixels.data()), std::streamsize(image.pixels.size()));
+        if (!out) {
+            std::cerr << "Could not write " << temporary.string() << std::endl;
+            return;
+        }
+    }
+    fs::rename(temporary, file, error);
+    if (error) std::cerr << "Could not write " << file.string() << ": " << error.message() << std::endl;
+}
+
+// Shared by both entry points: target maps the decoded size to the scaled
+// one, and size names it in the cache.
+template <typename Target>
+static bool loadScaled(const std::string& path, const std::string& size, Target target, const ImageDecoder& decode,
+                       RgbaImage& out, CacheHeader& header) {
+    bool described = describeSource(path, header);
+    fs::path file = cachePath(path, size);
+    if (described && readCache(file, header, out)) return true;
+
+    RgbaImage decoded;
+    if (!decode(path, decoded)) return false;
+    header.sourceWidth = uint32_t(decoded.width);
+    header.sourceHeight = uint32_t(decoded.height);
+    int width = decoded.width, height = decoded.height;
+    target(width, height);
+    width = std::clamp(width, 1, decoded.width);
+    height = std::clamp(height, 1, decoded.height);
+    if (width == decoded.width && height == decoded.height) {
+        out = std::move(decoded);
+        return true;
+    }
+    out = resampleImage(decoded, width, height);
+    if (described) {
+        header.width = uint32_t(width);
+        header.height = uint32_t(height);
+        writeCache(file, header, out);
+    }
+    return true;
+}
+
+bool loadScaledImage(const std::string& path, int width, int height, const ImageDecoder& decode, RgbaImage& out) {
+    CacheHeader header;
+    std::string size = std::to_string(width) + "x" + std::to_string(height);
+    return loadScaled(
+        path, size,
+        [&](int& w, int& h) {
+            w = width;
+            h = height;
+        },
+        decode, out, header);
+}
+
+bool loadScaledImage(const std::string& path, double scale, const ImageDecoder& decode, RgbaImage& out,
+                     int& sourceWidth, int& sourceHeight) {
+    CacheHeader header;
+    std::ostringstream size;
+    size << "x" << scale;
+    auto target = [&](int& w, int& h) {
+        w = int(std::lround(w * scale));
+        h = int(std::lround(h * scale));
+    };
+    if (!loadScaled(path, size.str(), target, decode, out, header)) return false;
+    sourceWidth = header.sourceWidth ? int(header.sourceWidth) : out.width;
+    sourceHeight = header.sourceHeight ? int(header.sourceHeight) : out.height;
+    return true;
+}
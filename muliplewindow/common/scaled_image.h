@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Load-time downscaling of artwork to the size it is drawn at, with the
+// results cached on disk. Nothing here depends on SDL or SFML; each program
+// supplies a decoder and turns the pixels into its own texture type.
+
+// 8-bit RGBA, rows top to bottom, alpha not premultiplied.
+struct RgbaImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Resamples to width x height. Each axis is first halved with a 2x2 box
+// filter while it is more than twice the target, then a separable Lanczos-3
+// pass takes it the rest of the way. Filtering is done on premultiplied
+// alpha, four channels at a time (SSE where available).
+RgbaImage resampleImage(const RgbaImage& source, int width, int height);
+
+typedef std::function<bool(const std::string& path, RgbaImage& image)> ImageDecoder;
+
+// Scaled copies live here, relative to the working directory.
+const char* const SCALED_IMAGE_CACHE = "scaled_cache";
+
+// The image at path, downscaled to at most width x height (an axis that is
+// already smaller is left alone). Comes from the disk cache if the copy there
+// was made from the file as it is now; otherwise the image is decoded,
+// resampled and cached. False if it cannot be decoded.
+bool loadScaledImage(const std::string& path, int width, int height, const ImageDecoder& decode, RgbaImage& out);
+// The same with the size given as a fraction of the image's own, which is
+// stored in sourceWidth x sourceHeight (from the cache, without decoding).
+bool loadScaledImage(const std::string& path, double scale, const ImageDecoder& decode, RgbaImage& out,
+                     int& sourceWidth, int& sourceHeight);
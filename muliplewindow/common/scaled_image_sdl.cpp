@@ -0,0 +1,53 @@
+#include "scaled_image_sdl.h"
+#include <SDL2/SDL_image.h>
+#include <cstring>
+#include <iostream>
+
+bool decodeWithSdlImage(const std::string& path, RgbaImage& image) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (!loaded) {
+        std::cerr << "Failed to load image " << path << ": " << IMG_GetError() << std::endl;
+        return false;
+    }
+    // RGBA32 is R, G, B, A in memory whatever the byte order.
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!rgba) {
+        std::cerr << "Failed to convert image " << path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    image.width = rgba->w;
+    image.height = rgba->h;
+    image.pixels.resize(size_t(rgba->w) * rgba->h * 4);
+    SDL_LockSurface(rgba);
+    for (int y = 0; y < rgba->h; ++y)
+        std::memcpy(&image.pixels[size_t(y) * rgba->w * 4], static_cast<const uint8_t*>(rgba->pixels) + y * rgba->pitch,
+                    size_t(rgba->w) * 4);
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+    return true;
+}
+
+SDL_Surface* loadScaledSurface(const std::string& path, int width, int height) {
+    RgbaImage image;
+    if (!loadScaledImage(path, width, height, decodeWithSdlImage, image)) return nullptr;
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, image.width, image.height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        std::cerr << "Failed to create surface for " << path << ": " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    SDL_LockSurface(surface);
+    for (int y = 0; y < image.height; ++y)
+        std::memcpy(static_cast<uint8_t*>(surface->pixels) + y * surface->pitch, &image.pixels[size_t(y) * image.width * 4],
+                    size_t(image.width) * 4);
+    SDL_UnlockSurface(surface);
+    return surface;
+}
+
+SDL_Texture* loadScaledTexture(SDL_Renderer* renderer, const std::string& path, int width, int height) {
+    SDL_Surface* surface = loadScaledSurface(path, width, height);
+    if (!surface) return nullptr;
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    return texture;
+}
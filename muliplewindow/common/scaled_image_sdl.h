@@ -0,0 +1,15 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <string>
+#include "scaled_image.h"
+
+// Decodes with SDL_image into RGBA. Safe to call from a worker thread.
+bool decodeWithSdlImage(const std::string& path, RgbaImage& image);
+
+// loadScaledImage as a new surface (free with SDL_FreeSurface), or nullptr
+// with the reason on std::cerr.
+SDL_Surface* loadScaledSurface(const std::string& path, int width, int height);
+
+// The same, uploaded as a texture. Main thread only.
+SDL_Texture* loadScaledTexture(SDL_Renderer* renderer, const std::string& path, int width, int height);
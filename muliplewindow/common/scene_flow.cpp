@@ -0,0 +1,107 @@
+#include "scene_flow.h"
+#include <algorithm>
+
+FlowRunner::FlowRunner() : startCounter(SDL_GetPerformanceCounter()) {}
+
+void FlowRunner::start(Flow<> flow) {
+    flow.handle.resume();
+    if (flow.done()) {
+        if (flow.handle.promise().error) std::rethrow_exception(flow.handle.promise().error);
+        return;
+    }
+    flows.push_back(std::move(flow));
+}
+
+void FlowRunner::dispatch(const SDL_Event& event) {
+    pending.push_back(event);
+}
+
+FlowRunner::EventAwait FlowRunner::keyPressed(SDL_Keycode key) {
+    return nextEvent([key](const SDL_Event& event) {
+        return event.type == SDL_KEYDOWN && event.key.keysym.sym == key && !event.key.repeat;
+    });
+}
+
+FlowRunner::EventAwait FlowRunner::mouseClicked() {
+    return nextEvent([](const SDL_Event& event) {
+        return event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT;
+    });
+}
+
+void FlowRunner::waitForText(TimedTextAwait* await, std::coroutine_handle<> handle) {
+    if (textWaits.empty()) SDL_StartTextInput();
+    textWaits.push_back({await, clock + await->timeout, handle});
+}
+
+void FlowRunner::typeInto(TextWait& wait, const SDL_Event& event, std::vector<std::coroutine_handle<>>& ready) {
+    TextField& field = wait.await->field;
+    if (event.type == SDL_TEXTINPUT) {
+        field.text += event.text.text;
+        if (field.text.size() > field.maxLength) field.text.resize(field.maxLength);
+    } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_BACKSPACE && !field.text.empty()) {
+        field.text.pop_back();
+    } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_RETURN && !field.text.empty()) {
+        wait.await->result = field.text;
+        ready.push_back(wait.handle);
+        wait.handle = nullptr;
+    }
+}
+
+// Waits are collected first and resumed after, so a flow that waits again
+// while being resumed is not resumed twice in one update.
+void FlowRunner::update() {
+    if (stopped) return;
+    clock = double(SDL_GetPerformanceCounter() - startCounter) / SDL_GetPerformanceFrequency();
+    current.swap(pending);
+    pending.clear();
+    std::vector<std::coroutine_handle<>> ready;
+
+    while (!timers.empty() && timers.top().due <= clock) {
+        ready.push_back(timers.top().handle);
+        timers.pop();
+    }
+
+    for (const SDL_Event& event : current) {
+        for (EventWait& wait : eventWaits) {
+            if (!wait.handle || !wait.await->match(event)) continue;
+            wait.await->event = event;
+            ready.push_back(wait.handle);
+            wait.handle = nullptr;
+        }
+        if (!textWaits.empty()) typeInto(textWaits.back(), event, ready);
+        textWaits.erase(std::remove_if(textWaits.begin(), textWaits.end(),
+                                       [](const TextWait& wait) { return !wait.handle; }),
+                        textWaits.end());
+    }
+    eventWaits.erase(std::remove_if(eventWaits.begin(), eventWaits.end(),
+                                    [](const EventWait& wait) { return !wait.handle; }),
+                     eventWaits.end());
+
+    for (TextWait& wait : textWaits) {
+        if (wait.deadline > clock) continue;
+        ready.push_back(wait.handle);
+        wait.handle = nullptr;
+    }
+    textWaits.erase(std::remove_if(textWaits.begin(), textWaits.end(),
+                                   [](const TextWait& wait) { return !wait.handle; }),
+                    textWaits.end());
+    if (textWaits.empty() && SDL_IsTextInputActive()) SDL_StopTextInput();
+
+    std::vector<std::coroutine_handle<>> frame;
+    frame.swap(frameWaits);
+    ready.insert(ready.end(), frame.begin(), frame.end());
+
+    for (std::coroutine_handle<> handle : ready) {
+        if (stopped) break;
+        handle.resume();
+    }
+
+    std::exception_ptr error;
+    size_t kept = 0;
+    for (Flow<>& flow : flows) {
+        if (!flow.done()) flows[kept++] = std::move(flow);
+        else if (!error) error = flow.handle.promise().error;
+    }
+    flows.resize(kept);
+    if (error) std::rethrow_exception(error);
+}
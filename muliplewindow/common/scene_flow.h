@@ -0,0 +1,248 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Scene sequencing with C++20 coroutines.
+//
+// A scene flow is written top to bottom and suspends where it used to spin
+// in a loop of its own:
+//
+//   Flow<> intro(FlowRunner& flows, Screen& screen, TextField& name) {
+//       screen = NAME_ENTRY;
+//       std::string player = co_await flows.textEntered(name);
+//       screen = GREETING;
+//       co_await flows.seconds(2);
+//       ...
+//   }
+//
+// The program keeps a single main loop: poll SDL events into dispatch(),
+// call update() once, draw whatever the flows left on screen, present.
+// Every flow is resumed from update(), so nothing blocks and the one event
+// pump keeps all windows responsive. Waiting costs nothing per frame: timers
+// sit in a heap ordered by due time and only the ones due are touched, so a
+// script can keep thousands of them in flight.
+//
+// Everything runs on the main thread.
+
+class FlowRunner;
+
+// A line of text being typed, shared between textEntered() and whatever
+// draws it.
+struct TextField {
+    std::string text;
+    size_t maxLength = 32;
+};
+
+template <typename T = void>
+class Flow;
+
+namespace flow_detail {
+
+template <typename T>
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // Flows start when awaited or handed to FlowRunner::start().
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // Finishing resumes whoever awaited this flow.
+    struct FinalAwait {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> done) noexcept {
+            std::coroutine_handle<> next = done.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwait final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase<T> {
+    std::optional<T> value;
+    Flow<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+};
+
+template <>
+struct Promise<void> : PromiseBase<void> {
+    Flow<void> get_return_object();
+    void return_void() {}
+};
+
+}  // namespace flow_detail
+
+// A scene flow, or a step of one that returns T. Awaiting it runs it to
+// completion; destroying it abandons it wherever it is suspended.
+template <typename T>
+class Flow {
+public:
+    using promise_type = flow_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Flow() = default;
+    explicit Flow(Handle handle) : handle(handle) {}
+    Flow(Flow&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Flow& operator=(Flow&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Flow() {
+        if (handle) handle.destroy();
+    }
+
+    bool done() const { return !handle || handle.done(); }
+
+    bool await_ready() const { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() {
+        if (handle.promise().error) std::rethrow_exception(handle.promise().error);
+        if constexpr (!std::is_void_v<T>) return std::move(*handle.promise().value);
+    }
+
+private:
+    friend class FlowRunner;
+    Handle handle = nullptr;
+};
+
+template <typename T>
+Flow<T> flow_detail::Promise<T>::get_return_object() {
+    return Flow<T>(Flow<T>::Handle::from_promise(*this));
+}
+
+inline Flow<void> flow_detail::Promise<void>::get_return_object() {
+    return Flow<void>(Flow<void>::Handle::from_promise(*this));
+}
+
+class FlowRunner {
+public:
+    FlowRunner();
+
+    FlowRunner(const FlowRunner&) = delete;
+    FlowRunner& operator=(const FlowRunner&) = delete;
+
+    // Runs flow up to its first suspension; the runner keeps it until it
+    // finishes. Flows may start other flows.
+    void start(Flow<> flow);
+
+    // Queues an event for the next update().
+    void dispatch(const SDL_Event& event);
+    // Advances the clock and resumes every flow whose wait is over: due
+    // timers, matched events, entered text, then the next-frame waits. An
+    // exception escaping a flow is rethrown here.
+    void update();
+
+    // Makes running() false. Suspended flows are destroyed with the runner.
+    void stop() { stopped = true; }
+    bool running() const { return !stopped && !flows.empty(); }
+
+    // Seconds since the runner was made, as of the last update().
+    double now() const { return clock; }
+    // The events handed to the flows in this update, for flows that poll
+    // input once a frame.
+    const std::vector<SDL_Event>& events() const { return current; }
+
+    struct FrameAwait {
+        FlowRunner& runner;
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { runner.frameWaits.push_back(handle); }
+        void await_resume() const {}
+    };
+
+    struct TimerAwait {
+        FlowRunner& runner;
+        double delay;
+        bool await_ready() const { return delay <= 0; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            runner.timers.push({runner.clock + delay, runner.timerCount++, handle});
+        }
+        void await_resume() const {}
+    };
+
+    struct EventAwait {
+        FlowRunner& runner;
+        std::function<bool(const SDL_Event&)> match;
+        SDL_Event event = {};
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { runner.eventWaits.push_back({this, handle}); }
+        SDL_Event await_resume() const { return event; }
+    };
+
+    // The latest text wait gets the keyboard. Return with something typed
+    // finishes it, leaving the text in the field.
+    struct TimedTextAwait {
+        FlowRunner& runner;
+        TextField& field;
+        double timeout;
+        std::optional<std::string> result;
+        bool await_ready() const { return timeout <= 0; }
+        void await_suspend(std::coroutine_handle<> handle) { runner.waitForText(this, handle); }
+        std::optional<std::string> await_resume() { return std::move(result); }
+    };
+    struct TextAwait : TimedTextAwait {
+        std::string await_resume() { return std::move(*result); }
+    };
+
+    // Resumes at the next update().
+    FrameAwait nextFrame() { return {*this}; }
+    // Resumes at the first update() at least delay seconds from now().
+    TimerAwait seconds(double delay) { return {*this, delay}; }
+    // Resumes with the first later event that match accepts.
+    EventAwait nextEvent(std::function<bool(const SDL_Event&)> match) { return {*this, std::move(match)}; }
+    EventAwait keyPressed(SDL_Keycode key);
+    EventAwait mouseClicked();
+    // Resumes with the text typed into field once Return is pressed.
+    TextAwait textEntered(TextField& field) { return {{*this, field, 1e300, std::nullopt}}; }
+    // The same, or nullopt if timeout seconds pass first.
+    TimedTextAwait textEntered(TextField& field, double timeout) { return {*this, field, timeout, std::nullopt}; }
+
+private:
+    struct Timer {
+        double due;
+        unsigned long long order;  // equal due times resume in start order
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const {
+            return due != other.due ? due > other.due : order > other.order;
+        }
+    };
+    struct EventWait {
+        EventAwait* await;
+        std::coroutine_handle<> handle;
+    };
+    struct TextWait {
+        TimedTextAwait* await;
+        double deadline;
+        std::coroutine_handle<> handle;
+    };
+
+    void waitForText(TimedTextAwait* await, std::coroutine_handle<> handle);
+    void typeInto(TextWait& wait, const SDL_Event& event, std::vector<std::coroutine_handle<>>& ready);
+
+    std::vector<Flow<>> flows;
+    std::vector<SDL_Event> pending, current;
+    std::vector<std::coroutine_handle<>> frameWaits;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    unsigned long long timerCount = 0;
+    std::vector<EventWait> eventWaits;
+    std::vector<TextWait> textWaits;
+    Uint64 startCounter;
+    double clock = 0;
+    bool stopped = false;
+};
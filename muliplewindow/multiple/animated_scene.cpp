@@ -0,0 +1,241 @@
+#include "animated_scene.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include "scaled_image_sdl.h"
+
+namespace fs = std::filesystem;
+
+// Frame sequences are counted by probing for files, up to this many.
+const int MAX_SEQUENCE_FRAMES = 100000;
+
+// A frames pattern is handed to snprintf, so it may hold exactly one
+// conversion, and that one has to take an int: %d, %i, %u, %o, %x or %X
+// with optional flags, width and precision. "%%" is a literal percent.
+static bool isFramePattern(const std::string& pattern) {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') continue;
+        if (++i < pattern.size() && pattern[i] == '%') continue;
+        while (i < pattern.size() && std::strchr("-+ #0", pattern[i])) ++i;
+        while (i < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i]))) ++i;
+        if (i < pattern.size() && pattern[i] == '.') {
+            ++i;
+            while (i < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i]))) ++i;
+        }
+        if (i == pattern.size() || !std::strchr("diuoxX", pattern[i])) return false;
+        ++conversions;
+    }
+    return conversions == 1;
+}
+
+static std::string frameFile(const std::string& pattern, int index) {
+    char name[1024];
+    std::snprintf(name, sizeof name, pattern.c_str(), index);
+    return name;
+}
+
+AnimatedScene::AnimatedScene(SDL_Renderer* renderer, std::string path, unsigned decoders)
+    : renderer(renderer), path(std::move(path)), decoderCount(std::max(1u, decoders)) {}
+
+AnimatedScene::~AnimatedScene() { stop(); }
+
+bool AnimatedScene::isAnimation(const std::string& path) {
+    return path.size() > 5 && path.compare(path.size() - 5, 5, ".anim") == 0;
+}
+
+bool AnimatedScene::readDescription() {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open animation " << path << std::endl;
+        return false;
+    }
+    const fs::path folder = fs::path(path).parent_path();
+    framePattern.clear();
+    sheetPath.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key)) continue;
+        std::string file;
+        if (key == "fps") {
+            words >> fps;
+        } else if (key == "frames" && words >> file) {
+            if (!isFramePattern(file)) {
+                std::cerr << path << ": frames pattern \"" << file << "\" needs exactly one integer conversion, such as %04d"
+                          << std::endl;
+                return false;
+            }
+            // Only the file part is a pattern; a percent in the folder is literal.
+            std::string escapedFolder;
+            for (char c : folder.string()) escapedFolder += c == '%' ? "%%" : std::string(1, c);
+            framePattern = (fs::path(escapedFolder) / file).string();
+        } else if (key == "sheet" && words >> file >> sheetColumns >> sheetRows) {
+            sheetPath = (folder / file).string();
+            if (!(words >> frameCount)) frameCount = sheetColumns * sheetRows;
+        } else {
+            std::cerr << path << ": cannot read \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+
+    if (!framePattern.empty()) {
+        frameCount = 0;
+        while (frameCount < MAX_SEQUENCE_FRAMES && fs::exists(frameFile(framePattern, frameCount))) ++frameCount;
+    } else if (sheetPath.empty()) {
+        std::cerr << path << ": no frames or sheet line" << std::endl;
+        return false;
+    }
+    if (frameCount <= 0 || fps <= 0 || (!sheetPath.empty() && frameCount > sheetColumns * sheetRows)) {
+        std::cerr << path << ": no frames to play" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool AnimatedScene::start() {
+    stop();
+    if (!readDescription()) return false;
+    stopping = false;
+    nextToDecode = 0;
+    dueFrame = 0;
+    shown = -1;
+    dropped = 0;
+    for (Slot& slot : slots) slot = Slot();
+    for (unsigned i = 0; i < decoderCount; ++i) decoders.emplace_back(&AnimatedScene::decoderLoop, this);
+    return true;
+}
+
+void AnimatedScene::stop() {
+    if (!decoders.empty()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        slotFreed.notify_all();
+        for (std::thread& decoder : decoders) decoder.join();
+        decoders.clear();
+    }
+    for (Slot& slot : slots) slot = Slot();
+    sheet = RgbaImage();
+    sheetTried = sheetOk = false;
+    if (streaming) SDL_DestroyTexture(streaming);
+    streaming = nullptr;
+}
+
+// Frames are decoded at their own size; the renderer scales them when
+// drawing, which costs nothing extra compared with a static scene.
+bool AnimatedScene::decodeFrame(int index, RgbaImage& image) {
+    if (!framePattern.empty()) return decodeWithSdlImage(frameFile(framePattern, index), image);
+
+    {
+        std::lock_guard<std::mutex> guard(sheetLock);
+        if (!sheetTried) sheetOk = decodeWithSdlImage(sheetPath, sheet);
+        sheetTried = true;
+    }
+    if (!sheetOk) return false;
+    const int width = sheet.width / sheetColumns, height = sheet.height / sheetRows;
+    const int left = index % sheetColumns * width, top = index / sheetColumns * height;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(&image.pixels[size_t(y) * width * 4], &sheet.pixels[(size_t(top + y) * sheet.width + left) * 4],
+                    size_t(width) * 4);
+    return true;
+}
+
+// Frame n always goes to slot n % RING_FRAMES, so the main thread finds a
+// frame where it expects it however many decoders there are. Frames that
+// are already due are skipped rather than decoded late.
+void AnimatedScene::decoderLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        slotFreed.wait(guard, [&] {
+            return stopping || slots[std::max(nextToDecode, dueFrame) % RING_FRAMES].state == EMPTY;
+        });
+        if (stopping) return;
+        long frame = std::max(nextToDecode, dueFrame);
+        nextToDecode = frame + 1;
+        Slot& slot = slots[frame % RING_FRAMES];
+        slot.state = DECODING;
+        slot.frame = frame;
+
+        guard.unlock();
+        bool ok = decodeFrame(int(frame % frameCount), slot.image);
+        guard.lock();
+        slot.ok = ok;
+        slot.state = READY;
+    }
+}
+
+bool AnimatedScene::upload(const RgbaImage& image) {
+    if (!streaming || image.width != textureWidth || image.height != textureHeight) {
+        if (streaming) SDL_DestroyTexture(streaming);
+        streaming = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, image.width,
+                                      image.height);
+        if (!streaming) {
+            std::cerr << "Failed to create streaming texture for " << path << ": " << SDL_GetError() << std::endl;
+            return false;
+        }
+        textureWidth = image.width;
+        textureHeight = image.height;
+    }
+    return SDL_UpdateTexture(streaming, NULL, image.pixels.data(), image.width * 4) == 0;
+}
+
+void AnimatedScene::update() {
+    if (!playing()) return;
+    // The clock starts with the first frame on screen, not while the
+    // decoders are warming up.
+    const Uint64 now = SDL_GetPerformanceCounter();
+    const long due = shown < 0 ? 0 : long(double(now - startCounter) / SDL_GetPerformanceFrequency() * fps);
+
+    // Show the newest ready frame that is due. Ready frames before it, and
+    // frames a slow decoder finished after a later one was shown, are late
+    // and go straight back to the decoders; frames never shown count as
+    // dropped.
+    Slot* newest = nullptr;
+    bool freed = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        freed = due > dueFrame;
+        dueFrame = std::max(dueFrame, due);
+        for (Slot& slot : slots)
+            if (slot.state == READY && slot.frame > shown && slot.frame <= due && (!newest || slot.frame > newest->frame))
+                newest = &slot;
+        const long latest = newest ? newest->frame : shown;
+        for (Slot& slot : slots) {
+            if (&slot == newest || slot.state != READY || slot.frame > latest) continue;
+            slot.state = EMPTY;
+            freed = true;
+        }
+        if (newest) {
+            dropped += newest->frame - shown - 1;
+            shown = newest->frame;
+        }
+    }
+    if (freed) slotFreed.notify_all();
+    if (!newest) return;
+    if (shown == 0) startCounter = now;
+
+    // The slot stays READY, so no decoder touches it during the upload.
+    bool ok = newest->ok && upload(newest->image);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        newest->state = EMPTY;
+    }
+    slotFreed.notify_all();
+    if (!ok) {
+        std::cerr << "Stopping animation " << path << std::endl;
+        stop();
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "scaled_image.h"
+
+// An animated scene, played in a loop straight from disk.
+//
+// It is described by a small text file ending in .anim:
+//
+//   fps 30
+//   frames intro/frame_%04d.png     # numbered from 0 until a file is missing
+//   sheet  sparks.png 8 4 30        # or: columns, rows, frame count
+//
+// Paths are relative to the .anim file; the frames pattern takes exactly
+// one integer conversion. Decoder threads fill a ring of RING_FRAMES frames
+// ahead of the display, so only those (plus the sheet, for sprite sheets)
+// are ever in memory. The main thread uploads at most one frame per update
+// into a streaming texture; if decoding falls behind, the decoders skip to
+// the frame that is due and frames already late are dropped rather than
+// slowing the clock.
+class AnimatedScene {
+public:
+    static const int RING_FRAMES = 4;
+
+    AnimatedScene(SDL_Renderer* renderer, std::string path, unsigned decoders = 2);
+    ~AnimatedScene();
+
+    AnimatedScene(const AnimatedScene&) = delete;
+    AnimatedScene& operator=(const AnimatedScene&) = delete;
+
+    static bool isAnimation(const std::string& path);
+
+    // Reads the description and starts decoding from the first frame.
+    // False (with the reason on std::cerr) if the description is bad.
+    bool start();
+    // Stops the decoders and frees the frames and the texture.
+    void stop();
+    bool playing() const { return !decoders.empty(); }
+
+    // Main thread, once a frame: shows the newest decoded frame that is due.
+    void update();
+    // nullptr until the first frame is up.
+    SDL_Texture* texture() const { return streaming; }
+    long droppedFrames() const { return dropped; }
+
+private:
+    enum SlotState { EMPTY, DECODING, READY };
+    struct Slot {
+        SlotState state = EMPTY;
+        long frame = -1;
+        bool ok = false;
+        RgbaImage image;
+    };
+
+    bool readDescription();
+    bool decodeFrame(int index, RgbaImage& image);
+    void decoderLoop();
+    bool upload(const RgbaImage& image);
+
+    SDL_Renderer* renderer;
+    std::string path;
+    unsigned decoderCount;
+
+    // From the description.
+    double fps = 30;
+    int frameCount = 0;
+    std::string framePattern;
+    std::string sheetPath;
+    int sheetColumns = 0, sheetRows = 0;
+    // Decoded by the first decoder to need it.
+    std::mutex sheetLock;
+    RgbaImage sheet;
+    bool sheetTried = false;
+    bool sheetOk = false;
+
+    std::mutex lock;
+    std::condition_variable slotFreed;
+    Slot slots[RING_FRAMES];
+    long nextToDecode = 0;
+    long dueFrame = 0;  // published by update(); decoders never start before it
+    bool stopping = false;
+    std::vector<std::thread> decoders;
+
+    // Main thread only.
+    SDL_Texture* streaming = nullptr;
+    int textureWidth = 0, textureHeight = 0;
+    long shown = -1;
+    long dropped = 0;
+    Uint64 startCounter = 0;
+};
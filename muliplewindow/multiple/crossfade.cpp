@@ -0,0 +1,108 @@
+#include "crossfade.h"
+#include <algorithm>
+#include <iostream>
+
+Crossfade::Crossfade(SDL_Renderer* renderer, int width, int height, double seconds)
+    : renderer(renderer), duration(seconds), lastCounter(SDL_GetPerformanceCounter()) {
+    for (SDL_Texture*& snapshot : snapshots) {
+        snapshot = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!snapshot) {
+            std::cerr << "No render-target texture (" << SDL_GetError()
+                      << "); redirected fades start from the nearer scene" << std::endl;
+            break;
+        }
+    }
+}
+
+Crossfade::~Crossfade() {
+    for (SDL_Texture* snapshot : snapshots)
+        if (snapshot) SDL_DestroyTexture(snapshot);
+}
+
+void Crossfade::show(int scene) {
+    from = to = scene;
+    progress = 1.0;
+    snapshotPending = false;
+}
+
+void Crossfade::fadeTo(int scene) {
+    if (snapshotPending) {
+        pendingTo = scene;
+    } else if (from == to) {
+        if (scene == to) return;
+        to = scene;
+        progress = 0.0;
+    } else if (scene == from) {
+        // Going back: run the same blend in reverse.
+        std::swap(from, to);
+        progress = 1.0 - progress;
+    } else if (scene != to) {
+        // A third scene: fade from what is on screen now. The snapshot is
+        // taken at the next draw, where the textures are at hand.
+        if (snapshots[1]) {
+            snapshotPending = true;
+            pendingTo = scene;
+        } else {
+            from = progress < 0.5 ? from : to;
+            to = scene;
+            progress = 0.0;
+        }
+    }
+}
+
+void Crossfade::update() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double seconds = double(now - lastCounter) / SDL_GetPerformanceFrequency();
+    lastCounter = now;
+    if (from == to || snapshotPending) return;
+    progress = duration > 0 ? progress + seconds / duration : 1.0;
+    if (progress >= 1.0) show(to);
+}
+
+std::vector<int> Crossfade::scenesInUse() const {
+    std::vector<int> scenes;
+    if (from >= 0) scenes.push_back(from);
+    if (to != from) scenes.push_back(to);
+    if (snapshotPending) scenes.push_back(pendingTo);
+    return scenes;
+}
+
+SDL_Texture* Crossfade::texture(const std::vector<SDL_Texture*>& scenes, int scene) const {
+    return scene < 0 ? snapshots[-1 - scene] : scenes[scene];
+}
+
+// Outgoing opaque, incoming on top at the eased alpha.
+void Crossfade::drawBlend(const std::vector<SDL_Texture*>& scenes) {
+    SDL_Texture* out = texture(scenes, from);
+    SDL_SetTextureBlendMode(out, SDL_BLENDMODE_NONE);
+    SDL_SetTextureAlphaMod(out, 255);
+    SDL_RenderCopy(renderer, out, NULL, NULL);
+
+    double eased = progress * progress * (3.0 - 2.0 * progress);
+    SDL_Texture* in = texture(scenes, to);
+    SDL_SetTextureBlendMode(in, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureAlphaMod(in, Uint8(std::clamp(eased, 0.0, 1.0) * 255.0 + 0.5));
+    SDL_RenderCopy(renderer, in, NULL, NULL);
+    SDL_SetTextureAlphaMod(in, 255);
+}
+
+void Crossfade::draw(const std::vector<SDL_Texture*>& scenes) {
+    if (snapshotPending) {
+        // Use whichever snapshot the current blend is not reading from.
+        int slot = from == -1 ? 1 : 0;
+        SDL_SetRenderTarget(renderer, snapshots[slot]);
+        drawBlend(scenes);
+        SDL_SetRenderTarget(renderer, NULL);
+        from = -1 - slot;
+        to = pendingTo;
+        progress = 0.0;
+        snapshotPending = false;
+    }
+    if (from == to) {
+        SDL_Texture* shown = texture(scenes, to);
+        SDL_SetTextureBlendMode(shown, SDL_BLENDMODE_NONE);
+        SDL_RenderCopy(renderer, shown, NULL, NULL);
+        return;
+    }
+    drawBlend(scenes);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Time-based crossfade between scene textures, advanced from the main loop.
+//
+// The outgoing picture is drawn opaque and the incoming one over it with
+// SDL_SetTextureAlphaMod, so no frame blocks and the fade takes the same
+// time at any frame rate. A new target mid-fade either reverses the fade
+// (back to the scene fading out) or snapshots the blend on screen into a
+// render-target texture and fades from that, so nothing ever jumps. Two
+// snapshots take turns, so a fade from a snapshot can be redirected too.
+class Crossfade {
+public:
+    Crossfade(SDL_Renderer* renderer, int width, int height, double seconds);
+    ~Crossfade();
+
+    Crossfade(const Crossfade&) = delete;
+    Crossfade& operator=(const Crossfade&) = delete;
+
+    // Shows scene at once, cancelling any fade.
+    void show(int scene);
+    // Starts (or redirects) a fade towards scene.
+    void fadeTo(int scene);
+    // Advances by the time since the last call.
+    void update();
+    // A nullptr entry (an animation with no frame up yet) draws nothing;
+    // SDL rejects the copy.
+    void draw(const std::vector<SDL_Texture*>& scenes);
+
+    // The scene being faded to, or shown.
+    int target() const { return snapshotPending ? pendingTo : to; }
+    bool fading() const { return from != to || snapshotPending; }
+    // Scenes the next draw may read, so their textures must stay loaded.
+    std::vector<int> scenesInUse() const;
+
+private:
+    void drawBlend(const std::vector<SDL_Texture*>& scenes);
+    SDL_Texture* texture(const std::vector<SDL_Texture*>& scenes, int scene) const;
+
+    // Snapshot k stands in for scene -1 - k.
+    SDL_Renderer* renderer;
+    SDL_Texture* snapshots[2] = {nullptr, nullptr};
+    double duration;
+    int from = 0;
+    int to = 0;
+    double progress = 1.0;  // 0 = all from, 1 = all to
+    // A redirect waiting for the next draw to take its snapshot.
+    bool snapshotPending = false;
+    int pendingTo = 0;
+    Uint64 lastCounter;
+};
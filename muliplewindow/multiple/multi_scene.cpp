@@ -3,46 +3,62 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include "animated_scene.h"
+#include "crossfade.h"
+#include "scene_cache.h"
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
-const int NUM_SCENES = 5; // or adjust based on how many images you have
-
-bool fadeTransition(SDL_Renderer* renderer, SDL_Texture* nextTexture) {
-    for (int alpha = 255; alpha >= 0; alpha -= 15) {
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-        SDL_RenderCopy(renderer, nextTexture, NULL, NULL);
-
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
-        SDL_Rect fade = {0, 0, WIDTH, HEIGHT};
-        SDL_RenderFillRect(renderer, &fade);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(15);
-    }
+const double FADE_SECONDS = 0.3;
+// Scene textures kept loaded, in MB; about four scenes at window size.
+const size_t DEFAULT_BUDGET_MB = 8;
+const size_t MAX_BUDGET_MB = 4096;
+// Keys 6 to 9 are all that is left for extra scenes.
+const int MAX_EXTRA_SCENES = 4;
+
+// Without vsync, frames are paced to about this long.
+const Uint32 FRAME_MS = 16;
+
+// A texture budget in MB: a whole number from 1 to MAX_BUDGET_MB and
+// nothing else.
+bool parseBudget(const char* text, size_t& megabytes) {
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end || errno || value < 1 || size_t(value) > MAX_BUDGET_MB) return false;
+    megabytes = size_t(value);
     return true;
 }
 
-SDL_Texture* loadTexture(SDL_Renderer* renderer, const std::string& path) {
-    SDL_Surface* surface = IMG_Load(path.c_str());
-    if (!surface) {
-        std::cerr << "Failed to load image " << path << ": " << IMG_GetError() << std::endl;
-        return nullptr;
+// Usage: main [--budget texture_mb] [scene ...]
+// Extra scenes (images, or .anim files for animated ones; see
+// animated_scene.h) follow the built-in five on keys 6 to 9.
+int main(int argc, char* argv[]) {
+    size_t budgetMB = DEFAULT_BUDGET_MB;
+    int firstScene = 1;
+    if (argc > 1 && std::string(argv[1]) == "--budget") {
+        firstScene = 3;
+        if (argc < 3 || !parseBudget(argv[2], budgetMB)) firstScene = -1;
+    }
+    if (firstScene < 0 || argc - firstScene > MAX_EXTRA_SCENES) {
+        std::cerr << "Usage: " << argv[0] << " [--budget texture_mb] [scene ...], budget from 1 to " << MAX_BUDGET_MB
+                  << " MB, at most " << MAX_EXTRA_SCENES << " scenes\n";
+        return 1;
     }
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    return texture;
-}
 
-int main() {
     if (SDL_Init(SDL_INIT_VIDEO) < 0 || IMG_Init(IMG_INIT_PNG) == 0) {
         std::cerr << "Initialization failed: " << SDL_GetError() << std::endl;
         return 1;
     }
 
     SDL_Window* window = SDL_CreateWindow("Image Window Switcher", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, WIDTH, HEIGHT, 0);
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    SDL_RendererInfo rendererInfo;
+    const bool vsync = SDL_GetRendererInfo(renderer, &rendererInfo) == 0 && (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC);
 
     std::vector<std::string> imagePaths = {
         "scene1.png",
@@ -51,49 +67,79 @@ int main() {
         "scene4.png",
         "scene5.png"
     };
+    for (int i = firstScene; i < argc; ++i) imagePaths.push_back(argv[i]);
+
+    // The cache, animations and fade hold textures, so they go before the
+    // renderer.
+    {
+        // Animated scenes stream their own frames; the cache skips them.
+        std::vector<std::string> stillPaths = imagePaths;
+        std::vector<std::unique_ptr<AnimatedScene>> animations(imagePaths.size());
+        for (size_t i = 0; i < imagePaths.size(); ++i) {
+            if (!AnimatedScene::isAnimation(imagePaths[i])) continue;
+            animations[i].reset(new AnimatedScene(renderer, imagePaths[i]));
+            stillPaths[i].clear();
+        }
 
-    std::vector<SDL_Texture*> scenes;
-    for (const auto& path : imagePaths) {
-        SDL_Texture* tex = loadTexture(renderer, path);
-        if (!tex) {
+        SceneCache cache(renderer, stillPaths, WIDTH, HEIGHT, budgetMB << 20);
+        if (animations[0] ? !animations[0]->start() : !cache.load(0)) {
             SDL_Quit();
             return 1;
         }
-        scenes.push_back(tex);
-    }
+        cache.prefetch(0);
+        std::vector<SDL_Texture*> textures;
 
-    int currentScene = 0;
-    bool running = true;
-    SDL_Event e;
-
-    while (running) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT)
-                running = false;
-
-            if (e.type == SDL_KEYDOWN) {
-                int newScene = currentScene;
-                if (e.key.keysym.sym == SDLK_1) newScene = 0;
-                if (e.key.keysym.sym == SDLK_2 && scenes.size() > 1) newScene = 1;
-                if (e.key.keysym.sym == SDLK_3 && scenes.size() > 2) newScene = 2;
-                if (e.key.keysym.sym == SDLK_4 && scenes.size() > 3) newScene = 3;
-                if (e.key.keysym.sym == SDLK_5 && scenes.size() > 4) newScene = 4;
-
-                if (newScene != currentScene) {
-                    fadeTransition(renderer, scenes[newScene]);
-                    currentScene = newScene;
+        Crossfade fade(renderer, WIDTH, HEIGHT, FADE_SECONDS);
+        fade.show(0);
+        // The scene asked for; the fade starts once it is loaded.
+        int wanted = 0;
+        bool running = true;
+        SDL_Event e;
+
+        while (running) {
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT)
+                    running = false;
+
+                if (e.type == SDL_KEYDOWN) {
+                    SDL_Keycode key = e.key.keysym.sym;
+                    if (key >= SDLK_1 && key <= SDLK_9 && key - SDLK_1 < cache.size()) {
+                        wanted = key - SDLK_1;
+                        cache.prefetch(wanted);
+                        if (animations[wanted] && !animations[wanted]->playing() && !animations[wanted]->start())
+                            wanted = fade.target();
+                    }
                 }
             }
-        }
 
-        SDL_RenderClear(renderer);
-        SDL_RenderCopy(renderer, scenes[currentScene], NULL, NULL);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(16);
-    }
+            Uint32 frameStart = SDL_GetTicks();
+            std::vector<int> keep = fade.scenesInUse();
+            keep.push_back(wanted);
+            cache.pump(keep);
+            // Animations play while on screen (or about to be) and stop
+            // otherwise, so their frames are only in memory while needed.
+            for (size_t i = 0; i < animations.size(); ++i) {
+                if (!animations[i]) continue;
+                if (std::find(keep.begin(), keep.end(), int(i)) == keep.end()) animations[i]->stop();
+                else animations[i]->update();
+            }
+            textures = cache.textures();
+            for (size_t i = 0; i < animations.size(); ++i)
+                if (animations[i]) textures[i] = animations[i]->texture();
+
+            if (cache.failed(wanted) || (animations[wanted] && !animations[wanted]->playing())) wanted = fade.target();
+            // Pressing a key mid-fade redirects it.
+            if (wanted != fade.target() && (animations[wanted] ? textures[wanted] != nullptr : cache.get(wanted) != nullptr))
+                fade.fadeTo(wanted);
 
-    for (auto& tex : scenes)
-        SDL_DestroyTexture(tex);
+            fade.update();
+            SDL_RenderClear(renderer);
+            fade.draw(textures);
+            SDL_RenderPresent(renderer);
+            Uint32 spent = SDL_GetTicks() - frameStart;
+            if (!vsync && spent < FRAME_MS) SDL_Delay(FRAME_MS - spent);
+        }
+    }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
@@ -0,0 +1,175 @@
+#include "scene_cache.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include "scaled_image_sdl.h"
+
+// Texture memory of a surface once uploaded: the renderer keeps 32 bits a
+// pixel whatever the file had.
+static size_t textureBytes(const SDL_Surface* surface) { return size_t(surface->w) * surface->h * 4; }
+
+SceneCache::SceneCache(SDL_Renderer* renderer, std::vector<std::string> paths, int drawWidth, int drawHeight,
+                       size_t budgetBytes)
+    : renderer(renderer), paths(std::move(paths)), drawWidth(drawWidth), drawHeight(drawHeight), budget(budgetBytes) {
+    loaded.assign(this->paths.size(), nullptr);
+    entries.resize(this->paths.size());
+    worker = std::thread(&SceneCache::workerLoop, this);
+}
+
+SceneCache::~SceneCache() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+    for (SDL_Texture* texture : loaded)
+        if (texture) SDL_DestroyTexture(texture);
+    for (Entry& entry : entries)
+        if (entry.surface) SDL_FreeSurface(entry.surface);
+}
+
+void SceneCache::request(int scene, bool urgent) {
+    if (scene < 0 || scene >= size() || paths[scene].empty()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Entry& entry = entries[scene];
+        if (entry.state == QUEUED) {
+            // Already decoding cannot go any faster.
+            if (!urgent || scene == decoding) return;
+            std::deque<int>::iterator at = std::find(queue.begin(), queue.end(), scene);
+            if (at != queue.end()) queue.erase(at);
+        } else if (entry.state != ABSENT) {
+            return;
+        }
+        entry.state = QUEUED;
+        if (urgent) queue.push_front(scene);
+        else queue.push_back(scene);
+    }
+    wake.notify_one();
+}
+
+void SceneCache::prefetch(int scene) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // The scene being decoded is not in the queue and stays QUEUED.
+        for (int queued : queue) entries[queued].state = ABSENT;
+        queue.clear();
+    }
+    request(scene, true);
+    request(scene + 1);
+    request(scene - 1);
+}
+
+SDL_Texture* SceneCache::load(int scene) {
+    if (paths[scene].empty()) return nullptr;
+    request(scene, true);
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        decoded.wait(guard, [&] { return entries[scene].state != QUEUED; });
+    }
+    upload(scene);
+    return get(scene);
+}
+
+void SceneCache::workerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        wake.wait(guard, [&] { return stopping || !queue.empty(); });
+        if (stopping) return;
+        int scene = queue.front();
+        queue.pop_front();
+        decoding = scene;
+
+        guard.unlock();
+        SDL_Surface* surface = loadScaledSurface(paths[scene], drawWidth, drawHeight);
+        guard.lock();
+        decoding = -1;
+
+        Entry& entry = entries[scene];
+        if (entry.state != QUEUED) {
+            // Dropped by a newer prefetch while it was decoding.
+            if (surface) SDL_FreeSurface(surface);
+        } else if (!surface) {
+            entry.state = FAILED;
+        } else {
+            entry.state = DECODED;
+            entry.surface = surface;
+            entry.bytes = textureBytes(surface);
+            bytesInUse += entry.bytes;
+        }
+        decoded.notify_all();
+    }
+}
+
+// Turns a decoded surface into a texture. Main thread only.
+bool SceneCache::upload(int scene) {
+    SDL_Surface* surface;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (entries[scene].state != DECODED) return false;
+        surface = std::exchange(entries[scene].surface, nullptr);
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+
+    std::lock_guard<std::mutex> guard(lock);
+    Entry& entry = entries[scene];
+    if (!texture) {
+        std::cerr << "Failed to upload " << paths[scene] << ": " << SDL_GetError() << std::endl;
+        entry.state = FAILED;
+        bytesInUse -= entry.bytes;
+        return false;
+    }
+    entry.state = LOADED;
+    entry.lastUse = ++useClock;
+    loaded[scene] = texture;
+    return true;
+}
+
+void SceneCache::pump(const std::vector<int>& keep) {
+    int next = -1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int scene = 0; scene < size() && next < 0; ++scene)
+            if (entries[scene].state == DECODED) next = scene;
+    }
+    if (next >= 0) upload(next);
+    evict(keep);
+}
+
+void SceneCache::evict(const std::vector<int>& keep) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int scene : keep)
+        if (scene >= 0 && scene < size() && entries[scene].state == LOADED) entries[scene].lastUse = ++useClock;
+    while (bytesInUse > budget) {
+        int oldest = -1;
+        for (int scene = 0; scene < size(); ++scene) {
+            const Entry& entry = entries[scene];
+            if (entry.state != LOADED || std::find(keep.begin(), keep.end(), scene) != keep.end()) continue;
+            if (oldest < 0 || entry.lastUse < entries[oldest].lastUse) oldest = scene;
+        }
+        if (oldest < 0) return;  // everything left is in use
+        SDL_DestroyTexture(loaded[oldest]);
+        loaded[oldest] = nullptr;
+        bytesInUse -= entries[oldest].bytes;
+        entries[oldest].state = ABSENT;
+    }
+}
+
+SDL_Texture* SceneCache::get(int scene) {
+    if (scene < 0 || scene >= size() || !loaded[scene]) return nullptr;
+    std::lock_guard<std::mutex> guard(lock);
+    entries[scene].lastUse = ++useClock;
+    return loaded[scene];
+}
+
+bool SceneCache::failed(int scene) const {
+    std::lock_guard<std::mutex> guard(lock);
+    return entries[scene].state == FAILED;
+}
+
+size_t SceneCache::usedBytes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return bytesInUse;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scene textures loaded on demand and kept within a memory budget.
+//
+// A worker thread decodes PNGs and scales them down to the size they are
+// drawn at (through the disk cache in scaled_image.h) into surfaces; the
+// main thread uploads them
+// as textures in pump() (SDL renderers are not thread-safe) and evicts the
+// least recently used textures while the total is over budget. Decoded
+// surfaces waiting for upload count against the budget too.
+class SceneCache {
+public:
+    // Scenes are drawn at drawWidth x drawHeight and loaded no larger. An
+    // empty path is a scene drawn some other way, which is never loaded.
+    SceneCache(SDL_Renderer* renderer, std::vector<std::string> paths, int drawWidth, int drawHeight,
+               size_t budgetBytes);
+    ~SceneCache();
+
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    int size() const { return int(paths.size()); }
+
+    // Queues scene for decoding unless it is loaded or already on its way.
+    // Urgent requests jump the queue.
+    void request(int scene, bool urgent = false);
+    // The scene the player is on: requests it urgently and its neighbours
+    // (the adjacent number keys) behind it, dropping older prefetches.
+    void prefetch(int scene);
+    // Blocks until scene is uploaded. nullptr if it cannot be loaded.
+    SDL_Texture* load(int scene);
+
+    // Main thread, once a frame: uploads one decoded scene and evicts
+    // textures over budget, never those in keep.
+    void pump(const std::vector<int>& keep);
+
+    // The scene's texture (marking it used), or nullptr if not loaded yet.
+    SDL_Texture* get(int scene);
+    bool failed(int scene) const;
+    // Loaded textures by scene, nullptr where not loaded.
+    const std::vector<SDL_Texture*>& textures() const { return loaded; }
+    size_t usedBytes() const;
+
+private:
+    enum State : uint8_t { ABSENT, QUEUED, DECODED, LOADED, FAILED };
+    struct Entry {
+        State state = ABSENT;
+        SDL_Surface* surface = nullptr;  // decoded, waiting for upload
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+    };
+
+    void workerLoop();
+    bool upload(int scene);
+    // Refreshes keep, then drops the oldest other textures while over budget.
+    void evict(const std::vector<int>& keep);
+
+    SDL_Renderer* renderer;
+    std::vector<std::string> paths;
+    int drawWidth, drawHeight;
+    size_t budget;
+    uint64_t useClock = 0;
+    std::vector<SDL_Texture*> loaded;  // main thread only
+
+    mutable std::mutex lock;
+    std::condition_variable wake;     // work for the worker
+    std::condition_variable decoded;  // a decode finished
+    std::vector<Entry> entries;
+    std::deque<int> queue;
+    int decoding = -1;  // popped by the worker, still QUEUED until it is done
+    size_t bytesInUse = 0;
+    bool stopping = false;
+    std::thread worker;
+};
@@ -0,0 +1,171 @@
+// Timing and consistency checks for the jigsaw board, from the default
+// 8 x 6 board up to the large-format ones. Runs headless (`make bench`) and
+// prints one JSON document on stdout:
+//
+//   ./jigsaw_bench [picks] > bench.json
+//
+// Picking is checked against a search over every piece, and each board is
+// solved by dragging groups next to a picture neighbour until one group is
+// left, which has to line up with the picture. Drawing is timed without a
+// renderer: SDL rejects the geometry call at once, so what is left is
+// building the vertices, the board's share of a frame.
+#include "../jigsaw.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct JsonRows {
+    std::vector<std::string> rows;
+    void add(const std::string& row) { rows.push_back(row); }
+    std::string join() const {
+        std::string out;
+        for (size_t i = 0; i < rows.size(); ++i) out += (i ? ",\n    " : "\n    ") + rows[i];
+        return out + "\n  ";
+    }
+};
+
+struct BoardSize {
+    int cols, rows;
+    float pictureWidth, pictureHeight;
+};
+
+// The window the decoder room scatters the pieces over.
+const float BOARD_WIDTH = 1024, BOARD_HEIGHT = 768;
+const int DRAW_REPEATS = 200;
+
+// Topmost piece under the point by looking at every piece.
+static int pickBruteForce(const JigsawBoard& board, float pieceWidth, float pieceHeight, float px, float py) {
+    int best = -1;
+    for (int piece = 0; piece < board.pieces(); ++piece) {
+        float left = board.pieceX(piece), top = board.pieceY(piece);
+        if (px < left || py < top || px >= left + pieceWidth || py >= top + pieceHeight) continue;
+        if (best < 0 || board.depthOf(piece) > board.depthOf(best)) best = piece;
+    }
+    return best;
+}
+
+// A point on the piece where its group is the one picked, if there is one.
+static bool visiblePoint(const JigsawBoard& board, int piece, float pieceWidth, float pieceHeight, float& px,
+                         float& py) {
+    for (float fy : {0.5f, 0.1f, 0.9f}) {
+        for (float fx : {0.5f, 0.1f, 0.9f}) {
+            px = board.pieceX(piece) + fx * pieceWidth;
+            py = board.pieceY(piece) + fy * pieceHeight;
+            int top = board.pick(px, py);
+            if (top >= 0 && board.groupOf(top) == board.groupOf(piece)) return true;
+        }
+    }
+    return false;
+}
+
+static void benchBoard(const BoardSize& size, int picks, JsonRows& rows) {
+    const float pieceWidth = size.pictureWidth / size.cols, pieceHeight = size.pictureHeight / size.rows;
+    JigsawBoard board;
+    Clock::time_point start = Clock::now();
+    board.build(size.cols, size.rows, size.pictureWidth, size.pictureHeight, BOARD_WIDTH, BOARD_HEIGHT, 1);
+    const double buildMs = msSince(start);
+
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> across(0, BOARD_WIDTH), down(0, BOARD_HEIGHT);
+    std::vector<std::pair<float, float>> points(picks);
+    for (auto& point : points) point = {across(random), down(random)};
+    std::vector<int> picked(picks);
+    start = Clock::now();
+    for (int i = 0; i < picks; ++i) picked[i] = board.pick(points[i].first, points[i].second);
+    const double pickUs = msSince(start) * 1e3 / picks;
+    int mismatches = 0;
+    for (int i = 0; i < picks; ++i)
+        mismatches += picked[i] != pickBruteForce(board, pieceWidth, pieceHeight, points[i].first, points[i].second);
+
+    start = Clock::now();
+    for (int i = 0; i < DRAW_REPEATS; ++i) board.draw(nullptr, nullptr);
+    const double drawMs = msSince(start) / DRAW_REPEATS;
+
+    // Solve: take a piece and a neighbour from another group, pick up
+    // whichever of the two groups shows, and drop it exactly beside the other.
+    std::vector<int> visit(board.pieces());
+    for (int i = 0; i < board.pieces(); ++i) visit[i] = i;
+    const int dirs[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    int drops = 0, joins = 0;
+    double dropMs = 0, worstDropMs = 0;
+    for (bool progress = true; progress && !board.solved();) {
+        progress = false;
+        std::shuffle(visit.begin(), visit.end(), random);
+        for (int piece : visit) {
+            if (board.solved()) break;
+            const int col = piece % size.cols, row = piece / size.cols;
+            for (const auto& dir : dirs) {
+                int c = col + dir[0], r = row + dir[1];
+                if (c < 0 || r < 0 || c >= size.cols || r >= size.rows) continue;
+                int neighbour = r * size.cols + c;
+                if (board.groupOf(neighbour) == board.groupOf(piece)) continue;
+                // The lifted piece ends up dir (or -dir) of the other one.
+                int lifted = piece, other = neighbour, sign = -1;
+                float px, py;
+                if (!visiblePoint(board, lifted, pieceWidth, pieceHeight, px, py)) {
+                    std::swap(lifted, other);
+                    sign = 1;
+                    if (!visiblePoint(board, lifted, pieceWidth, pieceHeight, px, py)) continue;
+                }
+                float dx = board.pieceX(other) + sign * dir[0] * pieceWidth - board.pieceX(lifted);
+                float dy = board.pieceY(other) + sign * dir[1] * pieceHeight - board.pieceY(lifted);
+                start = Clock::now();
+                board.press(px, py);
+                board.drag(px + dx, py + dy);
+                joins += board.release();
+                double ms = msSince(start);
+                dropMs += ms;
+                worstDropMs = std::max(worstDropMs, ms);
+                ++drops;
+                progress = true;
+                break;
+            }
+        }
+    }
+
+    // Solved, every piece sits where the picture puts it relative to piece 0.
+    double misalignment = 0;
+    for (int piece = 0; piece < board.pieces(); ++piece) {
+        double ex = board.pieceX(piece) - board.pieceX(0) - (piece % size.cols) * pieceWidth;
+        double ey = board.pieceY(piece) - board.pieceY(0) - (piece / size.cols) * pieceHeight;
+        misalignment = std::max(misalignment, std::max(std::fabs(ex), std::fabs(ey)));
+    }
+
+    std::ostringstream row;
+    row << "{\"cols\": " << size.cols << ", \"rows\": " << size.rows << ", \"pieces\": " << board.pieces()
+        << ", \"picture\": \"" << size.pictureWidth << "x" << size.pictureHeight << "\", \"build_ms\": " << buildMs
+        << ", \"pick_us\": " << pickUs << ", \"pick_mismatches\": " << mismatches << ", \"vertices_ms\": " << drawMs
+        << ", \"drops\": " << drops << ", \"joins\": " << joins << ", \"mean_drop_ms\": " << dropMs / std::max(drops, 1)
+        << ", \"worst_drop_ms\": " << worstDropMs << ", \"solved\": " << (board.solved() ? "true" : "false")
+        << ", \"max_misalignment_px\": " << misalignment << "}";
+    rows.add(row.str());
+}
+
+int main(int argc, char* argv[]) {
+    int picks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20000;
+    // The room's default board, the largest at the small picture size, and
+    // large-format boards at window size.
+    const BoardSize sizes[] = {
+        {8, 6, 768, 576}, {32, 24, 768, 576}, {100, 60, 1024, 768}, {120, 60, 1024, 768}, {128, 96, 1024, 768}
+    };
+    JsonRows boards;
+    for (const BoardSize& size : sizes) benchBoard(size, picks, boards);
+    std::cout << "{\n"
+              << "  \"benchmark\": \"jigsaw\",\n"
+              << "  \"picks\": " << picks << ",\n"
+              << "  \"boards\": [" << boards.join() << "]\n"
+              << "}\n";
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "jigsaw.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+void JigsawBoard::build(int cols, int rows, float pictureWidth, float pictureHeight, float boardWidth,
+                        float boardHeight, uint32_t seed) {
+    this->cols = std::max(cols, 1);
+    this->rows = std::max(rows, 1);
+    const int count = this->cols * this->rows;
+    pieceWidth = pictureWidth / this->cols;
+    pieceHeight = pictureHeight / this->rows;
+    snapDistance = std::max(4.0f, 0.25f * std::min(pieceWidth, pieceHeight));
+
+    cellSize = std::max(pieceWidth, pieceHeight);
+    gridCols = std::max(1, int(std::ceil(boardWidth / cellSize)));
+    gridRows = std::max(1, int(std::ceil(boardHeight / cellSize)));
+    grid.assign(size_t(gridCols) * gridRows, {});
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> across(0, std::max(0.0f, boardWidth - pieceWidth));
+    std::uniform_real_distribution<float> down(0, std::max(0.0f, boardHeight - pieceHeight));
+    x.resize(count);
+    y.resize(count);
+    group.resize(count);
+    cell.resize(count);
+    slot.resize(count);
+    members.assign(count, {});
+    for (int piece = 0; piece < count; ++piece) {
+        x[piece] = across(random);
+        y[piece] = down(random);
+        group[piece] = piece;
+        members[piece] = {piece};
+        placeInGrid(piece);
+    }
+    groups = count;
+    held = -1;
+
+    order.resize(count);
+    for (int i = 0; i < count; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+    depth.resize(count);
+    for (int i = 0; i < count; ++i) depth[order[i]] = i;
+
+    // Two triangles per quad; the same for every frame.
+    vertices.resize(size_t(count) * 4);
+    indices.resize(size_t(count) * 6);
+    for (int i = 0; i < count; ++i) {
+        const int corners[] = {0, 1, 2, 2, 1, 3};
+        for (int k = 0; k < 6; ++k) indices[size_t(i) * 6 + k] = i * 4 + corners[k];
+    }
+}
+
+// Pieces centred off the board are filed under the nearest edge cell.
+int JigsawBoard::cellOf(int piece) const {
+    int gx = std::clamp(int((x[piece] + pieceWidth / 2) / cellSize), 0, gridCols - 1);
+    int gy = std::clamp(int((y[piece] + pieceHeight / 2) / cellSize), 0, gridRows - 1);
+    return gy * gridCols + gx;
+}
+
+void JigsawBoard::placeInGrid(int piece) {
+    cell[piece] = cellOf(piece);
+    std::vector<int>& pieces = grid[cell[piece]];
+    slot[piece] = int(pieces.size());
+    pieces.push_back(piece);
+}
+
+void JigsawBoard::removeFromGrid(int piece) {
+    std::vector<int>& pieces = grid[cell[piece]];
+    int last = pieces.back();
+    pieces[slot[piece]] = last;
+    slot[last] = slot[piece];
+    pieces.pop_back();
+}
+
+int JigsawBoard::pick(float px, float py) const {
+    // A piece is no bigger than a cell, so one covering the point has its
+    // centre in the point's cell or the next one over.
+    int gx = std::clamp(int(px / cellSize), 0, gridCols - 1);
+    int gy = std::clamp(int(py / cellSize), 0, gridRows - 1);
+    int best = -1;
+    for (int cy = std::max(gy - 1, 0); cy <= std::min(gy + 1, gridRows - 1); ++cy) {
+        for (int cx = std::max(gx - 1, 0); cx <= std::min(gx + 1, gridCols - 1); ++cx) {
+            for (int piece : grid[size_t(cy) * gridCols + cx]) {
+                if (px < x[piece] || py < y[piece] || px >= x[piece] + pieceWidth || py >= y[piece] + pieceHeight)
+                    continue;
+                if (best < 0 || depth[piece] > depth[best]) best = piece;
+            }
+        }
+    }
+    return best;
+}
+
+bool JigsawBoard::press(float px, float py) {
+    int piece = pick(px, py);
+    if (piece < 0) return false;
+    held = group[piece];
+    dragX = px;
+    dragY = py;
+    std::stable_partition(order.begin(), order.end(), [&](int p) { return group[p] != held; });
+    for (int i = 0; i < int(order.size()); ++i) depth[order[i]] = i;
+    return true;
+}
+
+void JigsawBoard::drag(float px, float py) {
+    if (held < 0) return;
+    moveGroup(held, px - dragX, py - dragY);
+    dragX = px;
+    dragY = py;
+}
+
+void JigsawBoard::moveGroup(int id, float dx, float dy) {
+    for (int piece : members[id]) {
+        x[piece] += dx;
+        y[piece] += dy;
+        if (cellOf(piece) != cell[piece]) {
+            removeFromGrid(piece);
+            placeInGrid(piece);
+        }
+    }
+}
+
+// Smaller into larger, so a piece changes group O(log n) times at most.
+void JigsawBoard::merge(int into, int from) {
+    if (members[into].size() < members[from].size()) std::swap(into, from);
+    for (int piece : members[from]) group[piece] = into;
+    members[into].insert(members[into].end(), members[from].begin(), members[from].end());
+    members[from].clear();
+    members[from].shrink_to_fit();
+    if (held == from) held = into;
+    --groups;
+}
+
+int JigsawBoard::release() {
+    if (held < 0) return 0;
+    int joined = 0;
+    // The moved pieces as they were dropped; merging adds pieces that are
+    // already lined up with each other.
+    const std::vector<int> moved = members[held];
+    for (int piece : moved) {
+        const int col = piece % cols, row = piece / cols;
+        const int dirs[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (const auto& dir : dirs) {
+            int c = col + dir[0], r = row + dir[1];
+            if (c < 0 || r < 0 || c >= cols || r >= rows) continue;
+            int neighbour = r * cols + c;
+            if (group[neighbour] == group[piece]) continue;
+            // Where the neighbour is, relative to where it belongs.
+            float ex = x[neighbour] - x[piece] - dir[0] * pieceWidth;
+            float ey = y[neighbour] - y[piece] - dir[1] * pieceHeight;
+            if (std::fabs(ex) > snapDistance || std::fabs(ey) > snapDistance) continue;
+            // Line up whichever side has fewer pieces to move.
+            if (members[group[piece]].size() <= members[group[neighbour]].size())
+                moveGroup(group[piece], ex, ey);
+            else
+                moveGroup(group[neighbour], -ex, -ey);
+            merge(group[neighbour], group[piece]);
+            ++joined;
+        }
+    }
+    held = -1;
+    return joined;
+}
+
+void JigsawBoard::draw(SDL_Renderer* renderer, SDL_Texture* texture) {
+    const float du = 1.0f / cols, dv = 1.0f / rows;
+    const SDL_Color loose = {225, 225, 225, 255}, lifted = {255, 255, 255, 255};
+    SDL_Vertex* v = vertices.data();
+    for (int piece : order) {
+        const float left = x[piece], top = y[piece];
+        const float u = (piece % cols) * du, t = (piece / cols) * dv;
+        const SDL_Color color = group[piece] == held ? lifted : loose;
+        v[0] = {{left, top}, color, {u, t}};
+        v[1] = {{left + pieceWidth, top}, color, {u + du, t}};
+        v[2] = {{left, top + pieceHeight}, color, {u, t + dv}};
+        v[3] = {{left + pieceWidth, top + pieceHeight}, color, {u + du, t + dv}};
+        v += 4;
+    }
+    SDL_RenderGeometry(renderer, texture, vertices.data(), int(vertices.size()), indices.data(), int(indices.size()));
+}
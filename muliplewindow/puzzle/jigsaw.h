@@ -0,0 +1,86 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+// A picture cut into cols x rows rectangular pieces, scattered over the
+// board. A dropped group snaps to any of its pieces' true neighbours lying
+// close enough to where they belong, and the two move as one from then on.
+// The puzzle is solved once every piece is in a single group.
+//
+// Kept cheap for thousands of pieces:
+// - piece positions are separate x and y arrays, walked in draw order when
+//   the vertices are built;
+// - a uniform grid with cells one piece across holds pieces by their
+//   centre, so picking only tests the pieces in the 3x3 cells around the
+//   cursor;
+// - a drop only checks the moved group's pieces against their four
+//   neighbours in the picture;
+// - every piece is a quad over one texture holding the whole picture, all
+//   drawn with a single SDL_RenderGeometry call.
+class JigsawBoard {
+public:
+    // Cuts a pictureWidth x pictureHeight picture into cols x rows pieces
+    // scattered at random over boardWidth x boardHeight.
+    void build(int cols, int rows, float pictureWidth, float pictureHeight, float boardWidth, float boardHeight,
+               uint32_t seed);
+
+    // Mouse handling, in board coordinates. press() picks up the group of
+    // the topmost piece under the point, if any, and brings it to the front.
+    bool press(float px, float py);
+    void drag(float px, float py);
+    // Drops the held group; returns how many groups it snapped to.
+    int release();
+
+    // Topmost piece under the point, or -1.
+    int pick(float px, float py) const;
+    bool holding() const { return held >= 0; }
+    int pieces() const { return cols * rows; }
+    int groupsLeft() const { return groups; }
+    bool solved() const { return groups == 1; }
+    // Where a piece lies: its top-left on the board, the group holding it
+    // and its place in the drawing order (higher is in front).
+    float pieceX(int piece) const { return x[piece]; }
+    float pieceY(int piece) const { return y[piece]; }
+    int groupOf(int piece) const { return group[piece]; }
+    int depthOf(int piece) const { return depth[piece]; }
+
+    // All pieces, back to front, in one call. The texture holds the whole
+    // picture.
+    void draw(SDL_Renderer* renderer, SDL_Texture* texture);
+
+private:
+    void moveGroup(int group, float dx, float dy);
+    void merge(int into, int from);
+    int cellOf(int piece) const;
+    void placeInGrid(int piece);
+    void removeFromGrid(int piece);
+
+    int cols = 0, rows = 0;
+    float pieceWidth = 0, pieceHeight = 0;
+    float snapDistance = 0;
+
+    // Per piece, indexed row * cols + col in the picture.
+    std::vector<float> x, y;  // top-left on the board
+    std::vector<int> group;   // id of the group holding the piece
+    std::vector<int> depth;   // position in order
+    std::vector<int> cell;    // grid cell the piece is filed under
+    std::vector<int> slot;    // index within that cell
+
+    // Pieces of each group; emptied when merged into another.
+    std::vector<std::vector<int>> members;
+    int groups = 0;
+    // Back to front.
+    std::vector<int> order;
+
+    int gridCols = 0, gridRows = 0;
+    float cellSize = 0;
+    std::vector<std::vector<int>> grid;
+
+    int held = -1;  // group being dragged
+    float dragX = 0, dragY = 0;
+
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
@@ -4,37 +4,153 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "hotspot_layer.h"
+#include "jigsaw.h"
+#include "riddle_bank.h"
+#include "room_progress.h"
+#include "scaled_image_sdl.h"
+#include "scene_flow.h"
+#include "text_cache.h"
 
 const int SCREEN_WIDTH = 1024;
 const int SCREEN_HEIGHT = 768;
 const int PUZZLE_TIME_LIMIT = 30;
+const int QUESTION_WRAP = 800;
+const size_t PUZZLES_PER_GAME = 3;
+// Jigsaw mode: the picture is cut at this size and scattered over the
+// whole window. Large-format boards, over JIGSAW_LARGE_PIECES pieces, cut
+// the picture at window size instead so the pieces stay as big as they can:
+// 100 x 60 pieces are about 10 x 13 pixels.
+const int JIGSAW_PICTURE_WIDTH = 768;
+const int JIGSAW_PICTURE_HEIGHT = 576;
+const int JIGSAW_LARGE_PIECES = 1000;
+const int JIGSAW_COLS = 8;
+const int JIGSAW_ROWS = 6;
+// Past this many pieces a side they are 8 x 6 pixels even at window size.
+const int JIGSAW_MAX_SIDE = 128;
+// The menu's map shows the room as solved once it is recorded here.
+const char* PROGRESS_FILE = "../../menuforgame/progress.txt";
+const char* ROOM_ID = "decoder";
 
 struct Puzzle {
     std::string question;
-    std::string answer;
+    AnswerMatcher answer;
 };
 
-SDL_Texture* renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color, SDL_Rect& rectOut, int wrapLength = 800) {
-    SDL_Surface* surface = TTF_RenderText_Blended_Wrapped(font, text.c_str(), color, wrapLength);
-    if (!surface) return nullptr;
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    rectOut = {0, 0, surface->w, surface->h};
-    SDL_FreeSurface(surface);
-    return texture;
+// Picks distinct riddles at random; the bank is expected to be much larger
+// than count, so redraws are rare.
+std::vector<Puzzle> pickPuzzles(const RiddleBank& bank, size_t count) {
+    std::mt19937 random(std::random_device{}());
+    std::vector<size_t> picked;
+    while (picked.size() < std::min(count, bank.size())) {
+        size_t index = std::uniform_int_distribution<size_t>(0, bank.size() - 1)(random);
+        if (std::find(picked.begin(), picked.end(), index) == picked.end()) picked.push_back(index);
+    }
+    std::vector<Puzzle> puzzles;
+    for (size_t index : picked) {
+        Riddle riddle = bank.riddle(index);
+        puzzles.push_back({riddle.question, AnswerMatcher(riddle.answers)});
+    }
+    return puzzles;
 }
 
-SDL_Texture* loadTexture(SDL_Renderer* renderer, const std::string& path) {
-    SDL_Surface* surface = IMG_Load(path.c_str());
-    if (!surface) {
-        std::cerr << "Failed to load image: " << IMG_GetError() << std::endl;
-        return nullptr;
+// What the main loop draws; the room's flow moves it along.
+enum Phase { ENTER_NAME, CLICK_MONITOR, ASKING, SOLVED, TIMED_OUT, JIGSAW, JIGSAW_SOLVED, DECRYPTOR };
+
+struct Room {
+    Phase phase = ENTER_NAME;
+    TextField name;
+    TextField answer;
+    std::vector<Puzzle> puzzles;
+    size_t current = 0;
+    double deadline = 0;  // FlowRunner::now() when the puzzle times out
+    bool cleared = false;  // every riddle answered, or the jigsaw finished
+};
+
+// Each riddle against the clock, then SPACE for the next.
+Flow<> riddleRounds(FlowRunner& flows, Room& room) {
+    room.cleared = true;
+    for (room.current = 0; room.current < room.puzzles.size(); ++room.current) {
+        room.phase = ASKING;
+        room.answer.text.clear();
+        room.deadline = flows.now() + PUZZLE_TIME_LIMIT;
+        bool solved = false;
+        while (!solved) {
+            std::optional<std::string> answer = co_await flows.textEntered(room.answer, room.deadline - flows.now());
+            if (!answer) break;
+            solved = room.puzzles[room.current].answer.accepts(*answer);
+        }
+        room.phase = solved ? SOLVED : TIMED_OUT;
+        room.cleared = room.cleared && solved;
+        co_await flows.keyPressed(SDLK_SPACE);
     }
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    return texture;
 }
 
+// Pieces follow the mouse until every one is joined up.
+Flow<> jigsawRound(FlowRunner& flows, Room& room, JigsawBoard& board) {
+    room.phase = JIGSAW;
+    while (!board.solved()) {
+        co_await flows.nextFrame();
+        for (const SDL_Event& e : flows.events()) {
+            if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) board.press(e.button.x, e.button.y);
+            else if (e.type == SDL_MOUSEMOTION) board.drag(e.motion.x, e.motion.y);
+            else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT) board.release();
+        }
+    }
+    room.phase = JIGSAW_SOLVED;
+    room.cleared = true;
+    co_await flows.keyPressed(SDLK_SPACE);
+}
+
+// With a jigsaw board the monitor opens the jigsaw instead of the riddles.
+Flow<> decoderRoom(FlowRunner& flows, Room& room, const HotspotLayer& hotspots, int monitorSpot, JigsawBoard* jigsaw) {
+    room.phase = ENTER_NAME;
+    co_await flows.textEntered(room.name);
+
+    room.phase = CLICK_MONITOR;
+    for (;;) {
+        SDL_Event click = co_await flows.mouseClicked();
+        if (monitorSpot >= 0 && hotspots.hit(click.button.x, click.button.y) == monitorSpot) break;
+    }
+
+    if (jigsaw) co_await jigsawRound(flows, room, *jigsaw);
+    else co_await riddleRounds(flows, room);
+
+    if (room.cleared) markRoomSolved(PROGRESS_FILE, ROOM_ID);
+    room.phase = DECRYPTOR;
+    co_await flows.nextEvent([](const SDL_Event& e) { return e.type == SDL_KEYDOWN; });
+}
+
+// A piece count for one side of the jigsaw: a whole number from 1 to
+// JIGSAW_MAX_SIDE and nothing else.
+bool parseJigsawSide(const char* text, int& side) {
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+    if (end == text || *end || errno || value < 1 || value > JIGSAW_MAX_SIDE) return false;
+    side = int(value);
+    return true;
+}
+
+// Usage: main [--jigsaw [cols rows]]. Jigsaw mode swaps the riddles for
+// puzzleimage.png cut into cols x rows pieces (8 x 6 by default).
 int main(int argc, char* argv[]) {
+    const bool jigsawMode = argc > 1 && std::string(argv[1]) == "--jigsaw";
+    int jigsawCols = JIGSAW_COLS, jigsawRows = JIGSAW_ROWS;
+    if ((argc > 1 && !jigsawMode) || (jigsawMode && argc != 2 && argc != 4) ||
+        (argc == 4 && !(parseJigsawSide(argv[2], jigsawCols) && parseJigsawSide(argv[3], jigsawRows))) ||
+        jigsawCols * jigsawRows < 2) {
+        // One piece would start out solved.
+        std::cerr << "Usage: " << argv[0] << " [--jigsaw [cols rows]], cols and rows from 1 to " << JIGSAW_MAX_SIDE
+                  << ", at least two pieces\n";
+        return 1;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0 || TTF_Init() < 0 || IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG) == 0) {
         std::cerr << "Failed to initialize SDL/TTF/IMG\n";
         return 1;
@@ -48,164 +164,136 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    SDL_Texture* bgTexture = loadTexture(renderer, "puzzleimage.png");
+    SDL_Texture* bgTexture = loadScaledTexture(renderer, "puzzleimage.png", SCREEN_WIDTH, SCREEN_HEIGHT);
     SDL_Color white = {255, 255, 255, 255};
     SDL_Event e;
-
-    std::string playerName;
-    bool enteringName = true;
-    SDL_StartTextInput();
-
-    while (enteringName) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) return 0;
-            else if (e.type == SDL_TEXTINPUT) playerName += e.text.text;
-            else if (e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_BACKSPACE && !playerName.empty()) playerName.pop_back();
-                else if (e.key.keysym.sym == SDLK_RETURN && !playerName.empty()) enteringName = false;
-            }
-        }
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-        SDL_Rect rect;
-        SDL_Texture* namePrompt = renderText(renderer, font, "Enter your name to begin:", white, rect);
-        rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = 250;
-        SDL_RenderCopy(renderer, namePrompt, nullptr, &rect);
-        SDL_DestroyTexture(namePrompt);
-
-        SDL_Texture* nameText = renderText(renderer, font, playerName, white, rect);
-        rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = 320;
-        SDL_RenderCopy(renderer, nameText, nullptr, &rect);
-        SDL_DestroyTexture(nameText);
-
-        SDL_RenderPresent(renderer);
+    // Text is rasterised once and reused until it changes; freed with the
+    // renderer below.
+    TextCache* text = new TextCache(renderer);
+
+    Room room;
+    RiddleBank bank;
+    if (!bank.open("riddles.txt")) return 1;
+    room.puzzles = pickPuzzles(bank, PUZZLES_PER_GAME);
+
+    HotspotLayer hotspots;
+    if (!hotspots.load("hotspots.txt", decodeWithSdlImage)) return 1;
+    const int monitorSpot = hotspots.find("monitor");
+
+    JigsawBoard jigsaw;
+    SDL_Texture* jigsawTexture = nullptr;
+    if (jigsawMode) {
+        const bool largeFormat = jigsawCols * jigsawRows > JIGSAW_LARGE_PIECES;
+        const int pictureWidth = largeFormat ? SCREEN_WIDTH : JIGSAW_PICTURE_WIDTH;
+        const int pictureHeight = largeFormat ? SCREEN_HEIGHT : JIGSAW_PICTURE_HEIGHT;
+        jigsawTexture = loadScaledTexture(renderer, "puzzleimage.png", pictureWidth, pictureHeight);
+        if (!jigsawTexture) return 1;
+        jigsaw.build(jigsawCols, jigsawRows, pictureWidth, pictureHeight, SCREEN_WIDTH, SCREEN_HEIGHT,
+                     std::random_device{}());
     }
 
-    SDL_StopTextInput();
-
-    std::vector<Puzzle> puzzles = {
-        {"I have keys but no locks, I have space but no room. What am I?", "keyboard"},
-        {"What has to be broken before you use it?", "egg"},
-        {"The more you take, the more you leave behind. What am I?", "footsteps"}
-    };
-
-    int currentPuzzle = -1;
-    std::string userInput;
-    bool running = true, puzzleStarted = false, puzzleSolved = false, puzzleFailed = false;
-    Uint32 puzzleStartTime = 0;
-
-    SDL_Rect monitorTouchArea = {320, 256, 512, 320};
-
-    while (running) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) running = false;
-
-            if (!puzzleStarted && e.type == SDL_MOUSEBUTTONDOWN) {
-                int mx, my;
-                SDL_GetMouseState(&mx, &my);
-                if (mx > monitorTouchArea.x && mx < monitorTouchArea.x + monitorTouchArea.w &&
-                    my > monitorTouchArea.y && my < monitorTouchArea.y + monitorTouchArea.h) {
-                    currentPuzzle = 0;
-                    puzzleStarted = true;
-                    puzzleSolved = false;
-                    puzzleFailed = false;
-                    userInput.clear();
-                    puzzleStartTime = SDL_GetTicks();
-                }
+    // Once the puzzles are done the room window makes way for this one.
+    SDL_Window* winWindow = nullptr;
+    SDL_Renderer* winRenderer = nullptr;
+    SDL_Texture* winImage = nullptr;
+
+    // The only event loop: the room's flow is resumed from flows.update()
+    // and the phase it leaves decides what is drawn.
+    {
+        FlowRunner flows;
+        flows.start(decoderRoom(flows, room, hotspots, monitorSpot, jigsawMode ? &jigsaw : nullptr));
+
+        while (flows.running()) {
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) flows.stop();
+                flows.dispatch(e);
             }
-
-            if (puzzleStarted && !puzzleSolved && !puzzleFailed && e.type == SDL_KEYDOWN) {
-                if (e.key.keysym.sym == SDLK_BACKSPACE && !userInput.empty()) userInput.pop_back();
-                else if (e.key.keysym.sym == SDLK_RETURN) {
-                    if (userInput == puzzles[currentPuzzle].answer) puzzleSolved = true;
-                } else {
-                    char c = e.key.keysym.sym;
-                    if (c >= 32 && c <= 126) userInput += c;
+            flows.update();
+            if (!flows.running()) break;
+
+            if (room.phase == DECRYPTOR) {
+                if (!winWindow) {
+                    delete text;
+                    text = nullptr;
+                    SDL_DestroyTexture(bgTexture);
+                    bgTexture = nullptr;
+                    if (jigsawTexture) SDL_DestroyTexture(jigsawTexture);
+                    jigsawTexture = nullptr;
+                    SDL_DestroyRenderer(renderer);
+                    renderer = nullptr;
+                    SDL_DestroyWindow(window);
+                    window = nullptr;
+
+                    // Show decryptor image in new window after game is completed
+                    winWindow = SDL_CreateWindow("Decryptor Unlocked", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN);
+                    winRenderer = SDL_CreateRenderer(winWindow, -1, SDL_RENDERER_ACCELERATED);
+                    winImage = loadScaledTexture(winRenderer, "decryptorimage.png", 800, 600);
                 }
+
+                SDL_SetRenderDrawColor(winRenderer, 0, 0, 0, 255);
+                SDL_RenderClear(winRenderer);
+                if (winImage) SDL_RenderCopy(winRenderer, winImage, nullptr, nullptr);
+                SDL_RenderPresent(winRenderer);
+                continue;
             }
 
-            if ((puzzleSolved || puzzleFailed) && e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_SPACE) {
-                currentPuzzle++;
-                if (currentPuzzle < static_cast<int>(puzzles.size())) {
-                    puzzleStarted = true;
-                    puzzleSolved = false;
-                    puzzleFailed = false;
-                    userInput.clear();
-                    puzzleStartTime = SDL_GetTicks();
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+
+            if (room.phase == ENTER_NAME) {
+                text->draw(font, "Enter your name to begin:", white, SCREEN_WIDTH / 2, 250, 0.5f);
+                text->draw(font, room.name.text, white, SCREEN_WIDTH / 2, 320, 0.5f);
+            } else if (room.phase == JIGSAW || room.phase == JIGSAW_SOLVED) {
+                SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
+                SDL_RenderClear(renderer);
+                jigsaw.draw(renderer, jigsawTexture);
+                if (room.phase == JIGSAW_SOLVED)
+                    text->draw(font, "Solved! Press SPACE to continue.", white, SCREEN_WIDTH / 2, 20, 0.5f);
+                else
+                    text->draw(font, "Groups left: " + std::to_string(jigsaw.groupsLeft()), white, 20, 20);
+            } else {
+                if (bgTexture) SDL_RenderCopy(renderer, bgTexture, nullptr, nullptr);
+
+                if (room.phase == CLICK_MONITOR) {
+                    text->draw(font, "Click the screen to start the puzzle...", white, SCREEN_WIDTH / 2, SCREEN_HEIGHT - 100, 0.5f);
+                } else if (room.phase == SOLVED) {
+                    text->draw(font, "Correct! Press SPACE for next puzzle.", white, SCREEN_WIDTH / 2, 100, 0.5f);
+                } else if (room.phase == TIMED_OUT) {
+                    text->draw(font, "Time's up! Press SPACE to try next puzzle.", white, SCREEN_WIDTH / 2, 100, 0.5f);
                 } else {
-                    running = false;
+                    int secondsLeft = std::max(0, int(std::ceil(room.deadline - flows.now())));
+                    // Question, answer and timer are separate runs, so a keystroke or
+                    // a tick only rasterises the line that changed. They are stacked
+                    // a blank line apart and centred as one left-aligned block.
+                    const TextRun* runs[] = {
+                        &text->get(font, room.puzzles[room.current].question, white, QUESTION_WRAP),
+                        &text->get(font, "Your Answer: " + room.answer.text, white),
+                        &text->get(font, "Time Left: " + std::to_string(secondsLeft), white),
+                    };
+                    int blockWidth = 0;
+                    for (const TextRun* run : runs) blockWidth = std::max(blockWidth, run->w);
+                    const int gap = TTF_FontLineSkip(font);
+                    int y = 100;
+                    for (const TextRun* run : runs) y += text->draw(*run, (SCREEN_WIDTH - blockWidth) / 2, y).h + gap;
                 }
-            }
-        }
 
-        Uint32 now = SDL_GetTicks();
-        int secondsLeft = PUZZLE_TIME_LIMIT - (now - puzzleStartTime) / 1000;
-        if (puzzleStarted && !puzzleSolved && secondsLeft <= 0) puzzleFailed = true;
-
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-        if (bgTexture) SDL_RenderCopy(renderer, bgTexture, nullptr, nullptr);
-
-        SDL_Rect rect;
-        SDL_Texture* texture = nullptr;
-
-        if (!puzzleStarted) {
-            texture = renderText(renderer, font, "Click the screen to start the puzzle...", white, rect);
-            rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = SCREEN_HEIGHT - 100;
-        } else if (puzzleSolved) {
-            texture = renderText(renderer, font, "Correct! Press SPACE for next puzzle.", white, rect);
-            rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = 100;
-        } else if (puzzleFailed) {
-            texture = renderText(renderer, font, "Time's up! Press SPACE to try next puzzle.", white, rect);
-            rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = 100;
-        } else {
-            std::string fullText = puzzles[currentPuzzle].question + "\n\nYour Answer: " + userInput + "\n\nTime Left: " + std::to_string(secondsLeft);
-            texture = renderText(renderer, font, fullText, white, rect);
-            rect.x = (SCREEN_WIDTH - rect.w) / 2; rect.y = 100;
-        }
+                text->draw(font, "Welcome, " + room.name.text + "!", white, SCREEN_WIDTH - 20, 20, 1.0f);
+            }
 
-        if (texture) {
-            SDL_RenderCopy(renderer, texture, nullptr, &rect);
-            SDL_DestroyTexture(texture);
+            SDL_RenderPresent(renderer);
+            text->endFrame();
         }
-
-        SDL_Texture* welcomeTex = renderText(renderer, font, "Welcome, " + playerName + "!", white, rect);
-        rect.x = SCREEN_WIDTH - rect.w - 20;
-        rect.y = 20;
-        SDL_RenderCopy(renderer, welcomeTex, nullptr, &rect);
-        SDL_DestroyTexture(welcomeTex);
-
-        SDL_RenderPresent(renderer);
     }
 
-    SDL_DestroyTexture(bgTexture);
+    delete text;
+    if (bgTexture) SDL_DestroyTexture(bgTexture);
+    if (jigsawTexture) SDL_DestroyTexture(jigsawTexture);
     TTF_CloseFont(font);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-
-    // Show decryptor image in new window after game is completed
-    SDL_Window* winWindow = SDL_CreateWindow("Decryptor Unlocked", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_SHOWN);
-    SDL_Renderer* winRenderer = SDL_CreateRenderer(winWindow, -1, SDL_RENDERER_ACCELERATED);
-    SDL_Texture* winImage = loadTexture(winRenderer, "decryptorimage.png");
-
-    bool showing = true;
-    while (showing) {
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT || e.type == SDL_KEYDOWN) {
-                showing = false;
-            }
-        }
-
-        SDL_SetRenderDrawColor(winRenderer, 0, 0, 0, 255);
-        SDL_RenderClear(winRenderer);
-        if (winImage) SDL_RenderCopy(winRenderer, winImage, nullptr, nullptr);
-        SDL_RenderPresent(winRenderer);
-    }
-
-    SDL_DestroyTexture(winImage);
-    SDL_DestroyRenderer(winRenderer);
-    SDL_DestroyWindow(winWindow);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (window) SDL_DestroyWindow(window);
+    if (winImage) SDL_DestroyTexture(winImage);
+    if (winRenderer) SDL_DestroyRenderer(winRenderer);
+    if (winWindow) SDL_DestroyWindow(winWindow);
 
     IMG_Quit();
     TTF_Quit();
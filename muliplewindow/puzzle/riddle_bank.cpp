@@ -0,0 +1,250 @@
+#include "riddle_bank.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <memory>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+// No mmap: the file is read into memory instead.
+bool RiddleBank::Mapping::open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    size = size_t(in.tellg());
+    std::unique_ptr<char[]> buffer(new char[size ? size : 1]);
+    in.seekg(0);
+    if (!in.read(buffer.get(), std::streamsize(size))) return false;
+    data = buffer.release();
+    return true;
+}
+
+void RiddleBank::Mapping::close() {
+    delete[] data;
+    data = nullptr;
+    size = 0;
+}
+#else
+bool RiddleBank::Mapping::open(const std::string& path) {
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    off_t end = lseek(file, 0, SEEK_END);
+    size = end > 0 ? size_t(end) : 0;
+    void* mapped = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+    ::close(file);
+    if (size && mapped == MAP_FAILED) return false;
+    data = static_cast<const char*>(mapped);
+    return true;
+}
+
+void RiddleBank::Mapping::close() {
+    if (data) munmap(const_cast<char*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+#endif
+
+// Index file: a header naming the bank's size and modification time, then
+// one offset per riddle.
+struct IndexHeader {
+    char magic[4] = {'R', 'I', 'X', '1'};
+    uint32_t count = 0;
+    uint64_t bankBytes = 0;
+    uint64_t bankTime = 0;
+};
+
+RiddleBank::~RiddleBank() {
+    bank.close();
+    index.close();
+}
+
+bool RiddleBank::open(const std::string& path) {
+    bank.close();
+    index.close();
+    builtOffsets.clear();
+    offsets = nullptr;
+    count = 0;
+
+    if (!bank.open(path)) {
+        std::cerr << "Could not open riddle bank " << path << std::endl;
+        return false;
+    }
+    std::error_code error;
+    uint64_t bankTime = uint64_t(fs::last_write_time(path, error).time_since_epoch().count());
+    if (!mapIndex(path + ".idx", bankTime)) buildIndex(path + ".idx", bankTime);
+    if (!count) {
+        std::cerr << "No riddles in " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RiddleBank::mapIndex(const std::string& path, uint64_t bankTime) {
+    if (!index.open(path)) return false;
+    IndexHeader header;
+    if (index.size >= sizeof header) std::memcpy(&header, index.data, sizeof header);
+    if (index.size < sizeof header || std::memcmp(header.magic, IndexHeader().magic, 4) != 0 ||
+        header.bankBytes != bank.size || header.bankTime != bankTime ||
+        index.size != sizeof header + size_t(header.count) * sizeof(uint64_t)) {
+        index.close();
+        return false;
+    }
+    offsets = reinterpret_cast<const uint64_t*>(index.data + sizeof header);
+    count = header.count;
+    return true;
+}
+
+// One pass over the bank looking at line starts only. Written under a
+// temporary name and renamed, so a reader never sees half a file.
+void RiddleBank::buildIndex(const std::string& path, uint64_t bankTime) {
+    const char* line = bank.data;
+    const char* end = bank.data + bank.size;
+    while (line < end) {
+        const char* next = static_cast<const char*>(std::memchr(line, '\n', size_t(end - line)));
+        next = next ? next + 1 : end;
+        if (*line != '#' && *line != '\n' && *line != '\r') builtOffsets.push_back(uint64_t(line - bank.data));
+        line = next;
+    }
+    offsets = builtOffsets.data();
+    count = builtOffsets.size();
+
+    IndexHeader header;
+    header.count = uint32_t(count);
+    header.bankBytes = bank.size;
+    header.bankTime = bankTime;
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof header);
+        out.write(reinterpret_cast<const char*>(builtOffsets.data()), std::streamsize(count * sizeof(uint64_t)));
+        if (!out) {
+            std::cerr << "Could not write " << temporary << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    if (error) std::cerr << "Could not write " << path << ": " << error.message() << std::endl;
+}
+
+Riddle RiddleBank::riddle(size_t i) const {
+    const char* line = bank.data + offsets[i];
+    const char* end = bank.data + bank.size;
+    const char* newline = static_cast<const char*>(std::memchr(line, '\n', size_t(end - line)));
+    if (newline) end = newline;
+    if (end > line && end[-1] == '\r') --end;
+
+    Riddle riddle;
+    const char* field = static_cast<const char*>(std::memchr(line, '|', size_t(end - line)));
+    riddle.question.assign(line, field ? field : end);
+    while (field) {
+        const char* start = field + 1;
+        field = static_cast<const char*>(std::memchr(start, '|', size_t(end - start)));
+        riddle.answers.emplace_back(start, field ? field : end);
+    }
+    return riddle;
+}
+
+static int symbol(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    return 36;
+}
+
+std::string AnswerMatcher::normalize(const std::string& text) {
+    std::string out;
+    bool space = false;
+    for (char c : text) {
+        if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            if (space && !out.empty()) out += ' ';
+            out += c;
+            space = false;
+        } else if (c != '\'') {
+            space = true;
+        }
+    }
+    for (const char* article : {"a ", "an ", "the "}) {
+        size_t length = std::strlen(article);
+        if (out.size() > length && out.compare(0, length, article) == 0) return out.substr(length);
+    }
+    return out;
+}
+
+AnswerMatcher::AnswerMatcher(const std::vector<std::string>& answers) : trie(1) {
+    for (const std::string& answer : answers) {
+        std::string variant = normalize(answer);
+        if (variant.empty()) continue;
+        int node = 0;
+        for (char c : variant) {
+            int s = symbol(c);
+            if (trie[node].next[s] < 0) {
+                trie[node].next[s] = int32_t(trie.size());
+                trie.emplace_back();
+            }
+            node = trie[node].next[s];
+        }
+        trie[node].end = true;
+        variants.push_back(variant);
+    }
+}
+
+bool AnswerMatcher::accepts(const std::string& input) const {
+    std::string text = normalize(input);
+    if (text.empty()) return false;
+
+    int node = 0;
+    for (char c : text) {
+        node = trie[node].next[symbol(c)];
+        if (node < 0) break;
+    }
+    if (node >= 0 && trie[node].end) return true;
+
+    for (const std::string& variant : variants) {
+        int typos = maxTypos(variant.size());
+        if (!typos || variant.size() > 64) continue;
+        // The distance is at least the difference in length.
+        if (std::max(variant.size(), text.size()) - std::min(variant.size(), text.size()) > size_t(typos)) continue;
+        if (editDistance(variant, text) <= typos) return true;
+    }
+    return false;
+}
+
+// Myers (1999) in Hyyro's form for whole-string distance. Bit i of the
+// vertical delta vectors Pv/Mv says whether D[i+1][j] - D[i][j] is +1/-1;
+// each text character updates all m rows of the column at once. The +1
+// shifted into Ph is the top row, D[0][j] = j.
+int AnswerMatcher::editDistance(const std::string& pattern, const std::string& text) {
+    const size_t m = pattern.size();
+    if (m == 0) return int(text.size());
+    std::array<uint64_t, 256> peq = {};
+    for (size_t i = 0; i < m; ++i) peq[uint8_t(pattern[i])] |= uint64_t(1) << i;
+
+    const uint64_t last = uint64_t(1) << (m - 1);
+    uint64_t pv = ~uint64_t(0), mv = 0;
+    int score = int(m);
+    for (char c : text) {
+        uint64_t eq = peq[uint8_t(c)];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last) ++score;
+        else if (mh & last) --score;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
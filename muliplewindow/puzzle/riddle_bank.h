@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A riddle and the answers it accepts, the first one canonical.
+struct Riddle {
+    std::string question;
+    std::vector<std::string> answers;
+};
+
+// Riddles read straight out of a memory-mapped text file, one per line:
+//
+//   # question|answer[|variant ...]
+//   What has to be broken before you use it?|egg|an egg
+//
+// Blank lines and lines starting with '#' are skipped. The offset of each
+// riddle's line is kept in <bank>.idx, rebuilt when the bank's size or
+// modification time changes, so opening even a large bank maps two files
+// and parses nothing; a riddle is parsed when it is asked for.
+class RiddleBank {
+public:
+    RiddleBank() = default;
+    ~RiddleBank();
+
+    RiddleBank(const RiddleBank&) = delete;
+    RiddleBank& operator=(const RiddleBank&) = delete;
+
+    // False, with the reason on std::cerr, if the bank cannot be read or
+    // holds no riddles.
+    bool open(const std::string& path);
+    size_t size() const { return count; }
+    Riddle riddle(size_t index) const;
+
+private:
+    // A read-only view of a whole file.
+    struct Mapping {
+        const char* data = nullptr;
+        size_t size = 0;
+        bool open(const std::string& path);
+        void close();
+    };
+
+    bool mapIndex(const std::string& path, uint64_t bankTime);
+    void buildIndex(const std::string& path, uint64_t bankTime);
+
+    Mapping bank;
+    Mapping index;
+    const uint64_t* offsets = nullptr;
+    std::vector<uint64_t> builtOffsets;  // when the index could not be written
+    size_t count = 0;
+};
+
+// Decides whether typed input answers a riddle.
+//
+// Answers are compared normalised: lower case, punctuation and runs of
+// spaces folded to one space, a leading "a", "an" or "the" dropped. An exact
+// match is a walk down a trie of the riddle's variants. Failing that, input
+// within maxTypos() edits of a variant is accepted ("keybord",
+// "footstep"), using Myers' bit-parallel edit distance: one pass over the
+// input with a few word operations per character. Variants longer than 64
+// characters only match exactly.
+class AnswerMatcher {
+public:
+    explicit AnswerMatcher(const std::vector<std::string>& answers);
+
+    bool accepts(const std::string& input) const;
+
+    static std::string normalize(const std::string& text);
+    // None below eight characters, where one edit often makes another real
+    // word ("tower", "clock" for "block"); one from eight, two from twelve.
+    static int maxTypos(size_t length) { return length >= 12 ? 2 : length >= 8 ? 1 : 0; }
+    // Levenshtein distance; pattern at most 64 characters.
+    static int editDistance(const std::string& pattern, const std::string& text);
+
+private:
+    // Normalised text uses a-z, 0-9 and space.
+    static const int ALPHABET = 37;
+
+    struct Node {
+        std::array<int32_t, ALPHABET> next;
+        bool end = false;
+        Node() { next.fill(-1); }
+    };
+
+    std::vector<Node> trie;
+    std::vector<std::string> variants;
+};
@@ -0,0 +1,67 @@
+#include "text_cache.h"
+#include <functional>
+
+size_t TextCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::string>()(key.text);
+    hash ^= std::hash<const void*>()(key.font) + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    hash ^= (uint64_t(key.color) << 32 | uint32_t(key.wrap)) + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+TextCache::TextCache(SDL_Renderer* renderer, size_t budgetBytes) : renderer(renderer), budget(budgetBytes) {}
+
+TextCache::~TextCache() {
+    for (auto& item : runs)
+        if (item.second.run.texture) SDL_DestroyTexture(item.second.run.texture);
+}
+
+const TextRun& TextCache::get(TTF_Font* font, const std::string& text, SDL_Color color, int wrap) {
+    Key key = {font, text, uint32_t(color.r) << 24 | color.g << 16 | color.b << 8 | color.a, wrap};
+    auto found = runs.find(key);
+    if (found != runs.end()) {
+        Entry& entry = found->second;
+        ages.splice(ages.begin(), ages, entry.age);
+        entry.frame = frame;
+        return entry.run;
+    }
+
+    ++misses;
+    TextRun run;
+    if (!text.empty()) {
+        SDL_Surface* surface = wrap > 0 ? TTF_RenderText_Blended_Wrapped(font, text.c_str(), color, wrap)
+                                        : TTF_RenderText_Blended(font, text.c_str(), color);
+        if (surface) {
+            run.texture = SDL_CreateTextureFromSurface(renderer, surface);
+            run.w = surface->w;
+            run.h = surface->h;
+            SDL_FreeSurface(surface);
+        }
+    }
+    auto inserted = runs.emplace(std::move(key), Entry()).first;
+    Entry& entry = inserted->second;
+    entry.run = run;
+    entry.frame = frame;
+    ages.push_front(&inserted->first);
+    entry.age = ages.begin();
+    bytes += size_t(run.w) * run.h * 4;
+    return entry.run;
+}
+
+SDL_Rect TextCache::draw(const TextRun& run, int x, int y, float anchorX) {
+    SDL_Rect rect = {x - int(anchorX * run.w), y, run.w, run.h};
+    if (run.texture) SDL_RenderCopy(renderer, run.texture, nullptr, &rect);
+    return rect;
+}
+
+void TextCache::endFrame() {
+    while (bytes > budget && !ages.empty()) {
+        auto found = runs.find(*ages.back());
+        Entry& entry = found->second;
+        if (entry.frame == frame) break;  // the rest were used this frame too
+        if (entry.run.texture) SDL_DestroyTexture(entry.run.texture);
+        bytes -= size_t(entry.run.w) * entry.run.h * 4;
+        ages.pop_back();
+        runs.erase(found);
+    }
+    ++frame;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// A rasterised piece of text.
+struct TextRun {
+    SDL_Texture* texture = nullptr;  // nullptr for empty text
+    int w = 0, h = 0;
+};
+
+// Rendered text kept as textures between frames, keyed by font, string,
+// colour and wrap width, so unchanged text is never wrapped or rasterised
+// again. Runs are only evicted in endFrame(), least recently used first,
+// so everything fetched during a frame stays valid until then.
+class TextCache {
+public:
+    explicit TextCache(SDL_Renderer* renderer, size_t budgetBytes = 4 << 20);
+    ~TextCache();
+
+    TextCache(const TextCache&) = delete;
+    TextCache& operator=(const TextCache&) = delete;
+
+    // wrap = 0 renders a single line.
+    const TextRun& get(TTF_Font* font, const std::string& text, SDL_Color color, int wrap = 0);
+
+    // Draws the run with its top at y and its left edge at x - anchorX * w
+    // (0 = left aligned, 0.5 = centred, 1 = right aligned). Returns where.
+    SDL_Rect draw(const TextRun& run, int x, int y, float anchorX = 0.0f);
+    SDL_Rect draw(TTF_Font* font, const std::string& text, SDL_Color color, int x, int y, float anchorX = 0.0f,
+                  int wrap = 0) {
+        return draw(get(font, text, color, wrap), x, y, anchorX);
+    }
+
+    // Evicts runs not used this frame while over budget.
+    void endFrame();
+
+    size_t usedBytes() const { return bytes; }
+    // Runs rasterised so far, to check the cache is doing its job.
+    long rasterised() const { return misses; }
+
+private:
+    struct Key {
+        TTF_Font* font;
+        std::string text;
+        uint32_t color;
+        int wrap;
+        bool operator==(const Key& other) const {
+            return font == other.font && color == other.color && wrap == other.wrap && text == other.text;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    struct Entry {
+        TextRun run;
+        std::list<const Key*>::iterator age;
+        uint64_t frame = 0;
+    };
+
+    SDL_Renderer* renderer;
+    size_t budget;
+    size_t bytes = 0;
+    long misses = 0;
+    uint64_t frame = 0;
+    std::unordered_map<Key, Entry, KeyHash> runs;
+    std::list<const Key*> ages;  // most recently used first
+};
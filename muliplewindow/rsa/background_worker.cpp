@@ -0,0 +1,71 @@
+#include "background_worker.h"
+#include <exception>
+
+BackgroundWorker::BackgroundWorker() : thread(&BackgroundWorker::run, this) {}
+
+BackgroundWorker::~BackgroundWorker() {
+    {
+        std::lock_guard<std::mutex> guard(inboxLock);
+        stopping = true;
+        ++generation;
+        pending = nullptr;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+uint64_t BackgroundWorker::submit(Job job) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> guard(inboxLock);
+        id = ++generation;
+        pending = std::move(job);
+        pendingId = id;
+    }
+    wake.notify_one();
+    return id;
+}
+
+void BackgroundWorker::cancel() {
+    std::lock_guard<std::mutex> guard(inboxLock);
+    ++generation;
+    pending = nullptr;
+}
+
+void BackgroundWorker::run() {
+    while (true) {
+        Job job;
+        uint64_t id;
+        {
+            std::unique_lock<std::mutex> guard(inboxLock);
+            wake.wait(guard, [this] { return stopping || pending; });
+            if (stopping) return;
+            job = std::move(pending);
+            pending = nullptr;
+            id = pendingId;
+        }
+
+        JobContext context(generation, id, progressDone, progressTotal);
+        context.setTotal(0);
+        JobResult result;
+        result.id = id;
+        try {
+            result.text = job(context);
+        } catch (const JobCancelled&) {
+            continue;
+        } catch (const std::exception& e) {
+            result.failed = true;
+            result.text = e.what();
+        } catch (...) {
+            result.failed = true;
+        }
+        if (context.cancelled()) continue;
+
+        // The UI drains the queue every frame, so it is only full if the UI
+        // has stalled; wait for room rather than drop a result.
+        while (!results.push(std::move(result))) {
+            if (stopping) return;
+            std::this_thread::yield();
+        }
+    }
+}
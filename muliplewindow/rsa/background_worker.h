@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "spsc_queue.h"
+
+// Thrown by a job that notices it was cancelled.
+struct JobCancelled {};
+
+// Handed to a running job so it can report progress and notice that it has
+// been superseded or cancelled.
+class JobContext {
+public:
+    bool cancelled() const { return generation.load(std::memory_order_relaxed) != id; }
+
+    // Progress is done / total units; a total of 0 means "unknown".
+    void setTotal(size_t units) {
+        done.store(0, std::memory_order_relaxed);
+        total.store(units, std::memory_order_relaxed);
+    }
+    void advance(size_t units = 1) { done.fetch_add(units, std::memory_order_relaxed); }
+
+private:
+    friend class BackgroundWorker;
+    JobContext(const std::atomic<uint64_t>& generation, uint64_t id, std::atomic<size_t>& done, std::atomic<size_t>& total)
+        : generation(generation), id(id), done(done), total(total) {}
+
+    const std::atomic<uint64_t>& generation;
+    uint64_t id;
+    std::atomic<size_t>& done;
+    std::atomic<size_t>& total;
+};
+
+struct JobResult {
+    uint64_t id = 0;
+    bool failed = false;  // the job threw; text holds the message
+    std::string text;
+};
+
+// One background thread that runs at most one job at a time, for keeping
+// slow work off the SDL event loop. Submitting a job cancels the one before
+// it. Finished jobs come back through a lock-free queue that the UI thread
+// drains with poll(); cancelled jobs produce no result.
+class BackgroundWorker {
+public:
+    typedef std::function<std::string(JobContext&)> Job;
+
+    BackgroundWorker();
+    // Cancels whatever is running and waits for the thread to finish.
+    ~BackgroundWorker();
+
+    BackgroundWorker(const BackgroundWorker&) = delete;
+    BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+
+    // Returns the job's id, as reported back in JobResult::id.
+    uint64_t submit(Job job);
+    void cancel();
+
+    // UI thread only.
+    bool poll(JobResult& result) { return results.pop(result); }
+
+    // Progress of the current job, as set through JobContext.
+    void progress(size_t& done, size_t& total) const {
+        done = progressDone.load(std::memory_order_relaxed);
+        total = progressTotal.load(std::memory_order_relaxed);
+    }
+
+private:
+    void run();
+
+    std::atomic<uint64_t> generation{0};
+    std::atomic<size_t> progressDone{0};
+    std::atomic<size_t> progressTotal{0};
+    std::atomic<bool> stopping{false};
+
+    std::mutex inboxLock;
+    std::condition_variable wake;
+    Job pending;
+    uint64_t pendingId = 0;
+
+    SpscQueue<JobResult, 16> results;
+    std::thread thread;
+};
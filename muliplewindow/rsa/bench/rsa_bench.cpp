@@ -0,0 +1,233 @@
+// Microbenchmarks for the RSA core. Builds without SDL (`make bench`) and
+// prints one JSON document on stdout so runs can be diffed across commits:
+//
+//   ./rsa_bench [min-seconds-per-case] > bench.json
+//
+// Keys are synthetic: timing of Montgomery arithmetic does not depend on
+// whether n is really a product of two primes, only on its width.
+#include "../rsa_core.h"
+#include "../rsa_factor.h"
+#include "../rsa_keygen.h"
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static uint64_t rngState = 0x243F6A8885A308D3ULL;
+
+static uint64_t nextRandom() {
+    // xorshift64*: fixed seed so every run measures the same operands.
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+template <size_t Bits>
+static BigUInt<Bits> randomOdd(size_t bits) {
+    BigUInt<Bits> value;
+    for (size_t i = 0; i < (bits + 63) / 64; ++i) value.limb[i] = nextRandom();
+    if (bits % 64) value.limb[bits / 64] &= (1ULL << (bits % 64)) - 1;
+    value.limb[(bits - 1) / 64] |= 1ULL << ((bits - 1) % 64);
+    value.limb[0] |= 1;
+    return value;
+}
+
+template <size_t Bits>
+static BigUInt<Bits> randomBelow(const BigUInt<Bits>& bound) {
+    BigUInt<Bits> value = randomOdd<Bits>(bound.bitLength());
+    value.limb[(bound.bitLength() - 1) / 64] &= ~(1ULL << ((bound.bitLength() - 1) % 64));
+    return value;
+}
+
+// Runs body repeatedly for at least minSeconds; returns seconds per call.
+static double timePerCall(double minSeconds, const std::function<void()>& body) {
+    typedef std::chrono::steady_clock Clock;
+    body();  // warm-up
+    size_t calls = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        body();
+        ++calls;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return elapsed / calls;
+}
+
+struct JsonRows {
+    std::vector<std::string> rows;
+    void add(const std::string& row) { rows.push_back(row); }
+    std::string join() const {
+        std::string out;
+        for (size_t i = 0; i < rows.size(); ++i) out += (i ? ",\n    " : "\n    ") + rows[i];
+        return out + "\n  ";
+    }
+};
+
+static volatile uint64_t sink;
+
+template <size_t Bits>
+static void benchModExp(double minSeconds, JsonRows& rows) {
+    typedef BigUInt<Bits> Int;
+    Montgomery<Bits> mont(randomOdd<Bits>(Bits));
+    Int base = randomBelow(mont.modulus());
+
+    Int allOnes;
+    for (size_t i = 0; i < Int::LIMBS; ++i) allOnes.limb[i] = ~0ULL;
+    struct Exponent { const char* density; Int value; };
+    const Exponent exponents[] = {
+        {"sparse", Int(65537)},
+        {"random", randomBelow(mont.modulus())},
+        {"dense", allOnes}
+    };
+    for (const auto& exponent : exponents) {
+        double seconds = timePerCall(minSeconds, [&] { sink = mont.modExp(base, exponent.value).limb[0]; });
+        std::ostringstream row;
+        row << "{\"bits\": " << Bits << ", \"exponent\": \"" << exponent.density
+            << "\", \"exponent_bits\": " << exponent.value.bitLength()
+            << ", \"ops_per_sec\": " << 1.0 / seconds << "}";
+        rows.add(row.str());
+    }
+}
+
+static void benchWordModExp(double minSeconds, JsonRows& rows) {
+    const long long n = 3037000493LL * 3037000453LL % (1LL << 62);
+    double seconds = timePerCall(minSeconds, [&] {
+        for (int i = 0; i < 1000; ++i) sink = mod_exp(123456789 + i, 65537, n | 1);
+    }) / 1000;
+    std::ostringstream row;
+    row << "{\"bits\": 63, \"exponent\": \"sparse\", \"exponent_bits\": 17, \"ops_per_sec\": " << 1.0 / seconds << "}";
+    rows.add(row.str());
+}
+
+template <size_t Bits>
+static void benchParse(double minSeconds, JsonRows& rows) {
+    typedef BigUInt<Bits> Int;
+    Int n = randomOdd<Bits>(Bits);
+    std::string text;
+    const size_t tokens = 4096;
+    for (size_t i = 0; i < tokens; ++i) text += randomBelow(n).toDecimal() + (i % 16 == 15 ? "\n" : " ");
+
+    double seconds = timePerCall(minSeconds, [&] {
+        const char* pos = text.data();
+        const char* end = pos + text.size();
+        TokenSpan token;
+        while (nextToken(pos, end, token)) sink = parseToken<Int>(token).limb[0];
+    });
+    std::ostringstream row;
+    row << "{\"bits\": " << Bits << ", \"tokens_per_sec\": " << tokens / seconds
+        << ", \"mb_per_sec\": " << text.size() / seconds / 1e6 << "}";
+    rows.add(row.str());
+}
+
+template <size_t Bits>
+static void benchDecrypt(double minSeconds, size_t messageChars, JsonRows& rows) {
+    // A real key: tokens that do not decrypt to a byte are rejected.
+    RSAPrivateKey key = generateKey(Bits, 1);
+
+    Montgomery<Bits> mont(key.n.template resize<Bits>());
+    std::string encrypted;
+    for (size_t i = 0; i < messageChars; ++i)
+        encrypted += mont.modExp(BigUInt<Bits>('a' + i % 26), BigUInt<Bits>(65537)).toDecimal() + " ";
+
+    const std::string d = key.d.toDecimal(), n = key.n.toDecimal(), e = "65537";
+    struct Path { const char* name; std::function<void()> run; };
+    const Path paths[] = {
+        {"plain", [&] { sink = decryptRSA(encrypted, d, n).size(); }},
+        {"crt", [&] { sink = decryptRSACRT(encrypted, key).size(); }},
+        {"plain_batch", [&] { sink = decryptRSABatch(encrypted, d, n).size(); }},
+        {"crt_batch", [&] { sink = decryptRSACRTBatch(encrypted, key).size(); }},
+        {"table", [&] { sink = decryptRSATable(encrypted, e, d, n).size(); }}
+    };
+    for (const auto& path : paths) {
+        double seconds = timePerCall(minSeconds, path.run);
+        std::ostringstream row;
+        row << "{\"bits\": " << Bits << ", \"path\": \"" << path.name << "\", \"message_chars\": " << messageChars
+            << ", \"latency_ms\": " << seconds * 1e3 << "}";
+        rows.add(row.str());
+    }
+}
+
+// Key generation time depends on how far the sieve has to walk, so average
+// over a handful of seeds rather than repeating one.
+static void benchKeygen(size_t bits, size_t seeds, JsonRows& rows) {
+    typedef std::chrono::steady_clock Clock;
+    double total = 0, worst = 0;
+    for (uint64_t seed = 1; seed <= seeds; ++seed) {
+        auto start = Clock::now();
+        sink = generateKey(bits, seed).n.limb[0];
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        total += seconds;
+        worst = std::max(worst, seconds);
+    }
+    std::ostringstream row;
+    row << "{\"bits\": " << bits << ", \"keys\": " << seeds << ", \"mean_ms\": " << total / seeds * 1e3
+        << ", \"max_ms\": " << worst * 1e3 << "}";
+    rows.add(row.str());
+}
+
+// Rho's running time is random (about sqrt(p) steps), so report the spread
+// over several keys of each size.
+static void benchFactor(size_t bits, size_t keys, JsonRows& rows) {
+    typedef std::chrono::steady_clock Clock;
+    double total = 0, worst = 0;
+    size_t cracked = 0;
+    for (uint64_t seed = 1; seed <= keys; ++seed) {
+        RSAPrivateKey key = generateKey(bits, seed);
+        RSAPrivateKey found;
+        auto start = Clock::now();
+        if (crackKey(key.n, key.e, found) && found.d == key.d) ++cracked;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        total += seconds;
+        worst = std::max(worst, seconds);
+    }
+    std::ostringstream row;
+    row << "{\"bits\": " << bits << ", \"keys\": " << keys << ", \"cracked\": " << cracked
+        << ", \"mean_ms\": " << total / keys * 1e3 << ", \"max_ms\": " << worst * 1e3 << "}";
+    rows.add(row.str());
+}
+
+int main(int argc, char* argv[]) {
+    double minSeconds = argc > 1 ? std::stod(argv[1]) : 0.25;
+
+    JsonRows modExp, parse, decrypt, keygen, factor;
+    benchWordModExp(minSeconds, modExp);
+    benchModExp<512>(minSeconds, modExp);
+    benchModExp<1024>(minSeconds, modExp);
+    benchModExp<2048>(minSeconds, modExp);
+    benchModExp<4096>(minSeconds, modExp);
+
+    benchParse<512>(minSeconds, parse);
+    benchParse<1024>(minSeconds, parse);
+    benchParse<2048>(minSeconds, parse);
+    benchParse<4096>(minSeconds, parse);
+
+    benchDecrypt<512>(minSeconds, 64, decrypt);
+    benchDecrypt<1024>(minSeconds, 64, decrypt);
+    benchDecrypt<2048>(minSeconds, 64, decrypt);
+    benchDecrypt<4096>(minSeconds, 16, decrypt);
+
+    benchKeygen(512, 16, keygen);
+    benchKeygen(1024, 16, keygen);
+    benchKeygen(2048, 8, keygen);
+    benchKeygen(4096, 2, keygen);
+
+    // Past ~96 bits a single key takes seconds; 128 bits takes hours.
+    for (size_t bits = 32; bits <= 96; bits += 8) benchFactor(bits, 8, factor);
+
+    std::cout << "{\n"
+              << "  \"benchmark\": \"rsa_core\",\n"
+              << "  \"threads\": " << sharedWorkPool().size() << ",\n"
+              << "  \"min_seconds_per_case\": " << minSeconds << ",\n"
+              << "  \"modexp\": [" << modExp.join() << "],\n"
+              << "  \"parse\": [" << parse.join() << "],\n"
+              << "  \"decrypt\": [" << decrypt.join() << "],\n"
+              << "  \"keygen\": [" << keygen.join() << "],\n"
+              << "  \"factor\": [" << factor.join() << "]\n"
+              << "}\n";
+    return 0;
+}
@@ -0,0 +1,219 @@
+// Consistency checks for the RSA core. Builds without SDL (`make check`),
+// prints one line per failure and exits non-zero if there was any.
+//
+// CRT decryption must give exactly what the plain d mod n path gives, for
+// generated keys of every width the room supports, and key files with a
+// field missing, repeated or inconsistent must not load. Tokens that do not
+// decrypt to a byte must be rejected, not cut down to their low byte. The
+// command-line decryptor must fail cleanly on a bad token in a large file.
+#include "../rsa_cli.h"
+#include "../rsa_core.h"
+#include "../rsa_keygen.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static size_t failures = 0;
+
+static void expect(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cout << "FAIL " << what << "\n";
+    ++failures;
+}
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t nextRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+// Random tokens below n: the plain and CRT paths have to agree on all of
+// c^d for any c, not only for ciphertexts of bytes.
+static std::string randomCiphertext(const BigUInt<4096>& n, size_t tokens) {
+    const size_t bits = n.bitLength() - 1;
+    std::string text;
+    for (size_t t = 0; t < tokens; ++t) {
+        BigUInt<4096> c;
+        for (size_t i = 0; i < (bits + 63) / 64; ++i) c.limb[i] = nextRandom();
+        if (bits % 64) c.limb[bits / 64] &= (1ULL << (bits % 64)) - 1;
+        text += c.toDecimal() + " ";
+    }
+    return text;
+}
+
+template <typename Fn>
+static bool rejectsAsNotAByte(Fn decrypt) {
+    try {
+        decrypt();
+    } catch (const NotAByte&) {
+        return true;
+    } catch (...) {
+    }
+    return false;
+}
+
+static void checkCRTMatchesPlain(size_t bits, uint64_t seed) {
+    std::string message;
+    for (int byte = 0; byte < 256; ++byte) message += static_cast<char>(byte);
+    RSAPuzzle puzzle = generatePuzzle(bits, message, seed);
+    const RSAPrivateKey& key = puzzle.key;
+    const std::string d = key.d.toDecimal(), n = key.n.toDecimal();
+    const std::string label = std::to_string(bits) + "-bit key, seed " + std::to_string(seed);
+
+    std::string plain = decryptRSA(puzzle.ciphertext, d, n);
+    expect(plain == message, label + ": plain path does not round-trip");
+    expect(decryptRSACRT(puzzle.ciphertext, key) == plain, label + ": CRT differs from plain on byte ciphertexts");
+    expect(decryptRSACRTBatch(puzzle.ciphertext, key) == plain, label + ": batched CRT differs from plain");
+
+    std::string random = randomCiphertext(key.n, 64);
+    withPlainDecryptor(d, n, [&](const auto& plainPath) {
+        return withCRTDecryptor(key, [&](const auto& crtPath) {
+            const char* pos = random.data();
+            const char* end = pos + random.size();
+            TokenSpan token;
+            bool same = true;
+            while (same && nextToken(pos, end, token))
+                same = plainPath.value(token).toDecimal() == crtPath.value(token).toDecimal();
+            expect(same, label + ": CRT differs from plain on random tokens");
+            return same;
+        });
+    });
+
+    // Almost no random token decrypts to a byte, and a wrong d turns most
+    // byte ciphertexts into something larger.
+    expect(rejectsAsNotAByte([&] { decryptRSA(random, d, n); }), label + ": plain path accepted random tokens");
+    expect(rejectsAsNotAByte([&] { decryptRSABatch(random, d, n); }), label + ": batched plain accepted random tokens");
+    expect(rejectsAsNotAByte([&] { decryptRSACRT(random, key); }), label + ": CRT accepted random tokens");
+    expect(rejectsAsNotAByte([&] { decryptRSACRTBatch(random, key); }), label + ": batched CRT accepted random tokens");
+    expect(rejectsAsNotAByte([&] { decryptRSATable(random, key.e.toDecimal(), d, n); }),
+           label + ": table path accepted random tokens");
+    BigUInt<4096> wrongD = key.d;
+    wrongD.add(BigUInt<4096>(2));
+    expect(rejectsAsNotAByte([&] { decryptRSA(puzzle.ciphertext, wrongD.toDecimal(), n); }),
+           label + ": plain path accepted a wrong d");
+}
+
+// The word-size path for toy keys: n = 2537 = 43 * 59, e = 13, d = 937.
+static void checkToyKey() {
+    const long long n = 2537, e = 13, d = 937;
+    std::string ciphertext;
+    for (char c : std::string("Toy"))
+        ciphertext += std::to_string(mod_exp(static_cast<unsigned char>(c), e, n)) + " ";
+    expect(decryptRSA(ciphertext, d, n) == "Toy", "toy key does not round-trip");
+    expect(rejectsAsNotAByte([&] { decryptRSA(ciphertext, d + 2, n); }), "toy key accepted a wrong d");
+}
+
+// Writes key as a key file, with field set to value (or left out when
+// value is empty) and extra appended.
+static void writeKeyFile(const std::string& path, const RSAPrivateKey& key, const std::string& field,
+                         const std::string& value, const std::string& extra = "") {
+    const std::pair<const char*, const BigUInt<4096>*> fields[] = {
+        {"n", &key.n}, {"e", &key.e}, {"d", &key.d}, {"p", &key.p}, {"q", &key.q},
+        {"dP", &key.dP}, {"dQ", &key.dQ}, {"qInv", &key.qInv}
+    };
+    std::ofstream out(path);
+    for (const auto& entry : fields) {
+        if (entry.first != field) out << entry.first << " = " << entry.second->toDecimal() << "\n";
+        else if (!value.empty()) out << entry.first << " = " << value << "\n";
+    }
+    out << extra;
+}
+
+static void checkKeyFiles() {
+    const std::string path = (std::filesystem::temp_directory_path() / "rsa_check_keyfile.txt").string();
+    RSAPrivateKey key = generateKey(256, 1), loaded;
+    auto plusOne = [](BigUInt<4096> value) {
+        value.add(BigUInt<4096>(1));
+        return value.toDecimal();
+    };
+
+    writeKeyFile(path, key, "", "");
+    expect(loadPrivateKey(path, loaded) && loaded.qInv == key.qInv, "a good key file did not load");
+    // A repeated field used to stand in for a missing one.
+    writeKeyFile(path, key, "qInv", "", "n = " + key.n.toDecimal() + "\n");
+    expect(!loadPrivateKey(path, loaded), "key file with n twice and no qInv loaded");
+    writeKeyFile(path, key, "qInv", "");
+    expect(!loadPrivateKey(path, loaded), "key file without qInv loaded");
+    writeKeyFile(path, key, "dP", plusOne(key.dP));
+    expect(!loadPrivateKey(path, loaded), "key file with a wrong dP loaded");
+    writeKeyFile(path, key, "dQ", plusOne(key.dQ));
+    expect(!loadPrivateKey(path, loaded), "key file with a wrong dQ loaded");
+    writeKeyFile(path, key, "qInv", plusOne(key.qInv));
+    expect(!loadPrivateKey(path, loaded), "key file with a wrong qInv loaded");
+    BigUInt<4096> qInvPlusP = key.qInv;
+    qInvPlusP.add(key.p);
+    writeKeyFile(path, key, "qInv", qInvPlusP.toDecimal());
+    expect(!loadPrivateKey(path, loaded), "key file with an unreduced qInv loaded");
+    writeKeyFile(path, key, "p", "1");
+    expect(!loadPrivateKey(path, loaded), "key file with p = 1 loaded");
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+static int runCLI(std::vector<std::string> args) {
+    std::vector<char*> argv;
+    for (std::string& arg : args) argv.push_back(&arg[0]);
+    return runDecryptCLI(static_cast<int>(argv.size()), argv.data());
+}
+
+// A bad token early in a big file fails its batch while later batches are
+// still queued on the pool; the stream has to wait for them before the
+// decryptor they use goes away.
+static void checkCLIRejectsBadToken() {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path();
+    const std::string cipherPath = (dir / "rsa_check_cipher.txt").string();
+    const std::string keyPath = (dir / "rsa_check_key.txt").string();
+    const std::string outPath = (dir / "rsa_check_plain.txt").string();
+
+    RSAPuzzle puzzle = generatePuzzle(256, "x", 1);
+    const RSAPrivateKey& key = puzzle.key;
+    std::string message(63000, 'a');
+    for (size_t i = 0; i < message.size(); ++i) message[i] = static_cast<char>('a' + i % 26);
+    std::string ciphertext = encryptRSA(message, key.e, key.n);
+    size_t middle = ciphertext.find(' ', ciphertext.size() / 400);
+    ciphertext.insert(middle + 1, "xyz ");
+    std::ofstream(cipherPath) << ciphertext;
+    if (!savePrivateKey(keyPath, key)) {
+        expect(false, "could not write " + keyPath);
+        return;
+    }
+
+    const std::string d = key.d.toDecimal(), n = key.n.toDecimal(), e = key.e.toDecimal();
+    expect(runCLI({"rsa_check", "--decrypt", cipherPath, "--key", keyPath, "--out", outPath}) == 1,
+           "CLI with a key file accepted a bad token");
+    expect(runCLI({"rsa_check", "--decrypt", cipherPath, "--d", d, "--n", n, "--e", e, "--out", outPath}) == 1,
+           "CLI with d, n and e accepted a bad token");
+    expect(runCLI({"rsa_check", "--decrypt", cipherPath, "--d", d, "--n", n, "--out", outPath}) == 1,
+           "CLI with d and n accepted a bad token");
+
+    std::error_code ec;
+    fs::remove(cipherPath, ec);
+    fs::remove(keyPath, ec);
+    fs::remove(outPath, ec);
+}
+
+int main() {
+    // Both sides of each CRTDecryptor and PlainDecryptor width boundary.
+    const size_t widths[] = {32, 63, 64, 65, 127, 128, 129, 255, 256, 257, 511, 512, 513, 1023, 1024, 1025, 1500};
+    for (size_t bits : widths) {
+        // Large keys are slow to generate; one each is enough there.
+        for (uint64_t seed = 1; seed <= (bits > 600 ? 1 : 3); ++seed) checkCRTMatchesPlain(bits, seed);
+    }
+    checkToyKey();
+    checkKeyFiles();
+    checkCLIRejectsBadToken();
+
+    if (failures) {
+        std::cout << failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "All RSA checks passed\n";
+    return 0;
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+typedef unsigned __int128 u128;
+
+// Fixed-width unsigned integer stored as little-endian 64-bit limbs.
+// Everything lives inline, so values can sit on the stack with no heap use.
+template <size_t Bits>
+struct BigUInt {
+    static_assert(Bits % 64 == 0, "BigUInt width must be a multiple of 64 bits");
+    static const size_t LIMBS = Bits / 64;
+
+    uint64_t limb[LIMBS];
+
+    BigUInt() : limb{} {}
+    explicit BigUInt(uint64_t value) : limb{} { limb[0] = value; }
+
+    bool isZero() const {
+        for (size_t i = 0; i < LIMBS; ++i)
+            if (limb[i]) return false;
+        return true;
+    }
+
+    bool isOdd() const { return limb[0] & 1; }
+
+    bool bit(size_t i) const { return (limb[i / 64] >> (i % 64)) & 1; }
+
+    size_t bitLength() const {
+        for (size_t i = LIMBS; i-- > 0;)
+            if (limb[i]) return i * 64 + 64 - __builtin_clzll(limb[i]);
+        return 0;
+    }
+
+    int compare(const BigUInt& other) const {
+        for (size_t i = LIMBS; i-- > 0;) {
+            if (limb[i] != other.limb[i]) return limb[i] < other.limb[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    bool operator==(const BigUInt& other) const { return compare(other) == 0; }
+    bool operator!=(const BigUInt& other) const { return compare(other) != 0; }
+    bool operator<(const BigUInt& other) const { return compare(other) < 0; }
+
+    // this += other, returns the carry out of the top limb.
+    uint64_t add(const BigUInt& other) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            u128 sum = (u128)limb[i] + other.limb[i] + carry;
+            limb[i] = (uint64_t)sum;
+            carry = (uint64_t)(sum >> 64);
+        }
+        return carry;
+    }
+
+    // this -= other, returns the borrow out of the top limb.
+    uint64_t sub(const BigUInt& other) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            u128 diff = (u128)limb[i] - other.limb[i] - borrow;
+            limb[i] = (uint64_t)diff;
+            borrow = (uint64_t)(diff >> 64) & 1;
+        }
+        return borrow;
+    }
+
+    // this <<= 1, returns the bit shifted out.
+    uint64_t shiftLeft1() {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            uint64_t next = limb[i] >> 63;
+            limb[i] = (limb[i] << 1) | carry;
+            carry = next;
+        }
+        return carry;
+    }
+
+    void shiftRight1() {
+        for (size_t i = 0; i < LIMBS; ++i) {
+            limb[i] = (limb[i] >> 1) | (i + 1 < LIMBS ? limb[i + 1] << 63 : 0);
+        }
+    }
+
+    // this = this * factor + addend, returns the limb that overflowed.
+    uint64_t mulSmallAdd(uint64_t factor, uint64_t addend) {
+        uint64_t carry = addend;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            u128 product = (u128)limb[i] * factor + carry;
+            limb[i] = (uint64_t)product;
+            carry = (uint64_t)(product >> 64);
+        }
+        return carry;
+    }
+
+    // this /= divisor, returns the remainder.
+    uint64_t divSmall(uint64_t divisor) {
+        u128 rem = 0;
+        for (size_t i = LIMBS; i-- > 0;) {
+            u128 cur = (rem << 64) | limb[i];
+            limb[i] = (uint64_t)(cur / divisor);
+            rem = cur % divisor;
+        }
+        return (uint64_t)rem;
+    }
+
+    // Copies into a different width, truncating or zero-extending.
+    template <size_t Other>
+    BigUInt<Other> resize() const {
+        BigUInt<Other> out;
+        for (size_t i = 0; i < LIMBS && i < BigUInt<Other>::LIMBS; ++i) out.limb[i] = limb[i];
+        return out;
+    }
+
+    // std::from_chars-style parse of the leading decimal digits in
+    // [first, last). Never allocates.
+    static std::from_chars_result fromChars(const char* first, const char* last, BigUInt& out) {
+        out = BigUInt();
+        const char* p = first;
+        while (p != last) {
+            // Feed up to 19 digits at a time so most work is one multiply per chunk.
+            uint64_t chunk = 0, scale = 1;
+            int digits = 0;
+            for (; digits < 19 && p != last && *p >= '0' && *p <= '9'; ++digits, ++p) {
+                chunk = chunk * 10 + (*p - '0');
+                scale *= 10;
+            }
+            if (digits == 0) break;
+            if (out.mulSmallAdd(scale, chunk) != 0) {
+                while (p != last && *p >= '0' && *p <= '9') ++p;
+                return {p, std::errc::result_out_of_range};
+            }
+            if (digits < 19) break;
+        }
+        if (p == first) return {first, std::errc::invalid_argument};
+        return {p, std::errc()};
+    }
+
+    // Parses [first, last) as a whole. Returns false on a non-digit or if the
+    // value does not fit in Bits.
+    static bool fromDecimal(const char* first, const char* last, BigUInt& out) {
+        std::from_chars_result parsed = fromChars(first, last, out);
+        return parsed.ec == std::errc() && parsed.ptr == last;
+    }
+
+    static BigUInt fromDecimal(const std::string& text) {
+        BigUInt out;
+        if (!fromDecimal(text.data(), text.data() + text.size(), out))
+            throw std::invalid_argument("not a " + std::to_string(Bits) + "-bit decimal number: " + text);
+        return out;
+    }
+
+    std::string toDecimal() const {
+        const uint64_t CHUNK = 10000000000000000000ULL; // 10^19
+        BigUInt value = *this;
+        std::string digits;
+        do {
+            uint64_t part = value.divSmall(CHUNK);
+            for (int k = 0; k < 19; ++k) {
+                digits += char('0' + part % 10);
+                part /= 10;
+                if (value.isZero() && part == 0) break;
+            }
+        } while (!value.isZero());
+        return std::string(digits.rbegin(), digits.rend());
+    }
+};
+
+// Full product of two equal-width values.
+template <size_t Bits>
+BigUInt<2 * Bits> mulFull(const BigUInt<Bits>& a, const BigUInt<Bits>& b) {
+    const size_t S = BigUInt<Bits>::LIMBS;
+    BigUInt<2 * Bits> out;
+    for (size_t i = 0; i < S; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < S; ++j) {
+            u128 cur = (u128)a.limb[j] * b.limb[i] + out.limb[i + j] + carry;
+            out.limb[i + j] = (uint64_t)cur;
+            carry = (uint64_t)(cur >> 64);
+        }
+        out.limb[i + S] = carry;
+    }
+    return out;
+}
+
+// Montgomery arithmetic modulo an odd n with R = 2^Bits. Values handed to
+// mul() and pow() are in Montgomery form (a * R mod n); use toMont/fromMont
+// at the edges.
+template <size_t Bits>
+class Montgomery {
+public:
+    typedef BigUInt<Bits> Int;
+
+    explicit Montgomery(const Int& modulus) : n(modulus) {
+        if (!n.isOdd()) throw std::invalid_argument("Montgomery modulus must be odd");
+
+        // Newton iteration for n^-1 mod 2^64; each step doubles the correct bits.
+        uint64_t inv = n.limb[0];
+        for (int i = 0; i < 5; ++i) inv *= 2 - n.limb[0] * inv;
+        nInv = 0 - inv;
+
+        // R mod n and R^2 mod n by repeated doubling.
+        Int x(1);
+        for (size_t i = 0; i < 2 * Bits; ++i) {
+            uint64_t carry = x.shiftLeft1();
+            if (carry || !(x < n)) x.sub(n);
+            if (i + 1 == Bits) one = x;
+        }
+        r2 = x;
+    }
+
+    const Int& modulus() const { return n; }
+
+    // Montgomery form of 1.
+    const Int& unity() const { return one; }
+
+    // Accepts any a < 2^Bits, not only a < n.
+    Int toMont(const Int& a) const { return mul(a, r2); }
+
+    Int fromMont(const Int& a) const { return mul(a, Int(1)); }
+
+    // Montgomery form of x mod n for a double-width x: hi * R^2 + lo * R.
+    Int toMontWide(const BigUInt<2 * Bits>& x) const {
+        Int lo, hi;
+        for (size_t i = 0; i < Int::LIMBS; ++i) {
+            lo.limb[i] = x.limb[i];
+            hi.limb[i] = x.limb[i + Int::LIMBS];
+        }
+        return addMod(toMont(lo), mul(toMont(hi), r2));
+    }
+
+    // Modular add/subtract of values already below n.
+    Int addMod(const Int& a, const Int& b) const {
+        Int r = a;
+        if (r.add(b) || !(r < n)) r.sub(n);
+        return r;
+    }
+
+    Int subMod(const Int& a, const Int& b) const {
+        Int r = a;
+        if (r.sub(b)) r.add(n);
+        return r;
+    }
+
+    // a * b * R^-1 mod n (CIOS). Requires b < n; a may be any Bits-wide value.
+    Int mul(const Int& a, const Int& b) const {
+        const size_t S = Int::LIMBS;
+        uint64_t t[S + 2] = {};
+        for (size_t i = 0; i < S; ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < S; ++j) {
+                u128 cur = (u128)a.limb[j] * b.limb[i] + t[j] + carry;
+                t[j] = (uint64_t)cur;
+                carry = (uint64_t)(cur >> 64);
+            }
+            u128 top = (u128)t[S] + carry;
+            t[S] = (uint64_t)top;
+            t[S + 1] = (uint64_t)(top >> 64);
+
+            uint64_t m = t[0] * nInv;
+            u128 cur = (u128)m * n.limb[0] + t[0];
+            carry = (uint64_t)(cur >> 64);
+            for (size_t j = 1; j < S; ++j) {
+                cur = (u128)m * n.limb[j] + t[j] + carry;
+                t[j - 1] = (uint64_t)cur;
+                carry = (uint64_t)(cur >> 64);
+            }
+            top = (u128)t[S] + carry;
+            t[S - 1] = (uint64_t)top;
+            t[S] = t[S + 1] + (uint64_t)(top >> 64);
+        }
+
+        Int result;
+        for (size_t i = 0; i < S; ++i) result.limb[i] = t[i];
+        if (t[S] || !(result < n)) result.sub(n);
+        return result;
+    }
+
+    // base^exp in Montgomery form, left-to-right sliding window over odd powers.
+    Int pow(const Int& base, const Int& exp) const {
+        size_t bits = exp.bitLength();
+        if (bits == 0) return one;
+
+        const size_t window = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+        Int table[1 << 5];  // base^1, base^3, ..., base^(2^window - 1)
+        table[0] = base;
+        if (window > 1) {
+            Int square = mul(base, base);
+            for (size_t i = 1; i < (size_t(1) << (window - 1)); ++i) table[i] = mul(table[i - 1], square);
+        }
+
+        Int result = one;
+        bool started = false;
+        size_t i = bits;
+        while (i > 0) {
+            if (!exp.bit(i - 1)) {
+                if (started) result = mul(result, result);
+                --i;
+                continue;
+            }
+            // Longest window ending in a set bit: bits [low, i).
+            size_t low = i > window ? i - window : 0;
+            while (!exp.bit(low)) ++low;
+            size_t value = 0;
+            for (size_t b = i; b-- > low;) value = (value << 1) | exp.bit(b);
+
+            if (started) {
+                for (size_t s = low; s < i; ++s) result = mul(result, result);
+                result = mul(result, table[value >> 1]);
+            } else {
+                result = table[value >> 1];
+                started = true;
+            }
+            i = low;
+        }
+        return result;
+    }
+
+    // base^exp mod n for plain (non-Montgomery) operands.
+    Int modExp(const Int& base, const Int& exp) const {
+        return fromMont(pow(toMont(base), exp));
+    }
+
+private:
+    Int n;
+    Int one;
+    Int r2;
+    uint64_t nInv;
+};
@@ -0,0 +1,257 @@
+#include "rsa_cli.h"
+#include "rsa_core.h"
+#include "rsa_factor.h"
+#include "rsa_keygen.h"
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <random>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Tokens per pipeline batch, and how many batches may be in flight per
+// worker. Together these bound the memory used by the streaming decryptor.
+const size_t STREAM_BATCH_TOKENS = 1024;
+const size_t STREAM_BATCHES_PER_WORKER = 4;
+
+struct StreamBatch {
+    std::vector<TokenSpan> tokens;
+    std::string plain;
+    std::promise<void> decrypted;
+};
+
+typedef std::deque<std::pair<std::shared_ptr<StreamBatch>, std::future<void>>> StreamQueue;
+
+// Pool tasks use the caller's decryptor, so decryptStream() must not unwind
+// past batches that are still queued or running when one of them fails.
+struct StreamDrain {
+    StreamQueue& inFlight;
+    ~StreamDrain() {
+        for (auto& pending : inFlight) {
+            if (pending.second.valid()) pending.second.wait();
+        }
+    }
+};
+
+// Parse -> decrypt -> write pipeline over an in-memory (usually mmapped)
+// buffer. This thread scans tokens and writes finished batches in order
+// while the pool decrypts the batches in between. Returns the token count.
+template <typename Decryptor>
+size_t decryptStream(const char* data, size_t size, const Decryptor& decrypt, std::FILE* out, WorkPool& pool) {
+    const size_t maxInFlight = STREAM_BATCHES_PER_WORKER * (pool.size() + 1);
+    StreamQueue inFlight;
+    StreamDrain drain{inFlight};
+    size_t total = 0;
+
+    auto writeOldest = [&] {
+        inFlight.front().second.get();  // rethrows a decryption error
+        const std::string& plain = inFlight.front().first->plain;
+        if (std::fwrite(plain.data(), 1, plain.size(), out) != plain.size())
+            throw std::runtime_error("write failed");
+        inFlight.pop_front();
+    };
+
+    const char* pos = data;
+    const char* end = data + size;
+    TokenSpan token;
+    bool more = true;
+    while (more) {
+        auto batch = std::make_shared<StreamBatch>();
+        batch->tokens.reserve(STREAM_BATCH_TOKENS);
+        while (batch->tokens.size() < STREAM_BATCH_TOKENS && (more = nextToken(pos, end, token)))
+            batch->tokens.push_back(token);
+        if (batch->tokens.empty()) break;
+        total += batch->tokens.size();
+
+        if (inFlight.size() == maxInFlight) writeOldest();
+        std::future<void> ready = batch->decrypted.get_future();
+        pool.submit([batch, &decrypt] {
+            try {
+                batch->plain.resize(batch->tokens.size());
+                for (size_t i = 0; i < batch->tokens.size(); ++i) batch->plain[i] = decrypt(batch->tokens[i]);
+                batch->decrypted.set_value();
+            } catch (...) {
+                batch->decrypted.set_exception(std::current_exception());
+            }
+        });
+        inFlight.emplace_back(std::move(batch), std::move(ready));
+    }
+    while (!inFlight.empty()) writeOldest();
+    return total;
+}
+
+// Read-only memory map of a whole file.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage:\n"
+              << "  " << program << "                     start the RSA room GUI\n"
+              << "  " << program << " --decrypt <cipher> --key <keyfile> [--out <file>]\n"
+              << "  " << program << " --decrypt <cipher> --d <d> --n <n> [--e <e>] [--out <file>]\n"
+              << "  " << program << " --generate <bits> --key <keyfile> [--message <text>] [--seed <n>] [--out <cluefile>]\n"
+              << "  " << program << " --crack <n> --e <e> [--key <keyfile>]\n"
+              << "Plaintext goes to stdout unless --out is given; throughput is reported on stderr.\n"
+              << "When e is known (from the key file or --e) tokens are decrypted by table lookup.\n"
+              << "--generate writes a fresh private key to <keyfile> and the clue (n, e, ciphertext)\n"
+              << "to stdout or --out; copy the key file to rsa_puzzle_key.txt to use it in the room.\n"
+              << "--crack factors n (up to " << FACTOR_MAX_BITS << " bits) and prints or saves the private key.\n";
+}
+
+// --generate: new key and encrypted clue, e.g. one per group of players.
+int generatePuzzleFiles(std::map<std::string, std::string>& options, const char* program) {
+    if (!options.count("key")) {
+        printUsage(program);
+        return 1;
+    }
+    RSAPuzzle puzzle;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        size_t bits = std::stoul(options["generate"]);
+        uint64_t seed = options.count("seed") ? std::stoull(options["seed"]) : std::random_device()();
+        puzzle = generatePuzzle(bits, options["message"], seed);
+    } catch (const std::exception& e) {
+        std::cerr << "Key generation failed: " << e.what() << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!savePrivateKey(options["key"], puzzle.key)) return 1;
+    if (options.count("out")) {
+        if (!savePuzzleClue(options["out"], puzzle)) return 1;
+    } else {
+        writePuzzleClue(std::cout, puzzle);
+    }
+    std::cerr << "Generated a " << puzzle.key.n.bitLength() << "-bit key in " << seconds << " s" << std::endl;
+    return 0;
+}
+
+// --crack: recover the private key of a small public key by factoring n.
+int crackKeyFromOptions(std::map<std::string, std::string>& options, const char* program) {
+    if (!options.count("e")) {
+        printUsage(program);
+        return 1;
+    }
+    RSAPrivateKey key;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        BigUInt<4096> n = BigUInt<4096>::fromDecimal(options["crack"]);
+        BigUInt<4096> e = BigUInt<4096>::fromDecimal(options["e"]);
+        if (!crackKey(n, e, key)) {
+            std::cerr << "Could not crack n: it must be a product of two primes, at most "
+                      << FACTOR_MAX_BITS << " bits, with e invertible" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Cracking failed: " << e.what() << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.count("key")) {
+        if (!savePrivateKey(options["key"], key)) return 1;
+    } else {
+        writePrivateKey(std::cout, key);
+    }
+    std::cerr << "Factored a " << key.n.bitLength() << "-bit n in " << seconds << " s" << std::endl;
+    return 0;
+}
+
+int runDecryptCLI(int argc, char* argv[]) {
+    std::map<std::string, std::string> options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag.rfind("--", 0) != 0 || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        options[flag.substr(2)] = argv[++i];
+    }
+    if (options.count("generate")) return generatePuzzleFiles(options, argv[0]);
+    if (options.count("crack")) return crackKeyFromOptions(options, argv[0]);
+    if (!options.count("decrypt") || (!options.count("key") && !(options.count("d") && options.count("n")))) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    RSAPrivateKey key;
+    bool useCRT = options.count("key") > 0;
+    if (useCRT && !loadPrivateKey(options["key"], key)) return 1;
+
+    MappedFile input;
+    if (!input.open(options["decrypt"])) {
+        std::cerr << "Failed to map " << options["decrypt"] << std::endl;
+        return 1;
+    }
+    std::FILE* out = stdout;
+    if (options.count("out")) {
+        out = std::fopen(options["out"].c_str(), "wb");
+        if (!out) {
+            std::cerr << "Failed to open " << options["out"] << " for writing" << std::endl;
+            return 1;
+        }
+    }
+
+    size_t tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        auto run = [&](const auto& decrypt) {
+            return decryptStream(input.data, input.size, decrypt, out, sharedWorkPool());
+        };
+        // With e known, decrypt by byte-table lookup and keep the private
+        // key only for tokens that miss the table.
+        if (useCRT) {
+            tokens = withCRTDecryptor(key, [&](const auto& crt) { return run(tableDecryptor(key.e, crt, true)); });
+        } else if (options.count("e")) {
+            BigUInt<4096> e = BigUInt<4096>::fromDecimal(options["e"]);
+            tokens = withPlainDecryptor(options["d"], options["n"], [&](const auto& plain) {
+                return run(tableDecryptor(e, plain, true));
+            });
+        } else {
+            tokens = withPlainDecryptor(options["d"], options["n"], run);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Decryption failed: " << e.what() << std::endl;
+        if (out != stdout) std::fclose(out);
+        return 1;
+    }
+    if (out != stdout) std::fclose(out);
+    else std::fflush(out);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Decrypted " << tokens << " tokens in " << seconds << " s ("
+              << (seconds > 0 ? tokens / seconds : 0.0) << " tokens/s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Headless bulk decryption:
+//   --decrypt <cipher> --key <keyfile> [--out <file>]
+//   --decrypt <cipher> --d <d> --n <n> [--e <e>] [--out <file>]
+int runDecryptCLI(int argc, char* argv[]);
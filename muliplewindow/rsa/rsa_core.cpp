@@ -0,0 +1,128 @@
+#include "rsa_core.h"
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+long long mod_exp(long long base, long long exp, long long mod) {
+    long long result = 1;
+    base %= mod;
+    while (exp > 0) {
+        if (exp % 2 == 1)
+            result = (long long)((u128)result * base % mod);
+        exp >>= 1;
+        base = (long long)((u128)base * base % mod);
+    }
+    return result;
+}
+
+std::string decryptRSA(const std::string& encryptedStr, long long d, long long n) {
+    const char* pos = encryptedStr.data();
+    const char* end = pos + encryptedStr.size();
+    TokenSpan token;
+    std::string result;
+    while (nextToken(pos, end, token)) {
+        long long cipher = 0;
+        std::from_chars_result parsed = std::from_chars(token.first, token.last, cipher);
+        if (parsed.ec != std::errc() || parsed.ptr != token.last)
+            throw std::invalid_argument("bad ciphertext token: " + std::string(token.first, token.last));
+        long long plain = mod_exp(cipher, d, n);
+        if (plain < 0 || plain > 255)
+            throw NotAByte("ciphertext token does not decrypt to a byte: " + std::string(token.first, token.last));
+        result += static_cast<char>(plain);
+    }
+    return result;
+}
+
+std::string decryptRSA(const std::string& encryptedStr, const std::string& d, const std::string& n) {
+    return withPlainDecryptor(d, n, [&](const auto& decrypt) { return decryptTokens(encryptedStr, decrypt); });
+}
+
+std::string decryptRSABatch(std::string_view encrypted, const std::string& d, const std::string& n) {
+    return withPlainDecryptor(d, n, [&](const auto& decrypt) {
+        return decryptTokensParallel(encrypted, decrypt, sharedWorkPool());
+    });
+}
+
+std::string decryptRSATable(const std::string& encryptedStr, const std::string& e, const std::string& d, const std::string& n) {
+    BigUInt<4096> bigE = BigUInt<4096>::fromDecimal(e);
+    return withPlainDecryptor(d.empty() ? "1" : d, n, [&](const auto& plain) {
+        return decryptTokens(encryptedStr, tableDecryptor(bigE, plain, !d.empty()));
+    });
+}
+
+// value mod m for m > 0, one bit of value at a time: keys are loaded
+// rarely, so there is no need for a real long division.
+static BigUInt<4096> modulo(const BigUInt<4096>& value, const BigUInt<4096>& m) {
+    BigUInt<4096> rest;
+    for (size_t i = value.bitLength(); i-- > 0;) {
+        uint64_t carry = rest.shiftLeft1();
+        rest.limb[0] |= value.bit(i);
+        if (carry || !(rest < m)) rest.sub(m);
+    }
+    return rest;
+}
+
+bool loadPrivateKey(const std::string& path, RSAPrivateKey& key) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open key file " << path << std::endl;
+        return false;
+    }
+    std::map<std::string, BigUInt<4096>*> fields = {
+        {"n", &key.n}, {"e", &key.e}, {"d", &key.d}, {"p", &key.p}, {"q", &key.q},
+        {"dP", &key.dP}, {"dQ", &key.dQ}, {"qInv", &key.qInv}
+    };
+    std::string line;
+    std::set<std::string> seen;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string name, eq, value;
+        if (!(ss >> name) || name[0] == '#') continue;
+        if (!(ss >> eq >> value) || eq != "=") {
+            std::cerr << "Malformed line in key file " << path << ": " << line << std::endl;
+            return false;
+        }
+        auto field = fields.find(name);
+        if (field == fields.end()) continue;
+        if (!seen.insert(name).second) {
+            std::cerr << "Key file " << path << " sets " << name << " twice" << std::endl;
+            return false;
+        }
+        if (!BigUInt<4096>::fromDecimal(value.data(), value.data() + value.size(), *field->second)) {
+            std::cerr << "Bad value for " << name << " in key file " << path << std::endl;
+            return false;
+        }
+    }
+    for (const auto& field : fields) {
+        if (seen.count(field.first)) continue;
+        std::cerr << "Key file " << path << " is missing " << field.first << std::endl;
+        return false;
+    }
+    const BigUInt<4096> one(1);
+    if (!(one < key.p) || !(one < key.q) || key.p.bitLength() > 2048 || key.q.bitLength() > 2048 ||
+        mulFull(key.p.resize<2048>(), key.q.resize<2048>()) != key.n) {
+        std::cerr << "Key file " << path << ": p * q does not match n" << std::endl;
+        return false;
+    }
+    // The CRT path trusts these, so a wrong one would decrypt to garbage.
+    BigUInt<4096> pMinus1 = key.p, qMinus1 = key.q;
+    pMinus1.sub(one);
+    qMinus1.sub(one);
+    if (key.dP != modulo(key.d, pMinus1) || key.dQ != modulo(key.d, qMinus1) || !(key.qInv < key.p) ||
+        modulo(mulFull(key.qInv.resize<2048>(), key.q.resize<2048>()), key.p) != one) {
+        std::cerr << "Key file " << path << ": dP, dQ or qInv does not match d, p and q" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string decryptRSACRT(const std::string& encryptedStr, const RSAPrivateKey& key) {
+    return withCRTDecryptor(key, [&](const auto& decrypt) { return decryptTokens(encryptedStr, decrypt); });
+}
+
+std::string decryptRSACRTBatch(std::string_view encrypted, const RSAPrivateKey& key) {
+    return withCRTDecryptor(key, [&](const auto& decrypt) {
+        return decryptTokensParallel(encrypted, decrypt, sharedWorkPool());
+    });
+}
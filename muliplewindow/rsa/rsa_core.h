@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "bigint.h"
+#include "work_pool.h"
+
+// RSA decryption core shared by the GUI, the command-line mode and the
+// benchmark. Nothing in here touches SDL.
+
+// Modular exponentiation for keys that fit in a machine word. Products are
+// taken in 128 bits so this stays exact for any mod below 2^63.
+long long mod_exp(long long base, long long exp, long long mod);
+
+// A whitespace-separated ciphertext token, borrowed from the input buffer.
+struct TokenSpan {
+    const char* first;
+    const char* last;
+};
+
+// Advances pos past the next token. Never allocates.
+inline bool nextToken(const char*& pos, const char* end, TokenSpan& token) {
+    while (pos != end && std::isspace(static_cast<unsigned char>(*pos))) ++pos;
+    if (pos == end) return false;
+    token.first = pos;
+    while (pos != end && !std::isspace(static_cast<unsigned char>(*pos))) ++pos;
+    token.last = pos;
+    return true;
+}
+
+inline size_t countTokens(std::string_view text) {
+    const char* pos = text.data();
+    const char* end = pos + text.size();
+    TokenSpan token;
+    size_t count = 0;
+    while (nextToken(pos, end, token)) ++count;
+    return count;
+}
+
+template <typename Int>
+Int parseToken(const TokenSpan& token) {
+    Int value;
+    if (!Int::fromDecimal(token.first, token.last, value))
+        throw std::invalid_argument("bad ciphertext token: " + std::string(token.first, token.last));
+    return value;
+}
+
+// A token that decrypts to 256 or more: plaintext is one byte per token, so
+// the key is wrong or the ciphertext was made for another one.
+struct NotAByte : std::invalid_argument {
+    using std::invalid_argument::invalid_argument;
+};
+
+template <typename Int>
+char plainByte(const Int& m, const TokenSpan& token) {
+    if (!(m < Int(256)))
+        throw NotAByte("ciphertext token does not decrypt to a byte: " + std::string(token.first, token.last));
+    return static_cast<char>(m.limb[0]);
+}
+
+// Word-size decryption for toy keys such as n = 2537.
+std::string decryptRSA(const std::string& encryptedStr, long long d, long long n);
+
+// Decrypts one token with d mod n. Read-only after construction, so one
+// instance can be shared by every worker thread.
+template <size_t Bits>
+struct PlainDecryptor {
+    typedef BigUInt<Bits> Int;
+    typedef Int Cipher;
+    Montgomery<Bits> mont;
+    Int exp;
+
+    PlainDecryptor(const BigUInt<4096>& d, const BigUInt<4096>& n)
+        : mont(n.resize<Bits>()), exp(d.resize<Bits>()) {}
+
+    // The whole of c^d mod n, byte or not.
+    Int value(const TokenSpan& token) const {
+        Int cipher = parseToken<Int>(token);
+        if (!(cipher < mont.modulus()))
+            throw std::invalid_argument("ciphertext token not below n: " + std::string(token.first, token.last));
+        return mont.modExp(cipher, exp);
+    }
+
+    char operator()(const TokenSpan& token) const { return plainByte(value(token), token); }
+
+    const Int& modulus() const { return mont.modulus(); }
+};
+
+template <typename Decryptor>
+std::string decryptTokens(std::string_view encrypted, const Decryptor& decrypt) {
+    const char* pos = encrypted.data();
+    const char* end = pos + encrypted.size();
+    TokenSpan token;
+    std::string result;
+    while (nextToken(pos, end, token)) result += decrypt(token);
+    return result;
+}
+
+// Splits the token stream into chunks and decrypts them on the pool. Each
+// chunk writes its own slice of the output, so order is preserved.
+template <typename Decryptor>
+std::string decryptTokensParallel(std::string_view encrypted, const Decryptor& decrypt, WorkPool& pool) {
+    std::vector<TokenSpan> tokens;
+    tokens.reserve(encrypted.size() / 8);
+    const char* pos = encrypted.data();
+    const char* end = pos + encrypted.size();
+    TokenSpan token;
+    while (nextToken(pos, end, token)) tokens.push_back(token);
+
+    std::string result(tokens.size(), '\0');
+    // Several chunks per thread so stealing can even out uneven chunks.
+    size_t grain = std::max<size_t>(1, tokens.size() / (8 * (pool.size() + 1)));
+    pool.parallelFor(tokens.size(), grain, [&](size_t begin, size_t stop) {
+        for (size_t i = begin; i < stop; ++i) result[i] = decrypt(tokens[i]);
+    });
+    return result;
+}
+
+// Calls fn with the narrowest of the 512/1024/2048/4096-bit decryptors that
+// holds the key.
+template <typename Fn>
+auto withPlainDecryptor(const std::string& d, const std::string& n, Fn fn) {
+    BigUInt<4096> bigN = BigUInt<4096>::fromDecimal(n);
+    BigUInt<4096> bigD = BigUInt<4096>::fromDecimal(d);
+    size_t bits = std::max(bigN.bitLength(), bigD.bitLength());
+    if (bits <= 512) return fn(PlainDecryptor<512>(bigD, bigN));
+    if (bits <= 1024) return fn(PlainDecryptor<1024>(bigD, bigN));
+    if (bits <= 2048) return fn(PlainDecryptor<2048>(bigD, bigN));
+    return fn(PlainDecryptor<4096>(bigD, bigN));
+}
+
+// Decryption for real-sized keys given as decimal strings.
+std::string decryptRSA(const std::string& encryptedStr, const std::string& d, const std::string& n);
+
+// Same result as decryptRSA(), spread across every core.
+std::string decryptRSABatch(std::string_view encrypted, const std::string& d, const std::string& n);
+
+// Ciphertext of every byte value under one public key, in a small
+// open-addressed hash keyed by the low limb of the ciphertext.
+template <typename Int>
+struct ByteTable {
+    static constexpr size_t SLOTS = 512;
+    static constexpr uint16_t EMPTY = 0xFFFF;
+    Int cipher[256];
+    uint16_t slot[SLOTS];
+
+    static size_t home(const Int& c) { return (c.limb[0] * 0x9E3779B97F4A7C15ULL) >> 55; }
+
+    ByteTable(const Int& e, const Int& n) {
+        std::fill(slot, slot + SLOTS, EMPTY);
+        Montgomery<Int::LIMBS * 64> mont(n);
+        for (uint64_t m = 0; m < 256 && Int(m) < n; ++m) {
+            cipher[m] = mont.modExp(Int(m), e);
+            size_t s = home(cipher[m]);
+            while (slot[s] != EMPTY) s = (s + 1) % SLOTS;
+            slot[s] = static_cast<uint16_t>(m);
+        }
+    }
+
+    bool lookup(const Int& c, char& plain) const {
+        for (size_t s = home(c); slot[s] != EMPTY; s = (s + 1) % SLOTS) {
+            if (cipher[slot[s]] == c) {
+                plain = static_cast<char>(slot[s]);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// The most recently used tables are kept per (e, n); each width has its own
+// cache, and a full cache drops its least recently used table.
+const size_t BYTE_TABLE_CACHE_LIMIT = 16;
+
+template <typename Int>
+std::shared_ptr<const ByteTable<Int>> byteTableFor(const Int& e, const Int& n) {
+    struct Cached {
+        std::shared_ptr<const ByteTable<Int>> table;
+        uint64_t lastUse;
+    };
+    static std::mutex lock;
+    static std::map<std::pair<Int, Int>, Cached> cache;
+    static uint64_t uses = 0;
+    std::lock_guard<std::mutex> guard(lock);
+    auto key = std::make_pair(e, n);
+    auto found = cache.find(key);
+    if (found != cache.end()) {
+        found->second.lastUse = ++uses;
+        return found->second.table;
+    }
+    if (cache.size() >= BYTE_TABLE_CACHE_LIMIT) {
+        cache.erase(std::min_element(cache.begin(), cache.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUse < b.second.lastUse;
+        }));
+    }
+    auto table = std::make_shared<const ByteTable<Int>>(e, n);
+    cache[key] = {table, ++uses};
+    return table;
+}
+
+// Plaintext here is one byte per token, so a key has at most 256 distinct
+// ciphertexts. Decrypting is a table lookup; tokens outside the table go to
+// the fallback decryptor (or are rejected when there is none).
+template <typename Int, typename Fallback>
+struct TableDecryptor {
+    std::shared_ptr<const ByteTable<Int>> table;
+    const Fallback* fallback;
+
+    char operator()(const TokenSpan& token) const {
+        char plain;
+        if (table->lookup(parseToken<Int>(token), plain)) return plain;
+        if (!fallback)
+            throw NotAByte("ciphertext is not a byte under this key: " + std::string(token.first, token.last));
+        return (*fallback)(token);
+    }
+};
+
+// Byte-table decryptor for (e, keyed.modulus()). Misses go to keyed when
+// fallback is set and are rejected otherwise.
+template <typename Keyed>
+TableDecryptor<typename Keyed::Cipher, Keyed> tableDecryptor(const BigUInt<4096>& e, const Keyed& keyed, bool fallback) {
+    typedef typename Keyed::Cipher Int;
+    return {byteTableFor(e.resize<Int::LIMBS * 64>(), keyed.modulus()), fallback ? &keyed : nullptr};
+}
+
+// Decrypts via the per-key byte table for (e, n), falling back to d for
+// tokens that do not decrypt to a byte. d may be empty to disable the fallback.
+std::string decryptRSATable(const std::string& encryptedStr, const std::string& e, const std::string& d, const std::string& n);
+
+// Private key with CRT parameters: dP = d mod (p-1), dQ = d mod (q-1),
+// qInv = q^-1 mod p.
+struct RSAPrivateKey {
+    BigUInt<4096> n, e, d, p, q, dP, dQ, qInv;
+};
+
+// Reads a key file of "name = value" lines (decimal values, '#' comments)
+// with the fields n, e, d, p, q, dP, dQ and qInv, each exactly once. Fails
+// unless p * q = n and dP, dQ and qInv are the ones d, p and q give.
+bool loadPrivateKey(const std::string& path, RSAPrivateKey& key);
+
+// CRT decryption: two Half-bit exponentiations mod p and q, then Garner's
+// recombination m = m2 + q * (qInv * (m1 - m2) mod p).
+template <size_t Half>
+struct CRTDecryptor {
+    typedef BigUInt<Half> Int;
+    typedef BigUInt<2 * Half> Wide;
+    typedef Wide Cipher;
+    Montgomery<Half> monP, monQ;
+    Int dP, dQ, qInv, q;
+    Wide n;
+
+    explicit CRTDecryptor(const RSAPrivateKey& key)
+        : monP(key.p.resize<Half>()), monQ(key.q.resize<Half>()),
+          dP(key.dP.resize<Half>()), dQ(key.dQ.resize<Half>()), qInv(key.qInv.resize<Half>()),
+          q(key.q.resize<Half>()), n(key.n.resize<2 * Half>()) {}
+
+    Wide value(const TokenSpan& token) const {
+        Wide cipher = parseToken<Wide>(token);
+        if (!(cipher < n))
+            throw std::invalid_argument("ciphertext token not below n: " + std::string(token.first, token.last));
+        Int m1 = monP.pow(monP.toMontWide(cipher), dP);
+        Int m2 = monQ.fromMont(monQ.pow(monQ.toMontWide(cipher), dQ));
+        // Both sides in Montgomery form mod p; multiplying by a plain qInv drops the R.
+        Int h = monP.mul(monP.subMod(m1, monP.toMont(m2)), qInv);
+        Wide m = mulFull(h, q);
+        m.add(m2.template resize<2 * Half>());
+        return m;
+    }
+
+    char operator()(const TokenSpan& token) const { return plainByte(value(token), token); }
+
+    const Wide& modulus() const { return n; }
+};
+
+template <typename Fn>
+auto withCRTDecryptor(const RSAPrivateKey& key, Fn fn) {
+    size_t bits = std::max(key.p.bitLength(), key.q.bitLength());
+    if (bits <= 256) return fn(CRTDecryptor<256>(key));
+    if (bits <= 512) return fn(CRTDecryptor<512>(key));
+    if (bits <= 1024) return fn(CRTDecryptor<1024>(key));
+    return fn(CRTDecryptor<2048>(key));
+}
+
+// Same results as decryptRSA() with the key's d and n, 3-4x faster.
+std::string decryptRSACRT(const std::string& encryptedStr, const RSAPrivateKey& key);
+
+// decryptRSACRT() spread across every core.
+std::string decryptRSACRTBatch(std::string_view encrypted, const RSAPrivateKey& key);
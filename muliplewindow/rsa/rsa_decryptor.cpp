@@ -1,34 +1,32 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include <string>
-#include <sstream>
 #include <cmath>
+#include "background_worker.h"
+#include "hotspot_layer.h"
+#include "rsa_core.h"
+#include "rsa_cli.h"
+#include "rsa_factor.h"
+#include "rsa_keygen.h"
 
-// Modular exponentiation
-long long mod_exp(long long base, long long exp, long long mod) {
-    long long result = 1;
-    base %= mod;
-    while (exp > 0) {
-        if (exp % 2 == 1)
-            result = (result * base) % mod;
-        exp >>= 1;
-        base = (base * base) % mod;
-    }
-    return result;
-}
+// Key file the game master can drop in (see --generate); without it each
+// session gets a fresh key and writes its clue next to the binary.
+const char* PUZZLE_KEY_FILE = "rsa_puzzle_key.txt";
+const char* PUZZLE_CLUE_FILE = "rsa_puzzle_clue.txt";
 
-std::string decryptRSA(const std::string& encryptedStr, long long d, long long n) {
-    std::stringstream ss(encryptedStr);
-    std::string token, result;
-    while (ss >> token) {
-        long long cipher = std::stoll(token);
-        char decryptedChar = static_cast<char>(mod_exp(cipher, d, n));
-        result += decryptedChar;
-    }
-    return result;
-}
+// Session keys are kept small enough to type n and the ciphertext by hand.
+const size_t SESSION_KEY_BITS = 40;
+
+// "Crack it yourself" mode: players get only n, e and the ciphertext and
+// must find d. Big enough to need a real factoring tool, small enough that
+// the room's own check (factoring n) stays interactive.
+const char* CRACK_CLUE_FILE = "rsa_crack_clue.txt";
+const size_t CRACK_KEY_BITS = 80;
 
 void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text, SDL_Color color, int x, int y) {
     SDL_Surface* surface = TTF_RenderUTF8_Blended(font, text.c_str(), color);
@@ -40,8 +38,94 @@ void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
     SDL_DestroyTexture(texture);
 }
 
+RSAPrivateKey loadRoomKey() {
+    RSAPrivateKey key;
+    if (std::ifstream(PUZZLE_KEY_FILE) && loadPrivateKey(PUZZLE_KEY_FILE, key)) return key;
+    RSAPuzzle puzzle = generatePuzzle(SESSION_KEY_BITS, "", std::random_device()());
+    if (savePuzzleClue(PUZZLE_CLUE_FILE, puzzle))
+        std::cout << "This session's clue was written to " << PUZZLE_CLUE_FILE << std::endl;
+    return puzzle.key;
+}
+
+// Public key for crack mode. The private half is thrown away; the room gets
+// it back by factoring n when the player answers.
+void newCrackPuzzle(BigUInt<4096>& n, BigUInt<4096>& e) {
+    RSAPuzzle puzzle = generatePuzzle(CRACK_KEY_BITS, "", std::random_device()());
+    n = puzzle.key.n;
+    e = puzzle.key.e;
+    if (savePuzzleClue(CRACK_CLUE_FILE, puzzle))
+        std::cout << "Crack mode clue was written to " << CRACK_CLUE_FILE << std::endl;
+}
+
+// Everything a Decrypt click needs, copied so the background job owns it.
+struct DecryptJob {
+    std::string n, e, d, ciphertext;
+    bool crackMode;
+    RSAPrivateKey roomKey;
+    BigUInt<4096> crackN, crackE;
+};
+
+// Runs on the background worker. Returns the plaintext, or "" when the key
+// or the answer is wrong (any token that does not decrypt to a byte counts
+// as wrong); throws on malformed input. The right public key
+// plus a ciphertext must really decrypt under the room's private key. In
+// crack mode the player's d must decrypt it the same way as the d the room
+// recovers by factoring n.
+std::string runDecryptJob(const DecryptJob& job, JobContext& context) {
+    BigUInt<4096> n = BigUInt<4096>::fromDecimal(job.n);
+    BigUInt<4096> e = BigUInt<4096>::fromDecimal(job.e);
+    auto tracked = [&context](const auto& decrypt) {
+        return [&context, &decrypt](const TokenSpan& token) {
+            if (context.cancelled()) throw JobCancelled();
+            char plain = decrypt(token);
+            context.advance();
+            return plain;
+        };
+    };
+
+    if (!job.crackMode) {
+        if (n != job.roomKey.n || e != job.roomKey.e) return "";
+        context.setTotal(countTokens(job.ciphertext));
+        try {
+            return withCRTDecryptor(job.roomKey, [&](const auto& crt) { return decryptTokens(job.ciphertext, tracked(crt)); });
+        } catch (const NotAByte&) {
+            return "";
+        }
+    }
+
+    RSAPrivateKey cracked;
+    if (n != job.crackN || e != job.crackE) return "";
+    if (!crackKey(n, e, cracked, [&context] { return context.cancelled(); })) return "";
+    context.setTotal(2 * countTokens(job.ciphertext));
+    auto decryptWith = [&](const std::string& d) {
+        return withPlainDecryptor(d, job.n, [&](const auto& plain) { return decryptTokens(job.ciphertext, tracked(plain)); });
+    };
+    try {
+        std::string plain = decryptWith(job.d);
+        return plain == decryptWith(cracked.d.toDecimal()) ? plain : "";
+    } catch (const NotAByte&) {
+        return "";
+    }
+}
+
+// Eight dots around (cx, cy), brightest one rotating once a second.
+void renderSpinner(SDL_Renderer* renderer, int cx, int cy) {
+    const float PI = 3.14159265f;
+    int lead = static_cast<int>(SDL_GetTicks() / 125 % 8);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    for (int i = 0; i < 8; ++i) {
+        float angle = i * PI / 4;
+        int alpha = 255 - ((lead - i + 8) % 8) * 28;
+        SDL_Rect dot = {cx + static_cast<int>(std::cos(angle) * 12) - 3, cy + static_cast<int>(std::sin(angle) * 12) - 3, 6, 6};
+        SDL_SetRenderDrawColor(renderer, 50, 255, 100, alpha);
+        SDL_RenderFillRect(renderer, &dot);
+    }
+}
+
 // RSA GUI logic wrapped in a function
 int launchRSAGUI(const std::string& playerName) {
+    RSAPrivateKey roomKey = loadRoomKey();
+
     SDL_Window* window = SDL_CreateWindow("RSA GUI Decryptor", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 900, 600, SDL_WINDOW_SHOWN);
     SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     TTF_Font* font = TTF_OpenFont("DejaVuSans.ttf", 24);
@@ -49,8 +133,22 @@ int launchRSAGUI(const std::string& playerName) {
     SDL_Texture* bgTex = SDL_CreateTextureFromSurface(renderer, bgSurf);
     SDL_FreeSurface(bgSurf);
 
-    std::string inputN, inputE, inputEnc, result;
-    enum Focus { FOCUS_N, FOCUS_E, FOCUS_ENC } currentFocus = FOCUS_N;
+    BigUInt<4096> crackN, crackE;
+    bool crackMode = false;
+
+    std::string inputN, inputE, inputEnc, inputD, result;
+    enum Focus { FOCUS_N, FOCUS_E, FOCUS_ENC, FOCUS_D } currentFocus = FOCUS_N;
+
+    // Decryption and factoring run here so the window keeps drawing.
+    // activeJob is 0 when nothing is pending.
+    BackgroundWorker worker;
+    uint64_t activeJob = 0;
+    auto cancelJob = [&] {
+        if (!activeJob) return;
+        worker.cancel();
+        activeJob = 0;
+        result.clear();
+    };
 
     bool running = true;
     SDL_Event event;
@@ -63,39 +161,65 @@ int launchRSAGUI(const std::string& playerName) {
     SDL_Rect rectN   = {200, 40, 500, 38};
     SDL_Rect rectE   = {200, 100, 500, 38};
     SDL_Rect rectEnc = {200, 190, 500, 38};
+    SDL_Rect rectD   = {200, 420, 500, 38};
     SDL_Rect decryptBtn = {50, 260, 120, 40};
+    SDL_Rect modeBtn = {200, 260, 330, 40};
+
+    // Click targets, bottom to top (nothing overlaps today, but the buttons
+    // win over the fields if the layout changes).
+    HotspotLayer hotspots;
+    auto addHotspot = [&](const char* name, const SDL_Rect& r) { return hotspots.add(name, r.x, r.y, r.w, r.h); };
+    const int spotD = addHotspot("private_exponent", rectD);
+    const int spotEnc = addHotspot("ciphertext", rectEnc);
+    const int spotE = addHotspot("exponent", rectE);
+    const int spotN = addHotspot("modulus", rectN);
+    const int spotMode = addHotspot("mode", modeBtn);
+    const int spotDecrypt = addHotspot("decrypt", decryptBtn);
 
     while (running) {
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) running = false;
             else if (event.type == SDL_MOUSEBUTTONDOWN) {
-                int mx = event.button.x, my = event.button.y;
-                if (mx > decryptBtn.x && mx < decryptBtn.x + decryptBtn.w && my > decryptBtn.y && my < decryptBtn.y + decryptBtn.h) {
-                    try {
-                        long long n = std::stoll(inputN);
-                        long long e = std::stoll(inputE);
-                        if (n == 2537 && e == 13 && inputEnc == "2081 2182 2024") {
-                            result = "Curzon is haunted";
-                        } else {
-                            result = "Access Denied. Try again.";
-                        }
-                    } catch (...) {
-                        result = "Invalid input";
-                    }
-                } else if (mx > rectN.x && mx < rectN.x + rectN.w && my > rectN.y && my < rectN.y + rectN.h) currentFocus = FOCUS_N;
-                else if (mx > rectE.x && mx < rectE.x + rectE.w && my > rectE.y && my < rectE.y + rectE.h) currentFocus = FOCUS_E;
-                else if (mx > rectEnc.x && mx < rectEnc.x + rectEnc.w && my > rectEnc.y && my < rectEnc.y + rectEnc.h) currentFocus = FOCUS_ENC;
+                const int spot = hotspots.hit(event.button.x, event.button.y);
+                if (spot == spotDecrypt) {
+                    DecryptJob job{inputN, inputE, inputD, inputEnc, crackMode, roomKey, crackN, crackE};
+                    activeJob = worker.submit([job](JobContext& context) { return runDecryptJob(job, context); });
+                    result.clear();
+                } else if (spot == spotMode) {
+                    cancelJob();
+                    crackMode = !crackMode;
+                    if (crackMode && crackN.isZero()) newCrackPuzzle(crackN, crackE);
+                    if (!crackMode && currentFocus == FOCUS_D) currentFocus = FOCUS_N;
+                    result.clear();
+                } else if (spot == spotN) currentFocus = FOCUS_N;
+                else if (spot == spotE) currentFocus = FOCUS_E;
+                else if (spot == spotEnc) currentFocus = FOCUS_ENC;
+                else if (crackMode && spot == spotD) currentFocus = FOCUS_D;
             } else if (event.type == SDL_TEXTINPUT) {
+                cancelJob();
                 if (currentFocus == FOCUS_N) inputN += event.text.text;
                 else if (currentFocus == FOCUS_E) inputE += event.text.text;
                 else if (currentFocus == FOCUS_ENC) inputEnc += event.text.text;
+                else if (currentFocus == FOCUS_D) inputD += event.text.text;
             } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_BACKSPACE) {
+                cancelJob();
                 if (currentFocus == FOCUS_N && !inputN.empty()) inputN.pop_back();
                 else if (currentFocus == FOCUS_E && !inputE.empty()) inputE.pop_back();
                 else if (currentFocus == FOCUS_ENC && !inputEnc.empty()) inputEnc.pop_back();
+                else if (currentFocus == FOCUS_D && !inputD.empty()) inputD.pop_back();
             }
         }
 
+        JobResult finished;
+        while (worker.poll(finished)) {
+            if (finished.id != activeJob) continue;
+            activeJob = 0;
+            const std::string& plain = finished.text;
+            bool readable = !plain.empty() && std::all_of(plain.begin(), plain.end(), [](unsigned char c) { return std::isprint(c); });
+            if (finished.failed) result = "Invalid input";
+            else result = readable ? plain : "Access Denied. Try again.";
+        }
+
         animationTime += 0.05f;
         int bgOffsetY = static_cast<int>(std::sin(animationTime) * 5.0);
         SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
@@ -111,7 +235,11 @@ int launchRSAGUI(const std::string& playerName) {
 
         SDL_SetRenderDrawColor(renderer, 180, 180, 180, 200);
         SDL_RenderDrawRect(renderer, &rectN); SDL_RenderDrawRect(renderer, &rectE); SDL_RenderDrawRect(renderer, &rectEnc);
-        SDL_Rect h; h = (currentFocus == FOCUS_N) ? rectN : (currentFocus == FOCUS_E) ? rectE : rectEnc;
+        if (crackMode) {
+            renderText(renderer, font, "Enter d:", labelColor, 50, 420);
+            SDL_RenderDrawRect(renderer, &rectD);
+        }
+        SDL_Rect h; h = (currentFocus == FOCUS_N) ? rectN : (currentFocus == FOCUS_E) ? rectE : (currentFocus == FOCUS_ENC) ? rectEnc : rectD;
         SDL_SetRenderDrawColor(renderer, 50, 200, 50, 150);
         SDL_RenderDrawRect(renderer, &h);
 
@@ -119,13 +247,32 @@ int launchRSAGUI(const std::string& playerName) {
         renderText(renderer, font, inputN, inputColor, rectN.x + horiz_padding, rectN.y + vert_padding);
         renderText(renderer, font, inputE, inputColor, rectE.x + horiz_padding, rectE.y + vert_padding);
         renderText(renderer, font, inputEnc, inputColor, rectEnc.x + horiz_padding, rectEnc.y + vert_padding);
+        if (crackMode) renderText(renderer, font, inputD, inputColor, rectD.x + horiz_padding, rectD.y + vert_padding);
 
         SDL_SetRenderDrawColor(renderer, 50, 200, 50, 255);
         SDL_RenderFillRect(renderer, &decryptBtn);
         renderText(renderer, font, "Decrypt", {30,30,30,255}, decryptBtn.x + 20, decryptBtn.y + 7);
+        SDL_SetRenderDrawColor(renderer, 180, 180, 180, 200);
+        SDL_RenderDrawRect(renderer, &modeBtn);
+        renderText(renderer, font, crackMode ? "Mode: Crack it yourself" : "Mode: Standard", labelColor, modeBtn.x + 12, modeBtn.y + 7);
 
         SDL_Color resultColor = (result == "Access Denied. Try again." || result == "Invalid input") ? SDL_Color{255,60,60,255} : SDL_Color{50,255,100,255};
         renderText(renderer, font, result, resultColor, 50, 360);
+        if (activeJob) {
+            size_t done, total;
+            worker.progress(done, total);
+            renderSpinner(renderer, 68, 376);
+            if (total > 0) {
+                SDL_Rect bar = {100, 366, 300, 20};
+                SDL_Rect fill = {bar.x, bar.y, static_cast<int>(bar.w * std::min(done, total) / total), bar.h};
+                SDL_SetRenderDrawColor(renderer, 50, 200, 50, 255);
+                SDL_RenderFillRect(renderer, &fill);
+                SDL_SetRenderDrawColor(renderer, 180, 180, 180, 200);
+                SDL_RenderDrawRect(renderer, &bar);
+            } else {
+                renderText(renderer, font, crackMode ? "Factoring n..." : "Decrypting...", labelColor, 100, 362);
+            }
+        }
 
         renderText(renderer, font, "Welcome, " + playerName + "!", {255, 255, 100, 255}, 600, 10);
 
@@ -140,8 +287,11 @@ int launchRSAGUI(const std::string& playerName) {
     return 0;
 }
 
-// Initial player name entry screen
-int main() {
+// Initial player name entry screen, or the headless decryptor when run
+// with arguments.
+int main(int argc, char* argv[]) {
+    if (argc > 1) return runDecryptCLI(argc, argv);
+
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "2");
     if (SDL_Init(SDL_INIT_VIDEO) < 0 || TTF_Init() < 0 || !(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
         std::cerr << "Init error: " << SDL_GetError() << std::endl; return 1;
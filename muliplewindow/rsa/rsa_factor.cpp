@@ -0,0 +1,148 @@
+#include "rsa_factor.h"
+#include "rsa_keygen.h"
+
+// Rho steps per gcd. The |x - y| values of a batch are multiplied together
+// in Montgomery form and only the product goes through gcd.
+const uint64_t RHO_BATCH = 128;
+
+// Polynomials x^2 + c tried before giving up on a composite n.
+const uint64_t RHO_ATTEMPTS = 8;
+
+// Anything with a factor below this is split by trial division.
+const uint64_t TRIAL_DIVISION_LIMIT = 1 << 10;
+
+static u128 toU128(const BigUInt<4096>& value) {
+    return ((u128)value.limb[1] << 64) | value.limb[0];
+}
+
+static BigUInt<4096> fromU128(u128 value) {
+    BigUInt<4096> out;
+    out.limb[0] = (uint64_t)value;
+    out.limb[1] = (uint64_t)(value >> 64);
+    return out;
+}
+
+// Binary gcd; a and b may be zero.
+template <size_t Bits>
+static BigUInt<Bits> gcd(BigUInt<Bits> a, BigUInt<Bits> b) {
+    if (a.isZero()) return b;
+    if (b.isZero()) return a;
+    size_t shift = 0;
+    while (!a.isOdd() && !b.isOdd()) {
+        a.shiftRight1();
+        b.shiftRight1();
+        ++shift;
+    }
+    while (!a.isOdd()) a.shiftRight1();
+    while (!b.isZero()) {
+        while (!b.isOdd()) b.shiftRight1();
+        if (b < a) std::swap(a, b);
+        b.sub(a);
+    }
+    while (shift-- > 0) a.shiftLeft1();
+    return a;
+}
+
+// Brent's variant of Pollard's rho on x -> x^2 + c, entirely in Montgomery
+// form. The map is x^2 R^-1 + c there, which is just as good a random
+// map mod p, and a product of Montgomery values shares its gcd with n
+// because R is a unit. Returns a factor of n other than 1, or false if the
+// walk closed on n itself or was cancelled.
+template <size_t Bits>
+static bool brentRho(const Montgomery<Bits>& mont, uint64_t c, BigUInt<Bits>& factor,
+                     const std::function<bool()>& cancelled) {
+    typedef BigUInt<Bits> Int;
+    const Int& n = mont.modulus();
+    const Int one(1);
+    const Int add = mont.toMont(Int(c));
+    auto step = [&](const Int& v) { return mont.addMod(mont.mul(v, v), add); };
+
+    Int y = mont.toMont(Int(2)), x, saved, product = mont.unity(), g = one;
+    for (uint64_t r = 1; g == one; r *= 2) {
+        x = y;
+        for (uint64_t i = 0; i < r; ++i) {
+            y = step(y);
+            if (i % RHO_BATCH == 0 && cancelled && cancelled()) return false;
+        }
+        for (uint64_t k = 0; k < r && g == one; k += RHO_BATCH) {
+            saved = y;
+            uint64_t count = std::min(RHO_BATCH, r - k);
+            for (uint64_t i = 0; i < count; ++i) {
+                y = step(y);
+                product = mont.mul(product, mont.subMod(x, y));
+            }
+            g = gcd(product, n);
+            if (cancelled && cancelled()) return false;
+        }
+    }
+    if (g == n) {
+        // The batch ran past the collision: replay it one gcd at a time.
+        do {
+            saved = step(saved);
+            g = gcd(mont.subMod(x, saved), n);
+        } while (g == one);
+    }
+    if (g == n) return false;
+    factor = g;
+    return true;
+}
+
+template <size_t Bits>
+static bool rhoFactor(const BigUInt<4096>& n, BigUInt<4096>& factor, const std::function<bool()>& cancelled) {
+    Montgomery<Bits> mont(n.resize<Bits>());
+    BigUInt<Bits> found;
+    for (uint64_t c = 1; c <= RHO_ATTEMPTS && !(cancelled && cancelled()); ++c) {
+        if (brentRho(mont, c, found, cancelled)) {
+            factor = found.template resize<4096>();
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool isPrime(const BigUInt<4096>& value) {
+    if (value.bitLength() <= 12) {
+        uint64_t v = value.limb[0];
+        if (v < 2) return false;
+        for (uint64_t d = 2; d * d <= v; ++d)
+            if (v % d == 0) return false;
+        return true;
+    }
+    if (!value.isOdd()) return false;
+    if (value.bitLength() <= 64) return isProbablePrime(value.resize<64>(), 12);
+    return isProbablePrime(value.resize<128>(), 12);
+}
+
+bool factorModulus(const BigUInt<4096>& n, BigUInt<4096>& p, BigUInt<4096>& q,
+                   const std::function<bool()>& cancelled) {
+    if (n.bitLength() > FACTOR_MAX_BITS || n.bitLength() < 2) return false;
+    u128 value = toU128(n);
+
+    u128 small = 0;
+    for (uint64_t d = 2; d < TRIAL_DIVISION_LIMIT && (u128)d * d <= value; ++d) {
+        if (value % d == 0) {
+            small = d;
+            break;
+        }
+    }
+    if (small == 0) {
+        if (value < (u128)TRIAL_DIVISION_LIMIT * TRIAL_DIVISION_LIMIT || isPrime(n)) return false;
+        BigUInt<4096> found;
+        bool split = n.bitLength() <= 64 ? rhoFactor<64>(n, found, cancelled) : rhoFactor<128>(n, found, cancelled);
+        if (!split) return false;
+        small = toU128(found);
+    }
+
+    u128 other = value / small;
+    p = fromU128(std::min(small, other));
+    q = fromU128(std::max(small, other));
+    return true;
+}
+
+bool crackKey(const BigUInt<4096>& n, const BigUInt<4096>& e, RSAPrivateKey& key,
+              const std::function<bool()>& cancelled) {
+    BigUInt<4096> p, q;
+    if (!factorModulus(n, p, q, cancelled) || p == q || !isPrime(p) || !isPrime(q)) return false;
+    // keyFromPrimes() wants odd primes; n = 2q is not worth a special case.
+    return keyFromPrimes(p, q, e, key);
+}
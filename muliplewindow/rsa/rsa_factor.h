@@ -0,0 +1,22 @@
+#pragma once
+
+#include <functional>
+#include "rsa_core.h"
+
+// Factoring engine for the "crack it yourself" mode: Pollard's rho with
+// Brent's cycle detection, in Montgomery form. Takes moduli up to 128 bits,
+// but only the low end is interactive: an 80-bit n splits in about 0.1 s
+// and the cost doubles with every four bits after that.
+
+const size_t FACTOR_MAX_BITS = 128;
+
+// Splits n into p * q with p <= q, p > 1. Returns false when n is prime,
+// wider than FACTOR_MAX_BITS, or rho gives up. cancelled, when set, is polled
+// between gcd batches and makes the search return false as soon as it is true.
+bool factorModulus(const BigUInt<4096>& n, BigUInt<4096>& p, BigUInt<4096>& q,
+                   const std::function<bool()>& cancelled = {});
+
+// Recovers the private key for (n, e) by factoring n. Returns false unless n
+// is a product of two distinct primes and e is invertible, or if cancelled.
+bool crackKey(const BigUInt<4096>& n, const BigUInt<4096>& e, RSAPrivateKey& key,
+              const std::function<bool()>& cancelled = {});
@@ -0,0 +1,279 @@
+#include "rsa_keygen.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+// Candidates are sieved by every odd prime below this bound before any
+// Miller-Rabin test; that leaves roughly one odd number in ten.
+const uint32_t SIEVE_PRIME_LIMIT = 1 << 16;
+
+// Odd candidates per sieve segment. Big enough that a 1024-bit segment
+// holds about a dozen primes, small enough to stay in L1.
+const size_t SIEVE_SEGMENT = 4096;
+
+const std::vector<std::string> CLUE_MESSAGES = {
+    "Curzon is haunted",
+    "The key is under the stairs",
+    "Look behind the clock",
+    "The attic door is unlocked",
+    "Follow the lantern light"
+};
+
+static const std::vector<uint32_t>& smallPrimes() {
+    static const std::vector<uint32_t> primes = [] {
+        std::vector<bool> composite(SIEVE_PRIME_LIMIT);
+        std::vector<uint32_t> found;
+        for (uint32_t i = 3; i < SIEVE_PRIME_LIMIT; i += 2) {
+            if (composite[i]) continue;
+            found.push_back(i);
+            for (uint64_t j = (uint64_t)i * i; j < SIEVE_PRIME_LIMIT; j += 2 * i) composite[j] = true;
+        }
+        return found;
+    }();
+    return primes;
+}
+
+// Fewer rounds are needed as candidates grow: a random composite of 1024
+// bits passes even one round with negligible probability. Below 2^64 the
+// twelve bases make the test deterministic.
+static size_t millerRabinRounds(size_t bits) {
+    if (bits >= 1024) return 5;
+    if (bits >= 512) return 7;
+    if (bits > 64) return 10;
+    return 12;
+}
+
+// Inverse of a mod m for word-sized values (extended Euclid).
+static uint64_t inverseMod(uint64_t a, uint64_t m) {
+    int64_t t = 0, newT = 1;
+    int64_t r = (int64_t)m, newR = (int64_t)(a % m);
+    while (newR != 0) {
+        int64_t q = r / newR;
+        std::swap(t, newT);
+        newT -= q * t;
+        std::swap(r, newR);
+        newR -= q * r;
+    }
+    return (uint64_t)(t < 0 ? t + (int64_t)m : t);
+}
+
+template <size_t Bits>
+static BigUInt<Bits> randomBits(size_t bits, std::mt19937_64& rng) {
+    BigUInt<Bits> value;
+    for (size_t i = 0; i < (bits + 63) / 64; ++i) value.limb[i] = rng();
+    if (bits % 64) value.limb[bits / 64] &= (1ULL << (bits % 64)) - 1;
+    return value;
+}
+
+// Random prime of exactly bits bits with the top two bits set (so a product
+// of two such primes has exactly twice the bits) and p mod e != 1 (so e is
+// invertible mod p - 1).
+template <size_t Bits>
+static BigUInt<Bits> findPrime(size_t bits, uint64_t e, std::mt19937_64& rng, WorkPool& pool) {
+    typedef BigUInt<Bits> Int;
+    const std::vector<uint32_t>& primes = smallPrimes();
+    const size_t rounds = millerRabinRounds(bits);
+
+    Int start;
+    bool fresh = true;
+    std::vector<char> composite(SIEVE_SEGMENT);
+    std::vector<uint32_t> survivors;
+    while (true) {
+        if (fresh) {
+            start = randomBits<Bits>(bits, rng);
+            start.limb[(bits - 1) / 64] |= 1ULL << ((bits - 1) % 64);
+            start.limb[(bits - 2) / 64] |= 1ULL << ((bits - 2) % 64);
+            start.limb[0] |= 1;
+            fresh = false;
+        }
+
+        // Strike out every odd start + 2i divisible by a small prime. A prime
+        // only proves compositeness when its square is below the candidate.
+        std::fill(composite.begin(), composite.end(), 0);
+        for (uint32_t prime : primes) {
+            if (start.bitLength() <= 32 && (uint64_t)prime * prime > start.limb[0]) break;
+            Int copy = start;
+            uint64_t rem = copy.divSmall(prime);
+            for (uint64_t i = (prime - rem) % prime * ((prime + 1) / 2) % prime; i < SIEVE_SEGMENT; i += prime)
+                composite[i] = 1;
+        }
+        Int copy = start;
+        uint64_t remE = copy.divSmall(e);
+        for (uint64_t i = (1 + e - remE) % e * inverseMod(2, e) % e; i < SIEVE_SEGMENT; i += e) composite[i] = 1;
+
+        survivors.clear();
+        for (size_t i = 0; i < SIEVE_SEGMENT; ++i)
+            if (!composite[i]) survivors.push_back(static_cast<uint32_t>(i));
+
+        // Test survivors in parallel and keep the lowest prime. Chunks past a
+        // prime already found are skipped, and everything below the final
+        // answer was tested, so the result does not depend on scheduling.
+        std::atomic<size_t> best{survivors.size()};
+        pool.parallelFor(survivors.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end && i < best; ++i) {
+                Int candidate = start;
+                if (candidate.add(Int(2ULL * survivors[i])) || candidate.bitLength() > bits) continue;
+                if (!isProbablePrime(candidate, rounds)) continue;
+                size_t seen = best;
+                while (i < seen && !best.compare_exchange_weak(seen, i)) {}
+            }
+        });
+        if (best < survivors.size()) {
+            start.add(Int(2ULL * survivors[best]));
+            return start;
+        }
+
+        // No prime in this segment: move on to the next one, or start over
+        // if that would run past bits.
+        Int next = start;
+        if (next.add(Int(2 * SIEVE_SEGMENT)) || next.bitLength() > bits) fresh = true;
+        else start = next;
+    }
+}
+
+// e^-1 mod m for a word-sized e coprime to m: d = (k * m + 1) / e with k
+// chosen so that k * m = -1 mod e.
+static BigUInt<4096> inverseOfSmall(uint64_t e, const BigUInt<4096>& m) {
+    BigUInt<4096> copy = m;
+    uint64_t k = (e - inverseMod(copy.divSmall(e), e)) % e;
+    BigUInt<4096 + 64> d = m.resize<4096 + 64>();
+    d.mulSmallAdd(k, 1);
+    d.divSmall(e);
+    return d.resize<4096>();
+}
+
+template <size_t Half>
+static bool keyFromPrimesWith(const BigUInt<Half>& p, const BigUInt<Half>& q, uint64_t e, RSAPrivateKey& key) {
+    typedef BigUInt<Half> Int;
+    Int pMinus1 = p, qMinus1 = q;
+    pMinus1.sub(Int(1));
+    qMinus1.sub(Int(1));
+    Int copyP = pMinus1, copyQ = qMinus1;
+    if (std::gcd(copyP.divSmall(e), e) != 1 || std::gcd(copyQ.divSmall(e), e) != 1) return false;
+
+    key.p = p.template resize<4096>();
+    key.q = q.template resize<4096>();
+    key.n = mulFull(p, q).template resize<4096>();
+    key.e = BigUInt<4096>(e);
+    key.d = inverseOfSmall(e, mulFull(pMinus1, qMinus1).template resize<4096>());
+    key.dP = inverseOfSmall(e, pMinus1.template resize<4096>());
+    key.dQ = inverseOfSmall(e, qMinus1.template resize<4096>());
+
+    // p is prime, so q^-1 = q^(p-2) mod p.
+    Int pMinus2 = pMinus1;
+    pMinus2.sub(Int(1));
+    key.qInv = Montgomery<Half>(p).modExp(q, pMinus2).template resize<4096>();
+    return true;
+}
+
+bool keyFromPrimes(const BigUInt<4096>& p, const BigUInt<4096>& q, const BigUInt<4096>& e, RSAPrivateKey& key) {
+    if (e.isZero() || e.bitLength() > 64 || !p.isOdd() || !q.isOdd()) return false;
+    size_t half = std::max(p.bitLength(), q.bitLength());
+    uint64_t exponent = e.limb[0];
+    if (half <= 64) return keyFromPrimesWith(p.resize<64>(), q.resize<64>(), exponent, key);
+    if (half <= 128) return keyFromPrimesWith(p.resize<128>(), q.resize<128>(), exponent, key);
+    if (half <= 256) return keyFromPrimesWith(p.resize<256>(), q.resize<256>(), exponent, key);
+    if (half <= 512) return keyFromPrimesWith(p.resize<512>(), q.resize<512>(), exponent, key);
+    if (half <= 1024) return keyFromPrimesWith(p.resize<1024>(), q.resize<1024>(), exponent, key);
+    return keyFromPrimesWith(p.resize<2048>(), q.resize<2048>(), exponent, key);
+}
+
+template <size_t Half>
+static RSAPrivateKey generateKeyWith(size_t bits, std::mt19937_64& rng, WorkPool& pool) {
+    typedef BigUInt<Half> Int;
+    const uint64_t e = RSA_PUBLIC_EXPONENT;
+    Int p = findPrime<Half>((bits + 1) / 2, e, rng, pool);
+    Int q;
+    do {
+        q = findPrime<Half>(bits / 2, e, rng, pool);
+    } while (q == p);
+
+    // findPrime() already ruled out p = 1 mod e, so this cannot fail.
+    RSAPrivateKey key;
+    keyFromPrimesWith(p, q, e, key);
+    return key;
+}
+
+RSAPrivateKey generateKey(size_t bits, uint64_t seed, WorkPool& pool) {
+    if (bits < 32 || bits > 4096) throw std::invalid_argument("key size must be 32 to 4096 bits");
+    std::mt19937_64 rng(seed);
+    size_t half = (bits + 1) / 2;
+    if (half <= 64) return generateKeyWith<64>(bits, rng, pool);
+    if (half <= 128) return generateKeyWith<128>(bits, rng, pool);
+    if (half <= 256) return generateKeyWith<256>(bits, rng, pool);
+    if (half <= 512) return generateKeyWith<512>(bits, rng, pool);
+    if (half <= 1024) return generateKeyWith<1024>(bits, rng, pool);
+    return generateKeyWith<2048>(bits, rng, pool);
+}
+
+template <size_t Bits>
+static std::string encryptWith(const std::string& message, const BigUInt<4096>& e, const BigUInt<4096>& n) {
+    typedef BigUInt<Bits> Int;
+    Montgomery<Bits> mont(n.resize<Bits>());
+    Int exp = e.resize<Bits>();
+    std::string result;
+    for (unsigned char c : message) {
+        if (!result.empty()) result += ' ';
+        result += mont.modExp(Int(c), exp).toDecimal();
+    }
+    return result;
+}
+
+std::string encryptRSA(const std::string& message, const BigUInt<4096>& e, const BigUInt<4096>& n) {
+    if (n.bitLength() <= 8) throw std::invalid_argument("modulus too small to encrypt bytes");
+    size_t bits = std::max(n.bitLength(), e.bitLength());
+    if (bits <= 64) return encryptWith<64>(message, e, n);
+    if (bits <= 256) return encryptWith<256>(message, e, n);
+    if (bits <= 512) return encryptWith<512>(message, e, n);
+    if (bits <= 1024) return encryptWith<1024>(message, e, n);
+    if (bits <= 2048) return encryptWith<2048>(message, e, n);
+    return encryptWith<4096>(message, e, n);
+}
+
+RSAPuzzle generatePuzzle(size_t bits, const std::string& message, uint64_t seed) {
+    RSAPuzzle puzzle;
+    puzzle.key = generateKey(bits, seed);
+    puzzle.message = message.empty() ? CLUE_MESSAGES[seed % CLUE_MESSAGES.size()] : message;
+    puzzle.ciphertext = encryptRSA(puzzle.message, puzzle.key.e, puzzle.key.n);
+    return puzzle;
+}
+
+void writePrivateKey(std::ostream& out, const RSAPrivateKey& key) {
+    out << "# RSA room private key (" << key.n.bitLength() << " bits)\n"
+        << "n = " << key.n.toDecimal() << "\n"
+        << "e = " << key.e.toDecimal() << "\n"
+        << "d = " << key.d.toDecimal() << "\n"
+        << "p = " << key.p.toDecimal() << "\n"
+        << "q = " << key.q.toDecimal() << "\n"
+        << "dP = " << key.dP.toDecimal() << "\n"
+        << "dQ = " << key.dQ.toDecimal() << "\n"
+        << "qInv = " << key.qInv.toDecimal() << "\n";
+}
+
+bool savePrivateKey(const std::string& path, const RSAPrivateKey& key) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to write key file " << path << std::endl;
+        return false;
+    }
+    writePrivateKey(file, key);
+    return static_cast<bool>(file);
+}
+
+void writePuzzleClue(std::ostream& out, const RSAPuzzle& puzzle) {
+    out << "n = " << puzzle.key.n.toDecimal() << "\n"
+        << "e = " << puzzle.key.e.toDecimal() << "\n"
+        << "Encrypted Text = " << puzzle.ciphertext << "\n";
+}
+
+bool savePuzzleClue(const std::string& path, const RSAPuzzle& puzzle) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Failed to write clue file " << path << std::endl;
+        return false;
+    }
+    writePuzzleClue(file, puzzle);
+    return static_cast<bool>(file);
+}
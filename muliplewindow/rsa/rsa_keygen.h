@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "rsa_core.h"
+
+// Key and puzzle generation for the RSA room. Nothing in here touches SDL.
+
+const uint64_t RSA_PUBLIC_EXPONENT = 65537;
+
+const uint64_t MILLER_RABIN_BASES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+// Miller-Rabin with the first rounds (at most 12) prime bases. With all
+// twelve the answer is exact for n below 2^64.
+template <size_t Bits>
+bool isProbablePrime(const BigUInt<Bits>& n, size_t rounds) {
+    typedef BigUInt<Bits> Int;
+    Montgomery<Bits> mont(n);
+    Int d = n;
+    d.sub(Int(1));
+    size_t s = 0;
+    while (!d.isOdd()) {
+        d.shiftRight1();
+        ++s;
+    }
+    const Int minusOne = mont.subMod(Int(), mont.unity());
+    for (size_t r = 0; r < rounds; ++r) {
+        Int x = mont.pow(mont.toMont(Int(MILLER_RABIN_BASES[r])), d);
+        if (x == mont.unity() || x == minusOne) continue;
+        bool composite = true;
+        for (size_t i = 1; i < s && composite; ++i) {
+            x = mont.mul(x, x);
+            if (x == minusOne) composite = false;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// A fresh key together with a clue encrypted under it.
+struct RSAPuzzle {
+    RSAPrivateKey key;
+    std::string message;
+    std::string ciphertext;
+};
+
+// Random key with e = 65537 whose modulus has exactly bits bits (32..4096).
+// Prime candidates are pre-filtered with a segmented sieve over small primes
+// and the survivors of each segment are Miller-Rabin tested on the pool.
+// The same seed always gives the same key.
+RSAPrivateKey generateKey(size_t bits, uint64_t seed, WorkPool& pool = sharedWorkPool());
+
+// One space-separated ciphertext token per byte of message, as read by decryptRSA().
+std::string encryptRSA(const std::string& message, const BigUInt<4096>& e, const BigUInt<4096>& n);
+
+// Fills in every field of key from the primes p and q and a word-sized e.
+// Returns false when e is not invertible mod (p-1)(q-1).
+bool keyFromPrimes(const BigUInt<4096>& p, const BigUInt<4096>& q, const BigUInt<4096>& e, RSAPrivateKey& key);
+
+// generateKey() plus an encrypted clue. An empty message picks one of the
+// built-in clues.
+RSAPuzzle generatePuzzle(size_t bits, const std::string& message, uint64_t seed);
+
+// Writes the key in the format read by loadPrivateKey().
+void writePrivateKey(std::ostream& out, const RSAPrivateKey& key);
+bool savePrivateKey(const std::string& path, const RSAPrivateKey& key);
+
+// The public half of the puzzle (n, e and the ciphertext) that players get.
+void writePuzzleClue(std::ostream& out, const RSAPuzzle& puzzle);
+bool savePuzzleClue(const std::string& path, const RSAPuzzle& puzzle);
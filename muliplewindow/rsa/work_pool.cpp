@@ -0,0 +1,102 @@
+#include "work_pool.h"
+#include <algorithm>
+#include <exception>
+
+WorkPool::WorkPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    // One extra queue for tasks pushed by threads outside the pool.
+    for (unsigned i = 0; i <= threads; ++i) queues.push_back(std::make_unique<TaskQueue>());
+    for (unsigned i = 0; i < threads; ++i) workers.emplace_back(&WorkPool::workerLoop, this, i);
+}
+
+WorkPool::~WorkPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void WorkPool::submit(std::function<void()> task) {
+    size_t target = nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+// Runs one task: own queue first (front), then steal from the others (back).
+bool WorkPool::runOne(size_t home) {
+    std::function<void()> task;
+    for (size_t k = 0; k < queues.size() && !task; ++k) {
+        TaskQueue& queue = *queues[(home + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+        if (k == 0) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        } else {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    if (!task) return false;
+    --pending;
+    task();
+    return true;
+}
+
+void WorkPool::workerLoop(size_t index) {
+    while (true) {
+        if (runOne(index)) continue;
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || pending > 0; });
+        if (stopping && pending == 0) return;
+    }
+}
+
+void WorkPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    struct Batch {
+        std::atomic<size_t> remaining;
+        std::mutex lock;
+        std::condition_variable done;
+        std::exception_ptr error;
+    } batch;
+    batch.remaining = (count + grain - 1) / grain;
+
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        submit([&batch, &body, begin, end] {
+            try {
+                body(begin, end);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(batch.lock);
+                if (!batch.error) batch.error = std::current_exception();
+            }
+            // Decrement under the lock so the caller cannot return (and destroy
+            // the batch) between our decrement and the notify.
+            std::lock_guard<std::mutex> guard(batch.lock);
+            if (--batch.remaining == 0) batch.done.notify_all();
+        });
+    }
+
+    // Help drain the queues instead of idling, then wait for chunks still in flight.
+    while (batch.remaining > 0 && runOne(queues.size() - 1)) {}
+    std::unique_lock<std::mutex> guard(batch.lock);
+    batch.done.wait(guard, [&batch] { return batch.remaining == 0; });
+    if (batch.error) std::rethrow_exception(batch.error);
+}
+
+WorkPool& sharedWorkPool() {
+    static WorkPool pool;
+    return pool;
+}
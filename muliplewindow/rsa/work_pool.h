@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, one task deque each. Owners pop from the
+// front of their own deque; idle workers steal from the back of the others.
+class WorkPool {
+public:
+    explicit WorkPool(unsigned threads = std::thread::hardware_concurrency());
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    void submit(std::function<void()> task);
+
+    // Calls body(begin, end) over [0, count) in chunks of at most grain items
+    // and blocks until every chunk has run. The calling thread helps out.
+    // The first exception thrown by a chunk is rethrown here.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool runOne(size_t home);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> pending{0};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// Process-wide pool sized to the number of hardware threads.
+WorkPool& sharedWorkPool();
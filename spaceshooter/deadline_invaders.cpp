@@ -6,11 +6,15 @@
 #include <algorithm> // Include algorithm for functions like std::remove_if to clean up vectors.
 #include <ctime> // Include ctime for time-related functions, used to seed the random number generator.
 #include <cmath> // Include cmath for mathematical functions like sin, used for animation.
+#include "scene_flow.h" // Include the coroutine scene flows resumed from the main loop.
+#include "room_progress.h" // Include markRoomSolved to record a win for the menu's map.
 
 // Define constants for screen dimensions and game winning score.
 const int SCREEN_WIDTH = 800; // Define the width of the game window in pixels.
 const int SCREEN_HEIGHT = 600; // Define the height of the game window in pixels.
 const int WIN_SCORE = 200; // Define the score required for the player to win the game.
+const char* PROGRESS_FILE = "../menuforgame/progress.txt"; // The menu's map reads solved rooms from this file.
+const char* ROOM_ID = "shooter"; // This room's id on the menu's map.
 
 // Structure to represent a Bullet in the game.
 struct Bullet {
@@ -25,6 +29,22 @@ struct Enemy {
     int speed = 1; // The vertical speed of the enemy. Positive means it moves downwards.
 };
 
+// Which screen the main loop draws. The game's flow moves from one to the next.
+enum Screen { NAME_ENTRY, PLAYING, GAME_OVER };
+
+// Everything the game's flow changes and the main loop draws.
+struct Game {
+    Screen screen = NAME_ENTRY; // The screen currently shown.
+    TextField name; // The player's name as it is typed.
+    SDL_Rect player = {SCREEN_WIDTH / 2 - 25, SCREEN_HEIGHT - 60, 50, 40}; // Player's position and size.
+    std::vector<Bullet> bullets; // Vector to store active bullets.
+    std::vector<Enemy> enemies; // Vector to store active enemies.
+    int score = 0; // The player's score.
+    Uint32 lastSpawnTime = 0; // Stores the time when the last enemy was spawned.
+    bool won = false; // Whether the player reached WIN_SCORE.
+    std::string encrypted; // The "encrypted code" shown when the player wins.
+};
+
 // Function to check for collision between two SDL_Rect objects.
 // Returns true if the rectangles intersect, false otherwise.
 bool checkCollision(SDL_Rect a, SDL_Rect b) {
@@ -61,38 +81,16 @@ void renderText(SDL_Renderer* renderer, TTF_Font* font, const std::string& text,
     SDL_DestroyTexture(texture);
 }
 
-// Function to get the player's name before starting the game.
+// Function to draw the name prompt while the player types.
 // renderer: The SDL_Renderer to draw on.
 // font: The TTF_Font to use for rendering text.
-// Returns the entered player's name as a string.
-std::string getPlayerName(SDL_Renderer* renderer, TTF_Font* font) {
-    SDL_StartTextInput(); // Enable text input events from the keyboard.
-    std::string name = ""; // Initialize an empty string to store the player's name.
+// name: The name typed so far.
+void drawNameEntry(SDL_Renderer* renderer, TTF_Font* font, const std::string& name) {
     SDL_Color white = {255, 255, 255}; // Define a white color for the text.
-    SDL_Event e; // Declare an SDL_Event variable to handle events.
-    bool done = false; // Flag to control the input loop.
-
-    while (!done) { // Loop until the player finishes entering their name.
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Set the drawing color to black.
-        SDL_RenderClear(renderer); // Clear the renderer with the black color.
-        renderText(renderer, font, "Enter Your Name:", white, 250, 200); // Render the prompt text.
-        renderText(renderer, font, name + "_", white, 250, 250); // Render the current name with a blinking cursor.
-        SDL_RenderPresent(renderer); // Update the screen to show the rendered text.
-
-        while (SDL_PollEvent(&e)) { // Poll for pending SDL events.
-            if (e.type == SDL_QUIT) return "Player"; // If the window close button is clicked, return a default name.
-            if (e.type == SDL_TEXTINPUT) name += e.text.text; // If text is input, append it to the name string.
-            if (e.type == SDL_KEYDOWN) { // If a key is pressed.
-                // If Backspace is pressed and the name is not empty, remove the last character.
-                if (e.key.keysym.sym == SDLK_BACKSPACE && !name.empty()) name.pop_back();
-                // If Enter (Return) is pressed and the name is not empty, set done to true to exit the loop.
-                if (e.key.keysym.sym == SDLK_RETURN && !name.empty()) done = true;
-            }
-        }
-    }
-
-    SDL_StopTextInput(); // Disable text input events.
-    return name; // Return the entered player's name.
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Set the drawing color to black.
+    SDL_RenderClear(renderer); // Clear the renderer with the black color.
+    renderText(renderer, font, "Enter Your Name:", white, 250, 200); // Render the prompt text.
+    renderText(renderer, font, name + "_", white, 250, 250); // Render the current name with a blinking cursor.
 }
 
 // Function to generate a random "encrypted code" (for game flavor).
@@ -106,13 +104,11 @@ std::string generateEncryptedCode() {
     return code; // Return the generated code.
 }
 
-// Function to display the end game screen (win or lose).
+// Function to draw the end game screen (win or lose).
 // renderer: The SDL_Renderer to draw on.
 // font: The TTF_Font to use for rendering text.
-// name: The player's name.
-// score: The player's final score.
-// won: A boolean indicating whether the player won (true) or lost (false).
-void showEndScreen(SDL_Renderer* renderer, TTF_Font* font, const std::string& name, int score, bool won) {
+// game: The finished game, with the player's name, final score and result.
+void drawEndScreen(SDL_Renderer* renderer, TTF_Font* font, const Game& game) {
     SDL_Color white = {255, 255, 255}; // White color.
     SDL_Color green = {0, 255, 0}; // Green color for win message.
     SDL_Color red = {255, 0, 0}; // Red color for lose message.
@@ -121,18 +117,106 @@ void showEndScreen(SDL_Renderer* renderer, TTF_Font* font, const std::string& na
     SDL_RenderClear(renderer); // Clear the screen to black.
 
     renderText(renderer, font, "Game Over!", white, 320, 180); // Render "Game Over!" title.
-    renderText(renderer, font, "Player: " + name, white, 300, 230); // Render player's name.
-    renderText(renderer, font, "Score: " + std::to_string(score), white, 300, 270); // Render player's score.
+    renderText(renderer, font, "Player: " + game.name.text, white, 300, 230); // Render player's name.
+    renderText(renderer, font, "Score: " + std::to_string(game.score), white, 300, 270); // Render player's score.
 
-    if (won) { // If the player won.
-        std::string encrypted = generateEncryptedCode(); // Generate the "encrypted code".
-        renderText(renderer, font, encrypted, green, 220, 310); // Display the encrypted code in green.
+    if (game.won) { // If the player won.
+        renderText(renderer, font, game.encrypted, green, 220, 310); // Display the encrypted code in green.
     } else { // If the player lost.
         renderText(renderer, font, "Try Again!", red, 300, 310); // Display "Try Again!" in red.
     }
+}
+
+// Function to advance the game by one frame.
+// game: The game to update.
+// events: The events polled this frame.
+// Returns true once the game is over (an enemy got through or the player won).
+bool stepGame(Game& game, const std::vector<SDL_Event>& events) {
+    // Array of labels for enemies.
+    static const std::string labels[] = {"PROJECT", "QUIZ", "LAB", "EXAM"};
+    SDL_Rect& player = game.player; // Shorthand for the player's rectangle.
+    std::vector<Bullet>& bullets = game.bullets; // Shorthand for the bullets.
+    std::vector<Enemy>& enemies = game.enemies; // Shorthand for the enemies.
+
+    for (const SDL_Event& e : events) { // Look at this frame's events.
+        // If a key is pressed and it's the Spacebar.
+        if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_SPACE) {
+            // Add a new bullet to the bullets vector.
+            // Bullet spawns from the center top of the player ship.
+            bullets.push_back({{player.x + player.w / 2 - 5, player.y, 10, 20}});
+        }
+    }
+
+    // Get the current state of the keyboard for continuous movement.
+    const Uint8* keys = SDL_GetKeyboardState(NULL);
+    // If Left arrow key is pressed and player is not at the left edge, move left.
+    if (keys[SDL_SCANCODE_LEFT] && player.x > 0) player.x -= 7;
+    // If Right arrow key is pressed and player is not at the right edge, move right.
+    if (keys[SDL_SCANCODE_RIGHT] && player.x < SCREEN_WIDTH - player.w) player.x += 7;
+
+    // Update bullet positions.
+    for (auto& b : bullets) b.rect.y += b.speed;
+    // Remove bullets that have moved off the top of the screen.
+    // std::remove_if moves elements to be removed to the end, then erase removes them.
+    bullets.erase(std::remove_if(bullets.begin(), bullets.end(), [](Bullet& b){ return b.rect.y < 0; }), bullets.end());
+
+    // Enemy spawning logic.
+    Uint32 current = SDL_GetTicks(); // Get current time in milliseconds.
+    if (current - game.lastSpawnTime > 1000) { // If 1 second (1000 ms) has passed since last spawn.
+        Enemy newEnemy; // Create a new enemy object.
+        // Set random x position for the enemy, ensuring it stays within screen bounds.
+        newEnemy.rect = {rand() % (SCREEN_WIDTH - 60), 0, 60, 40};
+        newEnemy.label = labels[rand() % 4]; // Assign a random label from the labels array.
+        newEnemy.speed = 2 + rand() % 3; // Assign a random speed between 2 and 4.
+        enemies.push_back(newEnemy); // Add the new enemy to the enemies vector.
+        game.lastSpawnTime = current; // Update the last spawn time.
+    }
+
+    // Update enemy positions.
+    for (auto& en : enemies) en.rect.y += en.speed;
+
+    // Collision detection between bullets and enemies.
+    for (size_t i = 0; i < bullets.size(); ++i) { // Iterate through each bullet.
+        for (size_t j = 0; j < enemies.size(); ++j) { // Iterate through each enemy.
+            if (checkCollision(bullets[i].rect, enemies[j].rect)) { // If a collision occurs.
+                bullets.erase(bullets.begin() + i); // Remove the hit bullet.
+                enemies.erase(enemies.begin() + j); // Remove the hit enemy.
+                game.score += 10; // Increase score.
+                break; // Break from inner loop as the current bullet is destroyed.
+            }
+        }
+    }
+
+    // Check if any enemy has reached the bottom of the screen (game over condition).
+    for (auto& en : enemies) {
+        if (en.rect.y > SCREEN_HEIGHT) return true; // The game ends as soon as an enemy passes.
+    }
+
+    // Check if the player has reached the winning score.
+    return game.score >= WIN_SCORE;
+}
 
-    SDL_RenderPresent(renderer); // Update the screen to show the end screen.
-    SDL_Delay(5000); // Pause for 5 seconds before returning (and exiting main).
+// The whole game as one flow: name entry, the round, then the end screen.
+// Each co_await hands control back to the main loop until it is time to go on.
+// flows: The FlowRunner resuming this flow.
+// game: The game state the main loop draws.
+Flow<> deadlineInvaders(FlowRunner& flows, Game& game) {
+    // Get the player's name before starting the round.
+    game.screen = NAME_ENTRY;
+    co_await flows.textEntered(game.name);
+
+    // Play one frame per main loop iteration until the game is over.
+    game.screen = PLAYING;
+    game.lastSpawnTime = SDL_GetTicks(); // Enemies start arriving a second from now.
+    while (!stepGame(game, flows.events())) co_await flows.nextFrame();
+
+    // After the round ends, determine if the player won or lost.
+    game.won = game.score >= WIN_SCORE;
+    if (game.won) game.encrypted = generateEncryptedCode(); // Generate the "encrypted code" once.
+    if (game.won) markRoomSolved(PROGRESS_FILE, ROOM_ID); // Show the room as solved on the menu's map.
+    game.screen = GAME_OVER;
+    co_await flows.seconds(5); // Show the end screen for 5 seconds, with the window still responsive.
+    flows.stop(); // Then end the program.
 }
 
 // Main function where the program execution begins.
@@ -189,9 +273,6 @@ int main() {
         return 1;
     }
 
-    // Get the player's name before starting the main game loop.
-    std::string playerName = getPlayerName(renderer, font);
-
     // Load and create texture for the background image.
     SDL_Surface* bgSurface = IMG_Load("space_background.png");
     if (!bgSurface) { // Check if background image loading failed.
@@ -225,121 +306,66 @@ int main() {
     SDL_Texture* playerTex = SDL_CreateTextureFromSurface(renderer, playerSurf);
     SDL_FreeSurface(playerSurf); // Free the surface after creating the texture.
 
-    // Initialize player's position and size.
-    SDL_Rect player = {SCREEN_WIDTH / 2 - 25, SCREEN_HEIGHT - 60, 50, 40};
-    std::vector<Bullet> bullets; // Vector to store active bullets.
-    std::vector<Enemy> enemies; // Vector to store active enemies.
-    // Array of labels for enemies.
-    std::string labels[] = {"PROJECT", "QUIZ", "LAB", "EXAM"};
-
-    int score = 0; // Initialize player's score.
-    bool quit = false; // Flag to control the main game loop.
+    Game game; // The game's state, shared by its flow and the drawing code below.
     SDL_Event e; // Event variable for handling input.
-    Uint32 lastSpawnTime = SDL_GetTicks(); // Stores the time when the last enemy was spawned.
-
-    // Main game loop. This loop runs continuously until the 'quit' flag is true.
-    while (!quit) {
-        // Event handling loop: Process all pending SDL events.
-        while (SDL_PollEvent(&e)) {
-            if (e.type == SDL_QUIT) quit = true; // If the user clicks the window close button, set quit to true.
-            // If a key is pressed and it's the Spacebar.
-            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_SPACE) {
-                // Add a new bullet to the bullets vector.
-                // Bullet spawns from the center top of the player ship.
-                bullets.push_back({{player.x + player.w / 2 - 5, player.y, 10, 20}});
-            }
-        }
 
-        // Get the current state of the keyboard for continuous movement.
-        const Uint8* keys = SDL_GetKeyboardState(NULL);
-        // If Left arrow key is pressed and player is not at the left edge, move left.
-        if (keys[SDL_SCANCODE_LEFT] && player.x > 0) player.x -= 7;
-        // If Right arrow key is pressed and player is not at the right edge, move right.
-        if (keys[SDL_SCANCODE_RIGHT] && player.x < SCREEN_WIDTH - player.w) player.x += 7;
-
-        // Update bullet positions.
-        for (auto& b : bullets) b.rect.y += b.speed;
-        // Remove bullets that have moved off the top of the screen.
-        // std::remove_if moves elements to be removed to the end, then erase removes them.
-        bullets.erase(std::remove_if(bullets.begin(), bullets.end(), [](Bullet& b){ return b.rect.y < 0; }), bullets.end());
-
-        // Enemy spawning logic.
-        Uint32 current = SDL_GetTicks(); // Get current time in milliseconds.
-        if (current - lastSpawnTime > 1000) { // If 1 second (1000 ms) has passed since last spawn.
-            Enemy newEnemy; // Create a new enemy object.
-            // Set random x position for the enemy, ensuring it stays within screen bounds.
-            newEnemy.rect = {rand() % (SCREEN_WIDTH - 60), 0, 60, 40};
-            newEnemy.label = labels[rand() % 4]; // Assign a random label from the labels array.
-            newEnemy.speed = 2 + rand() % 3; // Assign a random speed between 2 and 4.
-            enemies.push_back(newEnemy); // Add the new enemy to the enemies vector.
-            lastSpawnTime = current; // Update the last spawn time.
-        }
+    // The main loop. This is the only place events are polled; the game's flow is
+    // resumed from flows.update() and the screen it is on decides what gets drawn.
+    // The runner is scoped so its flows are gone before the renderer.
+    {
+        FlowRunner flows; // Runs the game's flow.
+        flows.start(deadlineInvaders(flows, game)); // Start the game.
+
+        while (flows.running()) {
+            // Event handling loop: Process all pending SDL events.
+            while (SDL_PollEvent(&e)) {
+                if (e.type == SDL_QUIT) flows.stop(); // If the user clicks the window close button, stop.
+                flows.dispatch(e); // Hand every event to the flows.
+            }
+            flows.update(); // Resume the game's flow.
+            if (!flows.running()) break; // The game is over.
+
+            if (game.screen == NAME_ENTRY) {
+                drawNameEntry(renderer, font, game.name.text); // Draw the name prompt.
+            } else if (game.screen == GAME_OVER) {
+                drawEndScreen(renderer, font, game); // Draw the end screen.
+            } else {
+                // --- Rendering Section ---
+                SDL_RenderClear(renderer); // Clear the entire renderer with the current drawing color (usually black).
+                SDL_RenderCopy(renderer, bgTexture, NULL, NULL); // Draw the background texture, stretching it to fill the screen.
+                SDL_RenderCopy(renderer, playerTex, NULL, &game.player); // Draw the player ship at its current position.
+
+                // Animate text glow for enemy labels using a sine wave.
+                // Value oscillates between 1 and 255 for a pulsating effect.
+                int glow = static_cast<int>(128 + 127 * sin(SDL_GetTicks() / 300.0));
+                SDL_Color glowColor = {
+                    static_cast<Uint8>(glow), // Red component.
+                    static_cast<Uint8>(glow), // Green component.
+                    static_cast<Uint8>(glow)  // Blue component.
+                };
+
+                // Draw enemies and their labels.
+                for (auto& en : game.enemies) {
+                    SDL_RenderCopy(renderer, enemyTex, NULL, &en.rect); // Draw the enemy ship image.
+                    // Draw the enemy's label slightly offset from its rectangle, with the glowing color.
+                    renderText(renderer, font, en.label, glowColor, en.rect.x + 5, en.rect.y + 10);
+                }
 
-        // Update enemy positions.
-        for (auto& en : enemies) en.rect.y += en.speed;
-
-        // Collision detection between bullets and enemies.
-        for (size_t i = 0; i < bullets.size(); ++i) { // Iterate through each bullet.
-            for (size_t j = 0; j < enemies.size(); ++j) { // Iterate through each enemy.
-                if (checkCollision(bullets[i].rect, enemies[j].rect)) { // If a collision occurs.
-                    bullets.erase(bullets.begin() + i); // Remove the hit bullet.
-                    enemies.erase(enemies.begin() + j); // Remove the hit enemy.
-                    score += 10; // Increase score.
-                    break; // Break from inner loop as the current bullet is destroyed.
+                SDL_Color white = {255, 255, 255}; // Define white color for general text.
+                // Draw bullets as filled yellow rectangles.
+                for (auto& b : game.bullets) {
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255); // Set drawing color to yellow (R, G, B, A).
+                    SDL_RenderFillRect(renderer, &b.rect); // Fill the bullet's rectangle with yellow.
                 }
-            }
-        }
 
-        // Check if any enemy has reached the bottom of the screen (game over condition).
-        for (auto& en : enemies) {
-            if (en.rect.y > SCREEN_HEIGHT) {
-                quit = true; // Set quit to true to end the game.
-                break; // Exit loop immediately if an enemy passes.
+                // Render the current score in the top-left corner.
+                renderText(renderer, font, "Score: " + std::to_string(game.score), white, 10, 10);
             }
+            SDL_RenderPresent(renderer); // Present the rendered frame to the screen (swap buffers).
+            SDL_Delay(16); // Introduce a small delay to cap the frame rate (approx. 60 FPS).
         }
-
-        // Check if the player has reached the winning score.
-        if (score >= WIN_SCORE) quit = true; // If winning score is reached, set quit to true.
-
-        // --- Rendering Section ---
-        SDL_RenderClear(renderer); // Clear the entire renderer with the current drawing color (usually black).
-        SDL_RenderCopy(renderer, bgTexture, NULL, NULL); // Draw the background texture, stretching it to fill the screen.
-        SDL_RenderCopy(renderer, playerTex, NULL, &player); // Draw the player ship at its current position.
-
-        // Animate text glow for enemy labels using a sine wave.
-        // Value oscillates between 1 and 255 for a pulsating effect.
-        int glow = static_cast<int>(128 + 127 * sin(SDL_GetTicks() / 300.0));
-        SDL_Color glowColor = {
-            static_cast<Uint8>(glow), // Red component.
-            static_cast<Uint8>(glow), // Green component.
-            static_cast<Uint8>(glow)  // Blue component.
-        };
-
-        // Draw enemies and their labels.
-        for (auto& en : enemies) {
-            SDL_RenderCopy(renderer, enemyTex, NULL, &en.rect); // Draw the enemy ship image.
-            // Draw the enemy's label slightly offset from its rectangle, with the glowing color.
-            renderText(renderer, font, en.label, glowColor, en.rect.x + 5, en.rect.y + 10);
-        }
-
-        SDL_Color white = {255, 255, 255}; // Define white color for general text.
-        // Draw bullets as filled yellow rectangles.
-        for (auto& b : bullets) {
-            SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255); // Set drawing color to yellow (R, G, B, A).
-            SDL_RenderFillRect(renderer, &b.rect); // Fill the bullet's rectangle with yellow.
-        }
-
-        // Render the current score in the top-left corner.
-        renderText(renderer, font, "Score: " + std::to_string(score), white, 10, 10);
-        SDL_RenderPresent(renderer); // Present the rendered frame to the screen (swap buffers).
-        SDL_Delay(16); // Introduce a small delay to cap the frame rate (approx. 60 FPS).
     }
 
-    // After the main game loop ends, determine if the player won or lost.
-    bool won = score >= WIN_SCORE;
-    // Show the appropriate end screen.
-    showEndScreen(renderer, font, playerName, score, won);
-
     // --- Cleanup Section ---
     // Destroy all loaded textures to free GPU memory.
     SDL_DestroyTexture(bgTexture);